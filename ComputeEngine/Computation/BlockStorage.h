@@ -1,22 +1,54 @@
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <stdexcept>
 #include <tuple>
+#include <utility>
 #include <vector>
+#include "../Utilities/MappedFile.h"
 #include "Vec3.h"
 
 namespace Computation {
 
 template <typename T>
 class CellBlock {
-  // 3-dimensional contiguous memory
+  // 3-dimensional contiguous memory, either owned or a file mapped into memory
   Vec3<std::size_t> dimension_size;
-  std::vector<T> data;
+  std::vector<T> storage;
+  std::unique_ptr<MappedFile::MappedFile> mapping;
+  std::span<T> data;
 
  public:
   CellBlock(Vec3<std::size_t> dimension_size) : dimension_size(dimension_size) {
-    data = std::vector<T>(dimension_size.product());
+    storage = std::vector<T>(dimension_size.product());
+    data = storage;
+  }
+
+  // Cells are stored in `path`, which holds the raw cells once the block is flushed
+  CellBlock(Vec3<std::size_t> dimension_size, const std::filesystem::path& path)
+      : dimension_size(dimension_size) {
+    mapping = std::make_unique<MappedFile::MappedFile>(
+        path, dimension_size.product() * sizeof(T));
+    data = std::span<T>(reinterpret_cast<T*>(mapping->data()),
+                        dimension_size.product());
+  }
+
+  CellBlock(const CellBlock&) = delete;
+  CellBlock& operator=(const CellBlock&) = delete;
+  CellBlock(CellBlock&&) noexcept = default;
+  CellBlock& operator=(CellBlock&&) noexcept = default;
+  ~CellBlock() = default;
+
+  [[nodiscard]] bool is_mapped() const { return mapping != nullptr; }
+  void flush() const {
+    if (mapping) {
+      mapping->flush();
+    }
   }
 
   T get_cell(std::size_t id) const { return data[id]; };
@@ -24,11 +56,165 @@ class CellBlock {
 
   [[nodiscard]] std::size_t size() const { return dimension_size.product(); }
 
+  [[nodiscard]] std::span<T> cells() { return data; }
+
   [[nodiscard]] char* unsafe_get_raw_bytes() {
     return reinterpret_cast<char*>(data.data());
   }
 };
 
+template <typename T>
+class CellBlockView {
+  // Read-only x-major cells held elsewhere (a mapped file or a loaded copy), or a
+  // sub-box of them, placed in world coordinates. `owner` keeps the cells alive,
+  // so views stay valid after the reader that created them is gone
+  std::shared_ptr<const void> owner;
+  const T* data;
+  Vec3<std::size_t> dimension_size;
+  Vec3<std::size_t> stride;
+  Vec3<double> origin;
+  Vec3<double> spacing;
+
+  // Continuous index of world position along one axis, clamped into the block
+  [[nodiscard]] static double axis_index(double position,
+                                         double axis_origin,
+                                         double axis_spacing,
+                                         std::size_t cnt) {
+    if (axis_spacing == 0.0 or cnt < 2) {
+      return 0.0;
+    }
+    return std::clamp((position - axis_origin) / axis_spacing, 0.0, double(cnt - 1));
+  }
+
+ public:
+  CellBlockView(std::shared_ptr<const void> owner,
+                const T* data,
+                Vec3<std::size_t> dimension_size,
+                Vec3<double> origin,
+                Vec3<double> spacing)
+      : owner(std::move(owner)),
+        data(data),
+        dimension_size(dimension_size),
+        stride(Vec3<std::size_t>{dimension_size.y * dimension_size.z,
+                                 dimension_size.z, 1}),
+        origin(origin),
+        spacing(spacing) {}
+
+  [[nodiscard]] Vec3<std::size_t> get_dimension_size() const { return dimension_size; }
+  [[nodiscard]] Vec3<double> get_origin() const { return origin; }
+  [[nodiscard]] Vec3<double> get_spacing() const { return spacing; }
+  [[nodiscard]] std::size_t size() const { return dimension_size.product(); }
+
+  [[nodiscard]] T get_cell(const Vec3<std::size_t>& idx) const {
+    return data[idx.x * stride.x + idx.y * stride.y + idx.z * stride.z];
+  }
+
+  // Cells in storage order, only views of whole blocks are contiguous
+  [[nodiscard]] bool is_contiguous() const {
+    return stride.y == dimension_size.z and stride.x == dimension_size.y * stride.y;
+  }
+  [[nodiscard]] std::span<const T> cells() const {
+    if (not is_contiguous()) {
+      throw std::logic_error("Cells of a sliced view are not contiguous");
+    }
+    return std::span<const T>(data, size());
+  }
+
+  [[nodiscard]] Vec3<double> get_position(const Vec3<std::size_t>& idx) const {
+    return origin + spacing.elem_product(idx.template cast<double>());
+  }
+  // Index of the cell nearest to a world position, clamped into the block
+  [[nodiscard]] Vec3<std::size_t> get_nearest(const Vec3<double>& position) const {
+    return Vec3<std::size_t>{
+        std::size_t(std::lround(
+            axis_index(position.x, origin.x, spacing.x, dimension_size.x))),
+        std::size_t(std::lround(
+            axis_index(position.y, origin.y, spacing.y, dimension_size.y))),
+        std::size_t(std::lround(
+            axis_index(position.z, origin.z, spacing.z, dimension_size.z)))};
+  }
+
+  // Trilinear interpolation at a world position, clamped into the block
+  [[nodiscard]] T sample(const Vec3<double>& position) const {
+    const auto fx = axis_index(position.x, origin.x, spacing.x, dimension_size.x);
+    const auto fy = axis_index(position.y, origin.y, spacing.y, dimension_size.y);
+    const auto fz = axis_index(position.z, origin.z, spacing.z, dimension_size.z);
+    const auto lo =
+        Vec3<std::size_t>{std::size_t(fx), std::size_t(fy), std::size_t(fz)};
+    const auto hi =
+        Vec3<std::size_t>{std::min(lo.x + 1, dimension_size.x - 1),
+                          std::min(lo.y + 1, dimension_size.y - 1),
+                          std::min(lo.z + 1, dimension_size.z - 1)};
+    const auto tx = fx - double(lo.x);
+    const auto ty = fy - double(lo.y);
+    const auto tz = fz - double(lo.z);
+
+    const auto along_z = [&](std::size_t x, std::size_t y) {
+      return get_cell({x, y, lo.z}) * (1.0 - tz) + get_cell({x, y, hi.z}) * tz;
+    };
+    const auto along_y = [&](std::size_t x) {
+      return along_z(x, lo.y) * (1.0 - ty) + along_z(x, hi.y) * ty;
+    };
+    return along_y(lo.x) * (1.0 - tx) + along_y(hi.x) * tx;
+  }
+
+  // View of the box [begin, begin + count) sharing the same cells
+  [[nodiscard]] CellBlockView slice(const Vec3<std::size_t>& begin,
+                                    const Vec3<std::size_t>& count) const {
+    const auto end = begin + count;
+    if (end.x > dimension_size.x or end.y > dimension_size.y or
+        end.z > dimension_size.z) {
+      throw std::out_of_range("Slice is outside of cell block");
+    }
+    auto result = *this;
+    result.data = &data[begin.x * stride.x + begin.y * stride.y + begin.z * stride.z];
+    result.dimension_size = count;
+    result.origin = get_position(begin);
+    return result;
+  }
+  // View of the plane at `index` along axis (0, 1 or 2 for x, y or z)
+  [[nodiscard]] CellBlockView plane(std::size_t axis, std::size_t index) const {
+    auto begin = Vec3<std::size_t>{0, 0, 0};
+    auto count = dimension_size;
+    (axis == 0 ? begin.x : axis == 1 ? begin.y : begin.z) = index;
+    (axis == 0 ? count.x : axis == 1 ? count.y : count.z) = 1;
+    return slice(begin, count);
+  }
+
+  // Copy cells into a block owned by the caller
+  [[nodiscard]] CellBlock<T> copy() const {
+    auto result = CellBlock<T>(dimension_size);
+    auto id = std::size_t(0);
+    for (std::size_t x = 0; x < dimension_size.x; ++x) {
+      for (std::size_t y = 0; y < dimension_size.y; ++y) {
+        for (std::size_t z = 0; z < dimension_size.z; ++z) {
+          result.set_cell(id++, get_cell({x, y, z}));
+        }
+      }
+    }
+    return result;
+  }
+};
+
+template <typename T>
+class SlabRing {
+  // Ring of x-slabs (contiguous yz planes), slab x is stored at x modulo depth
+  std::size_t slab_size;
+  std::vector<std::vector<T>> slabs;
+
+ public:
+  SlabRing(std::size_t depth, std::size_t slab_size) : slab_size(slab_size) {
+    slabs = std::vector<std::vector<T>>(depth, std::vector<T>(slab_size));
+  }
+
+  [[nodiscard]] T* slab(std::size_t x) { return slabs[x % slabs.size()].data(); }
+  [[nodiscard]] const T* slab(std::size_t x) const {
+    return slabs[x % slabs.size()].data();
+  }
+
+  [[nodiscard]] std::size_t size() const { return slabs.size() * slab_size; }
+};
+
 class CellBlockInterpolation {
   // Map integer id to some vector in 3-dimensional space
   Vec3<std::size_t> dimension_size;
@@ -41,9 +227,23 @@ class CellBlockInterpolation {
                          Vec3<double> end)
       : dimension_size(dimension_size), begin(begin), end(end) {}
 
+  [[nodiscard]] Vec3<std::size_t> get_dimension_size() const { return dimension_size; }
+  [[nodiscard]] Vec3<double> get_begin() const { return begin; }
+  [[nodiscard]] Vec3<double> get_end() const { return end; }
+  // Distance between adjacent cells, a single cell axis reports 0
+  [[nodiscard]] Vec3<double> get_spacing() const {
+    return (end - begin).elem_division(
+        Vec3<double>{std::max(double(dimension_size.x) - 1.0, 1.0),
+                     std::max(double(dimension_size.y) - 1.0, 1.0),
+                     std::max(double(dimension_size.z) - 1.0, 1.0)});
+  }
+
   [[nodiscard]] Vec3<double> get_real_vec(std::size_t id) const {
+    // begin and end are the first and last cell, a single cell axis sits at begin
     const auto pos = get_int_vec(id).template cast<double>().elem_division(
-        dimension_size.cast<double>());
+        Vec3<double>{std::max(double(dimension_size.x) - 1.0, 1.0),
+                     std::max(double(dimension_size.y) - 1.0, 1.0),
+                     std::max(double(dimension_size.z) - 1.0, 1.0)});
     return Vec3<double>{std::lerp(this->begin.x, this->end.x, pos.x),
                         std::lerp(this->begin.y, this->end.y, pos.y),
                         std::lerp(this->begin.z, this->end.z, pos.z)};
@@ -61,6 +261,18 @@ class CellBlockInterpolation {
            vec.y * this->dimension_size.z + vec.z;
   }
 
+  // Return id difference between two cells adjacent along axis (0: x, 1: y, 2: z)
+  [[nodiscard]] std::size_t get_stride(std::size_t axis) const {
+    switch (axis) {
+      case 0:
+        return this->dimension_size.z * this->dimension_size.y;
+      case 1:
+        return this->dimension_size.z;
+      default:
+        return 1;
+    }
+  }
+
   [[nodiscard]] std::size_t get_cell_count() const { return dimension_size.product(); };
 };
 
@@ -0,0 +1,197 @@
+#include "Checkpoint.h"
+#include <fmt/format.h>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include "../Utilities/Hash.h"
+#include "MemoryPlanner.h"
+
+namespace Computation {
+
+namespace {
+
+constexpr auto manifest_name = std::string_view("checkpoint.json");
+
+std::filesystem::path field_path(const std::filesystem::path& directory,
+                                 std::string_view field) {
+  return directory / (std::string(field) + ".ckpt");
+}
+
+}  // namespace
+
+std::string checkpoint_tag(const std::vector<Config::Transducer>& transducers,
+                           const Config::SimulationParameter& simulation_parameter) {
+  auto parameters = nlohmann::json();
+  parameters["simulation_parameter"] =
+      JSONConvert::from_simulation_parameter(simulation_parameter);
+  parameters["transducers"] = nlohmann::json::array();
+  for (const auto& transducer : transducers) {
+    parameters["transducers"].push_back(JSONConvert::from_transducer(transducer));
+  }
+
+  return Hash::to_hex(Hash::fnv1a(parameters.dump()));
+}
+
+Checkpoint::Checkpoint(AtomicLogger::AtomicLogger* result_log,
+                       std::filesystem::path directory,
+                       std::string tag,
+                       std::chrono::seconds interval,
+                       bool resume)
+    : result_log(result_log),
+      directory(std::move(directory)),
+      tag(std::move(tag)),
+      interval(interval),
+      last_save(std::chrono::steady_clock::now()) {
+  const auto manifest_path = this->directory / manifest_name;
+  if (resume and std::filesystem::exists(manifest_path)) {
+    auto manifest_file = std::ifstream(manifest_path);
+    const auto manifest = nlohmann::json::parse(manifest_file);
+    if (manifest.value("tag", std::string()) == this->tag) {
+      for (const auto& [field, bytes] : manifest.at("fields").items()) {
+        // a field file shorter than the manifest says is not usable
+        const auto path = field_path(this->directory, field);
+        if (std::filesystem::exists(path) and
+            std::filesystem::file_size(path) >= bytes.get<std::size_t>()) {
+          this->saved[field] = bytes.get<std::size_t>();
+        }
+      }
+      this->result_log->log(fmt::format(FMT_STRING("Resuming from checkpoint {:s}"),
+                                        this->tag));
+      return;
+    }
+    this->result_log->log(
+        "Checkpoint belongs to other parameters, starting from the beginning");
+  } else if (resume) {
+    this->result_log->log("No checkpoint to resume from");
+  }
+
+  std::filesystem::remove_all(this->directory);
+  std::filesystem::create_directories(this->directory);
+  this->write_manifest();
+}
+
+void Checkpoint::write_manifest() {
+  auto manifest = nlohmann::json();
+  manifest["version"] = 1;
+  manifest["tag"] = this->tag;
+  manifest["fields"] = nlohmann::json::object();
+  for (const auto& [field, bytes] : this->saved) {
+    manifest["fields"][field] = bytes;
+  }
+
+  // renaming replaces the manifest at once, so it is never seen half written
+  const auto manifest_path = this->directory / manifest_name;
+  auto temporary_path = manifest_path;
+  temporary_path += ".tmp";
+  {
+    auto manifest_file = std::ofstream(temporary_path, std::fstream::trunc);
+    manifest_file << manifest.dump();
+    if (not manifest_file) {
+      throw std::runtime_error("Unable to write checkpoint manifest");
+    }
+  }
+  std::filesystem::rename(temporary_path, manifest_path);
+}
+
+std::size_t Checkpoint::saved_bytes(std::string_view field) {
+  const auto scoped_lock = std::scoped_lock(this->manifest_lock);
+  const auto bytes = this->saved.find(field);
+  return bytes != this->saved.end() ? bytes->second : 0;
+}
+
+void Checkpoint::restore(std::string_view field, std::span<std::byte> cells) {
+  const auto bytes = std::min(this->saved_bytes(field), cells.size());
+  auto field_file =
+      std::ifstream(field_path(this->directory, field), std::fstream::binary);
+  field_file.read(reinterpret_cast<char*>(cells.data()), std::streamsize(bytes));
+  if (not field_file) {
+    throw std::runtime_error("Unable to restore " + std::string(field) +
+                             " from checkpoint");
+  }
+  this->result_log->log(fmt::format(FMT_STRING("Restored {:s} of {:s} from checkpoint"),
+                                    format_bytes(bytes), field));
+}
+
+bool Checkpoint::is_due() const {
+  return std::chrono::steady_clock::now() - this->last_save >= this->interval;
+}
+
+void Checkpoint::save(std::string_view field,
+                      std::span<const std::byte> cells,
+                      std::size_t end) {
+  this->last_save = std::chrono::steady_clock::now();
+  auto job = this->writer.submit([this, name = std::string(field), cells, end]() {
+    // starting after the last successful save, so a failed save is written again
+    const auto begin = [&]() {
+      const auto scoped_lock = std::scoped_lock(this->manifest_lock);
+      return this->saved[name];
+    }();
+    const auto path = field_path(this->directory, name);
+    if (not std::filesystem::exists(path)) {
+      auto create = std::ofstream(path, std::fstream::binary);
+    }
+    {
+      auto field_file = std::fstream(
+          path, std::fstream::in | std::fstream::out | std::fstream::binary);
+      field_file.seekp(std::streamoff(begin));
+      field_file.write(reinterpret_cast<const char*>(cells.data() + begin),
+                       std::streamsize(end - begin));
+      if (not field_file) {
+        throw std::runtime_error("Unable to write checkpoint of " + name);
+      }
+    }
+
+    const auto scoped_lock = std::scoped_lock(this->manifest_lock);
+    this->saved[name] = end;
+    this->write_manifest();
+    this->result_log->log(fmt::format(FMT_STRING("Checkpointed {:s} of {:s}"),
+                                      format_bytes(end), name));
+  });
+
+  const auto scoped_lock = std::scoped_lock(this->manifest_lock);
+  this->pending[std::string(field)] = std::move(job);
+}
+
+void Checkpoint::wait(std::string_view field) {
+  auto job = [&]() -> std::shared_future<void> {
+    const auto scoped_lock = std::scoped_lock(this->manifest_lock);
+    const auto pending_job = this->pending.find(field);
+    if (pending_job == this->pending.end()) {
+      return {};
+    }
+    auto result = pending_job->second;
+    this->pending.erase(pending_job);
+    return result;
+  }();
+  // saves run in order, so the last one of a field finishing means all did
+  if (job.valid()) {
+    job.get();
+  }
+}
+
+std::vector<std::shared_future<void>> Checkpoint::take_pending() {
+  const auto scoped_lock = std::scoped_lock(this->manifest_lock);
+  auto result = std::vector<std::shared_future<void>>();
+  for (const auto& [field, job] : this->pending) {
+    result.push_back(job);
+  }
+  this->pending.clear();
+  return result;
+}
+
+void Checkpoint::drain() noexcept {
+  // jobs lock the manifest when done, so they are waited on without holding it
+  for (const auto& job : this->take_pending()) {
+    job.wait();
+  }
+}
+
+void Checkpoint::remove() {
+  for (const auto& job : this->take_pending()) {
+    job.get();
+  }
+  std::filesystem::remove_all(this->directory);
+}
+
+}  // namespace Computation
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../Utilities/AsyncWriter.h"
+#include "../Utilities/AtomicLogger.h"
+#include "Config.h"
+
+namespace Computation {
+
+// Hash (hex FNV-1a of their JSON) identifying the results of these parameters
+[[nodiscard]] std::string checkpoint_tag(
+    const std::vector<Config::Transducer>& transducers,
+    const Config::SimulationParameter& simulation_parameter);
+
+/* Cells of intermediate fields saved while a run progresses, so a later run with
+ * the same tag continues after the last save instead of starting over.
+ *
+ * The directory holds `<field>.ckpt` with the saved prefix of each field's cells
+ * and `checkpoint.json` with the tag and the number of bytes saved per field. Saves
+ * are written in order on a background thread, and the manifest is replaced only
+ * after the cells it describes are written, so it always describes a valid
+ * checkpoint even if the run is killed during a save. */
+class Checkpoint {
+  AtomicLogger::AtomicLogger* result_log;
+  std::filesystem::path directory;
+  std::string tag;
+  std::chrono::seconds interval;
+  std::chrono::steady_clock::time_point last_save;
+
+  std::mutex manifest_lock;
+  // Bytes of each field saved
+  std::map<std::string, std::size_t, std::less<>> saved;
+  std::map<std::string, std::shared_future<void>, std::less<>> pending;
+  // Declared last so queued saves finish before the state they use is destroyed
+  AsyncWriter::AsyncWriter writer;
+
+  void write_manifest();
+  [[nodiscard]] std::vector<std::shared_future<void>> take_pending();
+
+ public:
+  // Keep the checkpoint of `directory` if `resume` is set and it has the same tag,
+  // otherwise start an empty one. Periodic saves happen once `interval` elapsed
+  Checkpoint(AtomicLogger::AtomicLogger* result_log,
+             std::filesystem::path directory,
+             std::string tag,
+             std::chrono::seconds interval,
+             bool resume);
+
+  // Bytes of a field saved by the checkpoint resumed from, 0 if none
+  [[nodiscard]] std::size_t saved_bytes(std::string_view field);
+  // Read saved bytes of a field into the start of cells
+  void restore(std::string_view field, std::span<std::byte> cells);
+
+  // A periodic save is due
+  [[nodiscard]] bool is_due() const;
+  // Save the first `end` bytes of a field in the background, writing only those
+  // not saved yet. Cells must stay valid and unmodified until wait() returns
+  void save(std::string_view field, std::span<const std::byte> cells, std::size_t end);
+  // Wait for queued saves of a field, rethrowing their errors
+  void wait(std::string_view field);
+  // Wait for every queued save, ignoring errors, so cells can be released
+  void drain() noexcept;
+
+  // Delete the checkpoint once the results it leads to are written
+  void remove();
+};
+
+}  // namespace Computation
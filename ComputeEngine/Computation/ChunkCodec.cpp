@@ -0,0 +1,165 @@
+#include "ChunkCodec.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include "../Utilities/Compression.h"
+
+namespace Computation {
+
+namespace {
+
+// Quantized values are kept well inside the exactly representable integers
+constexpr auto max_quantized = 4503599627370496.0;  // 2^52
+
+std::vector<std::byte> compress_shuffled(std::span<const std::byte> bytes) {
+  return Compression::lz_compress(Compression::shuffle(bytes, sizeof(double)));
+}
+
+std::vector<std::byte> decompress_shuffled(std::span<const std::byte> bytes,
+                                           std::size_t raw_size) {
+  return Compression::unshuffle(Compression::lz_decompress(bytes, raw_size),
+                                sizeof(double));
+}
+
+EncodedChunk encode_lossless(std::vector<std::byte> cells) {
+  auto compressed = compress_shuffled(cells);
+  if (compressed.size() >= cells.size()) {
+    return EncodedChunk{ChunkEncoding::Raw, std::move(cells)};
+  }
+  return EncodedChunk{ChunkEncoding::Shuffled, std::move(compressed)};
+}
+
+std::optional<EncodedChunk> encode_quantized(std::span<const std::byte> cells,
+                                             std::size_t components,
+                                             const ChunkCodec& codec) {
+  const auto value_cnt = cells.size() / sizeof(double);
+  auto values = std::vector<double>(value_cnt);
+  std::memcpy(values.data(), cells.data(), value_cnt * sizeof(double));
+
+  auto max_abs = 0.0;
+  for (const auto value : values) {
+    if (not std::isfinite(value)) {
+      return std::nullopt;
+    }
+    max_abs = std::max(max_abs, std::abs(value));
+  }
+
+  // rounding to the nearest multiple of step is off by at most half a step
+  const auto tolerance =
+      codec.relative_tolerance ? codec.tolerance * max_abs : codec.tolerance;
+  const auto step = tolerance > 0.0 ? 2.0 * tolerance : 1.0;
+  if (max_abs / step >= max_quantized) {
+    return std::nullopt;
+  }
+
+  // neighbouring cells of a smooth field differ by a few steps, so deltas of the
+  // same component mostly have zero high bytes
+  auto deltas = std::vector<std::uint64_t>(value_cnt);
+  for (std::size_t id = 0; id < value_cnt; ++id) {
+    const auto quantized = std::llround(values[id] / step);
+    const auto previous =
+        id >= components ? std::llround(values[id - components] / step) : 0;
+    const auto delta = std::int64_t(quantized - previous);
+    deltas[id] = std::uint64_t(delta) << 1 ^ std::uint64_t(delta >> 63);
+  }
+
+  auto result = EncodedChunk{ChunkEncoding::Quantized,
+                             std::vector<std::byte>(sizeof(double))};
+  std::memcpy(result.bytes.data(), &step, sizeof(double));
+  const auto compressed = compress_shuffled(std::as_bytes(std::span(deltas)));
+  result.bytes.insert(result.bytes.end(), compressed.begin(), compressed.end());
+  return result;
+}
+
+}  // namespace
+
+ChunkCodec make_chunk_codec(const Config::ExecutionParameter& execution_parameter) {
+  return ChunkCodec{execution_parameter.compression,
+                    execution_parameter.compression_tolerance,
+                    execution_parameter.relative_tolerance};
+}
+
+nlohmann::json chunk_codec_json(const ChunkCodec& codec) {
+  auto result = nlohmann::json();
+  switch (codec.compression) {
+    case Config::Compression::None:
+      result["mode"] = "none";
+      break;
+    case Config::Compression::Lossless:
+      result["mode"] = "lossless";
+      break;
+    case Config::Compression::Lossy:
+      result["mode"] = "lossy";
+      result["tolerance"] = codec.tolerance;
+      result["relative_tolerance"] = codec.relative_tolerance;
+      break;
+  }
+  return result;
+}
+
+EncodedChunk encode_chunk(std::vector<std::byte> cells,
+                          std::size_t components,
+                          const ChunkCodec& codec) {
+  switch (codec.compression) {
+    case Config::Compression::None:
+      break;
+    case Config::Compression::Lossless:
+      return encode_lossless(std::move(cells));
+    case Config::Compression::Lossy: {
+      auto quantized = encode_quantized(cells, components, codec);
+      if (not quantized) {
+        return encode_lossless(std::move(cells));
+      }
+      if (quantized->bytes.size() >= cells.size()) {
+        return EncodedChunk{ChunkEncoding::Raw, std::move(cells)};
+      }
+      return std::move(*quantized);
+    }
+  }
+  return EncodedChunk{ChunkEncoding::Raw, std::move(cells)};
+}
+
+std::vector<std::byte> decode_chunk(std::span<const std::byte> bytes,
+                                    ChunkEncoding encoding,
+                                    std::size_t raw_size,
+                                    std::size_t components) {
+  switch (encoding) {
+    case ChunkEncoding::Raw:
+      if (bytes.size() != raw_size) {
+        throw std::runtime_error("Raw chunk has unexpected size");
+      }
+      return std::vector<std::byte>(bytes.begin(), bytes.end());
+    case ChunkEncoding::Shuffled:
+      return decompress_shuffled(bytes, raw_size);
+    case ChunkEncoding::Quantized: {
+      if (bytes.size() < sizeof(double)) {
+        throw std::runtime_error("Quantized chunk is truncated");
+      }
+      auto step = 0.0;
+      std::memcpy(&step, bytes.data(), sizeof(double));
+      const auto deltas_bytes =
+          decompress_shuffled(bytes.subspan(sizeof(double)), raw_size);
+
+      const auto value_cnt = raw_size / sizeof(double);
+      auto quantized = std::vector<std::int64_t>(value_cnt);
+      auto values = std::vector<double>(value_cnt);
+      for (std::size_t id = 0; id < value_cnt; ++id) {
+        auto delta = std::uint64_t();
+        std::memcpy(&delta, deltas_bytes.data() + id * sizeof(delta), sizeof(delta));
+        quantized[id] = std::int64_t(delta >> 1) ^ -std::int64_t(delta & 1);
+        if (id >= components) {
+          quantized[id] += quantized[id - components];
+        }
+        values[id] = double(quantized[id]) * step;
+      }
+
+      const auto result = std::as_bytes(std::span(values));
+      return std::vector<std::byte>(result.begin(), result.end());
+    }
+  }
+  throw std::runtime_error("Unknown chunk encoding");
+}
+
+}  // namespace Computation
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <span>
+#include <vector>
+#include "Config.h"
+
+namespace Computation {
+
+// How the bytes of one container chunk are stored
+enum class ChunkEncoding : std::uint64_t {
+  // cells as they are
+  Raw = 0,
+  // cells byte-shuffled by float64 component, then LZ compressed
+  Shuffled = 1,
+  // f64 quantization step, followed by quantized components delta coded along
+  // cells, zigzag mapped, byte-shuffled and LZ compressed
+  Quantized = 2,
+};
+
+struct ChunkCodec {
+  Config::Compression compression = Config::Compression::None;
+  double tolerance = 0.0;
+  bool relative_tolerance = false;
+};
+
+struct EncodedChunk {
+  ChunkEncoding encoding;
+  std::vector<std::byte> bytes;
+};
+
+[[nodiscard]] ChunkCodec make_chunk_codec(
+    const Config::ExecutionParameter& execution_parameter);
+[[nodiscard]] nlohmann::json chunk_codec_json(const ChunkCodec& codec);
+
+// Encode cells made of `components` float64 values each, chunks that would not get
+// smaller or can't be quantized within tolerance fall back to a lossless encoding
+[[nodiscard]] EncodedChunk encode_chunk(std::vector<std::byte> cells,
+                                        std::size_t components,
+                                        const ChunkCodec& codec);
+// Decode chunk back to `raw_size` bytes of cells
+[[nodiscard]] std::vector<std::byte> decode_chunk(std::span<const std::byte> bytes,
+                                                  ChunkEncoding encoding,
+                                                  std::size_t raw_size,
+                                                  std::size_t components);
+
+}  // namespace Computation
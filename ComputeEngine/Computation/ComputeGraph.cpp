@@ -0,0 +1,121 @@
+#include "ComputeGraph.h"
+#include <algorithm>
+#include <complex>
+#include <stdexcept>
+
+namespace Computation {
+
+std::size_t FieldNode::cell_bytes() const {
+  return this->complex ? sizeof(std::complex<double>) : sizeof(double);
+}
+
+std::string FieldNode::field_name(std::size_t component) const {
+  if (this->components.empty()) {
+    return std::string(this->name);
+  }
+  return std::string(this->name) + "_" + std::string(this->components[component]);
+}
+
+const std::vector<FieldNode>& field_nodes() {
+  static const auto nodes = [] {
+    using enum FieldId;
+    const auto vector = std::vector<std::string_view>{"x", "y", "z"};
+    const auto name = [](FieldId id) {
+      return Config::output_fields[std::size_t(id)];
+    };
+    return std::vector<FieldNode>{
+        {name(Pressure), FieldGrid::Pressure, true, {}, {}},
+        {name(PressureSquared), FieldGrid::Potential, false, {}, {Pressure}},
+        {name(PressureGradient), FieldGrid::Potential, true, vector, {Pressure}},
+        {name(PressureGradientSquared), FieldGrid::Potential, false, {}, {Pressure}},
+        {name(PressureLaplacian), FieldGrid::Potential, true, {}, {Pressure}},
+        {name(Potential), FieldGrid::Potential, false, {}, {Pressure}},
+        {name(AcousticIntensity), FieldGrid::Potential, false, vector, {Pressure}},
+        {name(KineticEnergyDensity), FieldGrid::Potential, false, {}, {Pressure}},
+        {name(PotentialEnergyDensity), FieldGrid::Potential, false, {}, {Pressure}},
+        {name(Force), FieldGrid::Force, false, vector, {Potential}},
+        {name(PotentialHessian),
+         FieldGrid::Force,
+         false,
+         {"xx", "yy", "zz", "xy", "xz", "yz"},
+         {Potential}}};
+  }();
+  return nodes;
+}
+
+const FieldNode& field_node(FieldId id) {
+  return field_nodes()[std::size_t(id)];
+}
+
+std::string_view to_string(FieldGrid grid) {
+  switch (grid) {
+    case FieldGrid::Pressure:
+      return "pressure";
+    case FieldGrid::Potential:
+      return "potential";
+    case FieldGrid::Force:
+      return "force";
+  }
+  return "unknown";
+}
+
+GraphPlan plan_graph(std::span<const std::string> outputs) {
+  const auto& nodes = field_nodes();
+  auto result = GraphPlan();
+  result.computed.resize(nodes.size());
+  result.exported.resize(nodes.size());
+  result.first_sweep.resize(nodes.size());
+  result.last_sweep.resize(nodes.size());
+
+  // outputs and everything they read, inputs are always on an earlier grid
+  auto pending = std::vector<std::size_t>();
+  for (const auto& output : outputs) {
+    const auto found =
+        std::find(Config::output_fields.begin(), Config::output_fields.end(), output);
+    if (found == Config::output_fields.end()) {
+      throw std::invalid_argument("Unknown output field: " + output);
+    }
+    const auto id = std::size_t(found - Config::output_fields.begin());
+    result.exported[id] = true;
+    pending.push_back(id);
+  }
+  while (not pending.empty()) {
+    const auto id = pending.back();
+    pending.pop_back();
+    if (result.computed[id]) {
+      continue;
+    }
+    result.computed[id] = true;
+    for (const auto input : nodes[id].inputs) {
+      pending.push_back(std::size_t(input));
+    }
+  }
+
+  // nodes of the same grid are fused into one sweep
+  for (const auto grid :
+       {FieldGrid::Pressure, FieldGrid::Potential, FieldGrid::Force}) {
+    auto sweep = GraphSweep{grid, {}};
+    for (std::size_t id = 0; id < nodes.size(); ++id) {
+      if (result.computed[id] and nodes[id].grid == grid) {
+        sweep.nodes.push_back(FieldId(id));
+        result.first_sweep[id] = result.sweeps.size();
+        result.last_sweep[id] = result.sweeps.size();
+      }
+    }
+    if (not sweep.nodes.empty()) {
+      result.sweeps.push_back(std::move(sweep));
+    }
+  }
+
+  for (std::size_t id = 0; id < nodes.size(); ++id) {
+    for (const auto input : nodes[id].inputs) {
+      if (result.computed[id]) {
+        auto& last = result.last_sweep[std::size_t(input)];
+        last = std::max(last, result.first_sweep[id]);
+      }
+    }
+  }
+  return result;
+}
+
+}  // namespace Computation
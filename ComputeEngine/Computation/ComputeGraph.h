@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Config.h"
+
+namespace Computation {
+
+// Grids of a whole box run, each one differentiated into the next
+enum class FieldGrid { Pressure, Potential, Force };
+
+// Fields the engine computes, in the order of Config::output_fields
+enum class FieldId : std::size_t {
+  Pressure,
+  PressureSquared,
+  PressureGradient,
+  PressureGradientSquared,
+  PressureLaplacian,
+  Potential,
+  AcousticIntensity,
+  KineticEnergyDensity,
+  PotentialEnergyDensity,
+  Force,
+  PotentialHessian
+};
+
+struct FieldNode {
+  std::string_view name;
+  FieldGrid grid;
+  // Components are complex128 rather than float64
+  bool complex;
+  // Suffixes of the fields exported for each component, empty for a scalar field
+  std::vector<std::string_view> components;
+  // Nodes of the previous grid the stencil of this node reads
+  std::vector<FieldId> inputs;
+
+  [[nodiscard]] std::size_t component_count() const {
+    return components.empty() ? 1 : components.size();
+  }
+  // Bytes of one cell of one component
+  [[nodiscard]] std::size_t cell_bytes() const;
+  // Name of the exported field of a component
+  [[nodiscard]] std::string field_name(std::size_t component) const;
+};
+
+// Every node, indexed by FieldId
+[[nodiscard]] const std::vector<FieldNode>& field_nodes();
+[[nodiscard]] const FieldNode& field_node(FieldId id);
+[[nodiscard]] std::string_view to_string(FieldGrid grid);
+
+// One pass over a grid computing every node it holds, fused so cells read by
+// several of them are loaded and differentiated once
+struct GraphSweep {
+  FieldGrid grid;
+  std::vector<FieldId> nodes;
+};
+
+/* Minimal evaluation of a set of output fields.
+ *
+ * Only the outputs and the nodes they read are computed, one sweep per grid any
+ * of them lives on, in grid order as each grid reads only the one before it.
+ * Every node is released after the last sweep reading it, and exported then if
+ * it is an output, so an intermediate is gone as soon as it is no longer read. */
+struct GraphPlan {
+  std::vector<GraphSweep> sweeps;
+  // Indexed by FieldId: whether a node is computed and exported, and the sweeps
+  // computing it and reading it last
+  std::vector<bool> computed;
+  std::vector<bool> exported;
+  std::vector<std::size_t> first_sweep;
+  std::vector<std::size_t> last_sweep;
+};
+
+// Plan the evaluation of fields named in Config::output_fields, throws
+// std::invalid_argument for other names
+[[nodiscard]] GraphPlan plan_graph(std::span<const std::string> outputs);
+
+}  // namespace Computation
@@ -1,4 +1,5 @@
 #include "Config.h"
+#include <stdexcept>
 
 namespace JSONConvert {
 
@@ -38,6 +39,8 @@ Config::SimulationParameter to_simulation_parameter(const nlohmann::json& json)
   result.particle_wave_speed = json.at("particle_wave_speed").get<double>();
   result.assume_large_particle_density =
       json.at("assume_large_particle_density").get<bool>();
+  result.differentiation_order = json.value("differentiation_order", 2);
+  result.frequencies = json.value("frequencies", result.frequencies);
   return result;
 }
 nlohmann::json from_simulation_parameter(
@@ -54,6 +57,318 @@ nlohmann::json from_simulation_parameter(
   result["particle_wave_speed"] = simulation_parameter.particle_wave_speed;
   result["assume_large_particle_density"] =
       simulation_parameter.assume_large_particle_density;
+  result["differentiation_order"] = simulation_parameter.differentiation_order;
+  // single frequency parameters keep their form, and so their cache keys
+  if (not simulation_parameter.frequencies.empty()) {
+    result["frequencies"] = simulation_parameter.frequencies;
+  }
+  return result;
+}
+
+Config::EvaluationTarget to_evaluation_target(const nlohmann::json& json) {
+  auto result = Config::EvaluationTarget();
+  result.name = json.at("name").get<std::string>();
+
+  const auto kind = json.at("kind").get<std::string>();
+  if (kind == "plane") {
+    result.kind = Config::EvaluationTarget::Kind::Plane;
+    result.origin = Vec3<double>(json.at("origin"));
+    result.axis_u = Vec3<double>(json.at("axis_u"));
+    result.axis_v = Vec3<double>(json.at("axis_v"));
+    result.count_u = json.at("count_u").get<std::size_t>();
+    result.count_v = json.at("count_v").get<std::size_t>();
+  } else if (kind == "polyline") {
+    result.kind = Config::EvaluationTarget::Kind::Polyline;
+    for (const auto& vertex : json.at("vertices")) {
+      result.vertices.emplace_back(vertex);
+    }
+    result.spacing = json.at("spacing").get<double>();
+  } else if (kind == "point_cloud") {
+    result.kind = Config::EvaluationTarget::Kind::PointCloud;
+    result.point_file = json.at("point_file").get<std::string>();
+  } else {
+    throw std::invalid_argument("Unknown evaluation target kind: " + kind);
+  }
+  return result;
+}
+nlohmann::json from_evaluation_target(
+    const Config::EvaluationTarget& evaluation_target) {
+  auto result = nlohmann::json();
+  result["name"] = evaluation_target.name;
+  switch (evaluation_target.kind) {
+    case Config::EvaluationTarget::Kind::Plane:
+      result["kind"] = "plane";
+      result["origin"] = evaluation_target.origin.to_json();
+      result["axis_u"] = evaluation_target.axis_u.to_json();
+      result["axis_v"] = evaluation_target.axis_v.to_json();
+      result["count_u"] = evaluation_target.count_u;
+      result["count_v"] = evaluation_target.count_v;
+      break;
+    case Config::EvaluationTarget::Kind::Polyline:
+      result["kind"] = "polyline";
+      result["vertices"] = nlohmann::json::array();
+      for (const auto& vertex : evaluation_target.vertices) {
+        result["vertices"].push_back(vertex.to_json());
+      }
+      result["spacing"] = evaluation_target.spacing;
+      break;
+    case Config::EvaluationTarget::Kind::PointCloud:
+      result["kind"] = "point_cloud";
+      result["point_file"] = evaluation_target.point_file;
+      break;
+  }
+  return result;
+}
+
+Config::ParticleParameter to_particle_parameter(const nlohmann::json& json) {
+  auto result = Config::ParticleParameter();
+  result.name = json.at("name").get<std::string>();
+  result.particle_radius = json.at("particle_radius").get<double>();
+  result.particle_density = json.value("particle_density", result.particle_density);
+  result.particle_wave_speed =
+      json.value("particle_wave_speed", result.particle_wave_speed);
+  result.assume_large_particle_density =
+      json.value("assume_large_particle_density", result.assume_large_particle_density);
+  return result;
+}
+nlohmann::json from_particle_parameter(
+    const Config::ParticleParameter& particle_parameter) {
+  auto result = nlohmann::json();
+  result["name"] = particle_parameter.name;
+  result["particle_radius"] = particle_parameter.particle_radius;
+  result["particle_density"] = particle_parameter.particle_density;
+  result["particle_wave_speed"] = particle_parameter.particle_wave_speed;
+  result["assume_large_particle_density"] =
+      particle_parameter.assume_large_particle_density;
+  return result;
+}
+
+Config::SweepParameter to_sweep_parameter(const nlohmann::json& json) {
+  auto result = Config::SweepParameter();
+  const auto parameter = json.value("parameter", std::string("none"));
+  if (parameter == "none") {
+    result.kind = Config::SweepParameter::Kind::None;
+  } else if (parameter == "frequency") {
+    result.kind = Config::SweepParameter::Kind::Frequency;
+  } else if (parameter == "particle_radius") {
+    result.kind = Config::SweepParameter::Kind::ParticleRadius;
+  } else if (parameter == "transducer_phase") {
+    result.kind = Config::SweepParameter::Kind::TransducerPhase;
+  } else if (parameter == "array_spacing") {
+    result.kind = Config::SweepParameter::Kind::ArraySpacing;
+  } else {
+    throw std::invalid_argument("Unknown sweep parameter: " + parameter);
+  }
+  result.transducer = json.value("transducer", result.transducer);
+  result.values = json.value("values", result.values);
+  result.begin = json.value("begin", result.begin);
+  result.end = json.value("end", result.end);
+  result.step = json.value("step", result.step);
+  return result;
+}
+nlohmann::json from_sweep_parameter(const Config::SweepParameter& sweep_parameter) {
+  auto result = nlohmann::json();
+  switch (sweep_parameter.kind) {
+    case Config::SweepParameter::Kind::None:
+      result["parameter"] = "none";
+      break;
+    case Config::SweepParameter::Kind::Frequency:
+      result["parameter"] = "frequency";
+      break;
+    case Config::SweepParameter::Kind::ParticleRadius:
+      result["parameter"] = "particle_radius";
+      break;
+    case Config::SweepParameter::Kind::TransducerPhase:
+      result["parameter"] = "transducer_phase";
+      break;
+    case Config::SweepParameter::Kind::ArraySpacing:
+      result["parameter"] = "array_spacing";
+      break;
+  }
+  result["transducer"] = sweep_parameter.transducer;
+  result["values"] = sweep_parameter.values;
+  result["begin"] = sweep_parameter.begin;
+  result["end"] = sweep_parameter.end;
+  result["step"] = sweep_parameter.step;
+  return result;
+}
+
+Config::ExecutionParameter to_execution_parameter(const nlohmann::json& json) {
+  auto result = Config::ExecutionParameter();
+  result.slab_streaming = json.value("slab_streaming", result.slab_streaming);
+  result.mapped_output = json.value("mapped_output", result.mapped_output);
+  result.async_export = json.value("async_export", result.async_export);
+  result.write_queue_depth = json.value("write_queue_depth", result.write_queue_depth);
+  result.direct_io = json.value("direct_io", result.direct_io);
+  const auto output_format = json.value("output_format", std::string("container"));
+  if (output_format == "container") {
+    result.output_format = Config::OutputFormat::Container;
+  } else if (output_format == "legacy") {
+    result.output_format = Config::OutputFormat::Legacy;
+  } else if (output_format == "stream") {
+    result.output_format = Config::OutputFormat::Stream;
+  } else if (output_format == "shared_memory") {
+    result.output_format = Config::OutputFormat::SharedMemory;
+  } else {
+    throw std::invalid_argument("Unknown output format: " + output_format);
+  }
+  result.container_chunk_edge =
+      json.value("container_chunk_edge", result.container_chunk_edge);
+  result.output_stream = json.value("output_stream", result.output_stream);
+  result.shared_memory_name =
+      json.value("shared_memory_name", result.shared_memory_name);
+  result.shared_memory_size =
+      json.value("shared_memory_size", result.shared_memory_size);
+  const auto compression = json.value("compression", std::string("none"));
+  if (compression == "none") {
+    result.compression = Config::Compression::None;
+  } else if (compression == "lossless") {
+    result.compression = Config::Compression::Lossless;
+  } else if (compression == "lossy") {
+    result.compression = Config::Compression::Lossy;
+  } else {
+    throw std::invalid_argument("Unknown compression: " + compression);
+  }
+  result.compression_tolerance =
+      json.value("compression_tolerance", result.compression_tolerance);
+  result.relative_tolerance =
+      json.value("relative_tolerance", result.relative_tolerance);
+  result.pyramid_levels = json.value("pyramid_levels", result.pyramid_levels);
+  const auto pyramid_reduction =
+      json.value("pyramid_reduction", std::string("average"));
+  if (pyramid_reduction == "average") {
+    result.pyramid_reduction = Config::PyramidReduction::Average;
+  } else if (pyramid_reduction == "decimate") {
+    result.pyramid_reduction = Config::PyramidReduction::Decimate;
+  } else {
+    throw std::invalid_argument("Unknown pyramid reduction: " + pyramid_reduction);
+  }
+  result.vtk_export = json.value("vtk_export", result.vtk_export);
+  const auto vtk_pressure = json.value("vtk_pressure", std::string("magnitude_phase"));
+  if (vtk_pressure == "magnitude_phase") {
+    result.vtk_pressure = Config::VtkPressure::MagnitudePhase;
+  } else if (vtk_pressure == "real_imaginary") {
+    result.vtk_pressure = Config::VtkPressure::RealImaginary;
+  } else {
+    throw std::invalid_argument("Unknown VTK pressure form: " + vtk_pressure);
+  }
+  result.checkpoint = json.value("checkpoint", result.checkpoint);
+  result.checkpoint_interval =
+      json.value("checkpoint_interval", result.checkpoint_interval);
+  result.resume = json.value("resume", result.resume);
+  result.result_cache = json.value("result_cache", result.result_cache);
+  result.result_cache_size = json.value("result_cache_size", result.result_cache_size);
+  result.export_intensity = json.value("export_intensity", result.export_intensity);
+  for (const auto& particle : json.value("particles", nlohmann::json::array())) {
+    result.particles.push_back(to_particle_parameter(particle));
+  }
+  result.outputs = json.value("outputs", result.outputs);
+  for (const auto& target : json.value("targets", nlohmann::json::array())) {
+    result.targets.push_back(to_evaluation_target(target));
+  }
+  if (json.contains("sweep")) {
+    result.sweep = to_sweep_parameter(json.at("sweep"));
+  }
+  result.sweep_batch = json.value("sweep_batch", result.sweep_batch);
+  result.incoherent_sum = json.value("incoherent_sum", result.incoherent_sum);
+  const auto parallel_backend = json.value("parallel_backend", std::string("openmp"));
+  if (parallel_backend == "openmp") {
+    result.parallel_backend = Config::ParallelBackend::OpenMP;
+  } else if (parallel_backend == "pool") {
+    result.parallel_backend = Config::ParallelBackend::Pool;
+  } else if (parallel_backend == "std") {
+    result.parallel_backend = Config::ParallelBackend::Standard;
+  } else {
+    throw std::invalid_argument("Unknown parallel backend: " + parallel_backend);
+  }
+  return result;
+}
+nlohmann::json from_execution_parameter(
+    const Config::ExecutionParameter& execution_parameter) {
+  auto result = nlohmann::json();
+  result["slab_streaming"] = execution_parameter.slab_streaming;
+  result["mapped_output"] = execution_parameter.mapped_output;
+  result["async_export"] = execution_parameter.async_export;
+  result["write_queue_depth"] = execution_parameter.write_queue_depth;
+  result["direct_io"] = execution_parameter.direct_io;
+  switch (execution_parameter.output_format) {
+    case Config::OutputFormat::Container:
+      result["output_format"] = "container";
+      break;
+    case Config::OutputFormat::Legacy:
+      result["output_format"] = "legacy";
+      break;
+    case Config::OutputFormat::Stream:
+      result["output_format"] = "stream";
+      break;
+    case Config::OutputFormat::SharedMemory:
+      result["output_format"] = "shared_memory";
+      break;
+  }
+  result["container_chunk_edge"] = execution_parameter.container_chunk_edge;
+  result["output_stream"] = execution_parameter.output_stream;
+  result["shared_memory_name"] = execution_parameter.shared_memory_name;
+  result["shared_memory_size"] = execution_parameter.shared_memory_size;
+  switch (execution_parameter.compression) {
+    case Config::Compression::None:
+      result["compression"] = "none";
+      break;
+    case Config::Compression::Lossless:
+      result["compression"] = "lossless";
+      break;
+    case Config::Compression::Lossy:
+      result["compression"] = "lossy";
+      break;
+  }
+  result["compression_tolerance"] = execution_parameter.compression_tolerance;
+  result["relative_tolerance"] = execution_parameter.relative_tolerance;
+  result["pyramid_levels"] = execution_parameter.pyramid_levels;
+  switch (execution_parameter.pyramid_reduction) {
+    case Config::PyramidReduction::Average:
+      result["pyramid_reduction"] = "average";
+      break;
+    case Config::PyramidReduction::Decimate:
+      result["pyramid_reduction"] = "decimate";
+      break;
+  }
+  result["vtk_export"] = execution_parameter.vtk_export;
+  switch (execution_parameter.vtk_pressure) {
+    case Config::VtkPressure::MagnitudePhase:
+      result["vtk_pressure"] = "magnitude_phase";
+      break;
+    case Config::VtkPressure::RealImaginary:
+      result["vtk_pressure"] = "real_imaginary";
+      break;
+  }
+  result["checkpoint"] = execution_parameter.checkpoint;
+  result["checkpoint_interval"] = execution_parameter.checkpoint_interval;
+  result["resume"] = execution_parameter.resume;
+  result["result_cache"] = execution_parameter.result_cache;
+  result["result_cache_size"] = execution_parameter.result_cache_size;
+  result["export_intensity"] = execution_parameter.export_intensity;
+  result["particles"] = nlohmann::json::array();
+  for (const auto& particle : execution_parameter.particles) {
+    result["particles"].push_back(from_particle_parameter(particle));
+  }
+  result["outputs"] = execution_parameter.outputs;
+  result["targets"] = nlohmann::json::array();
+  for (const auto& target : execution_parameter.targets) {
+    result["targets"].push_back(from_evaluation_target(target));
+  }
+  result["sweep"] = from_sweep_parameter(execution_parameter.sweep);
+  result["sweep_batch"] = execution_parameter.sweep_batch;
+  result["incoherent_sum"] = execution_parameter.incoherent_sum;
+  switch (execution_parameter.parallel_backend) {
+    case Config::ParallelBackend::OpenMP:
+      result["parallel_backend"] = "openmp";
+      break;
+    case Config::ParallelBackend::Pool:
+      result["parallel_backend"] = "pool";
+      break;
+    case Config::ParallelBackend::Standard:
+      result["parallel_backend"] = "std";
+      break;
+  }
   return result;
 }
 
@@ -1,8 +1,15 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
 #include <nlohmann/json.hpp>
 #include <numbers>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <vector>
 #include "Vec3.h"
 
 namespace Config {
@@ -36,11 +43,24 @@ struct SimulationParameter {
 
   bool assume_large_particle_density = true;
 
+  // Accuracy order of the central difference used for gradients (2, 4 or 6)
+  int differentiation_order = 2;
+
+  // Evaluate each of these frequencies in one run instead of `frequency` if not
+  // empty, sharing the geometry of every cell and transducer between them
+  std::vector<double> frequencies;
+
   [[nodiscard]] std::string checkInvalidParameter() const {
     if (this->cell_size <= 0) {
       return "Cell size is not positive";
     }
-    if (this->frequency <= 0) {
+    if (this->differentiation_order != 2 and this->differentiation_order != 4 and
+        this->differentiation_order != 6) {
+      return "Differentiation order is not 2, 4 or 6";
+    }
+    if (this->frequency <= 0 or
+        std::any_of(this->frequencies.begin(), this->frequencies.end(),
+                    [](double value) { return value <= 0; })) {
       return "Frequency is not positive";
     }
     if (this->air_density <= 0) {
@@ -62,6 +82,11 @@ struct SimulationParameter {
     return std::string();
   }
 
+  // Cells needed on each side of a point to differentiate at that point
+  [[nodiscard]] constexpr std::size_t stencil_padding() const {
+    return std::size_t(this->differentiation_order / 2);
+  }
+
   [[nodiscard]] constexpr double particle_volume() const {
     return (4.0 / 3.0) * std::numbers::pi * this->particle_radius *
            this->particle_radius * this->particle_radius;
@@ -99,6 +124,464 @@ struct SimulationParameter {
   }
 };
 
+// Name made only of letters, digits and '-', so it can be part of a file name
+[[nodiscard]] inline bool is_file_name_safe(std::string_view name) {
+  return std::all_of(name.begin(), name.end(), [](char c) {
+    return (c >= 'A' and c <= 'Z') or (c >= 'a' and c <= 'z') or
+           (c >= '0' and c <= '9') or c == '-';
+  });
+}
+
+struct EvaluationTarget {
+  enum class Kind { Plane, Polyline, PointCloud };
+
+  std::string name;
+  Kind kind = Kind::Plane;
+
+  // Plane: points at origin + axis_u * i / (count_u - 1) + axis_v * j / (count_v - 1)
+  Vec3<double> origin = {0.0, 0.0, 0.0};
+  Vec3<double> axis_u = {0.0, 0.0, 0.0};
+  Vec3<double> axis_v = {0.0, 0.0, 0.0};
+  std::size_t count_u = 1, count_v = 1;
+
+  // Polyline: vertices joined by segments sampled every `spacing`
+  std::vector<Vec3<double>> vertices;
+  double spacing = 0.0;
+
+  // Point cloud: binary file of packed native double x, y, z triples
+  std::string point_file;
+
+  [[nodiscard]] std::string checkInvalidParameter() const {
+    if (this->name.empty()) {
+      return "Target name is empty";
+    }
+    // the name ends up in field and file names as target_<name>
+    if (not is_file_name_safe(this->name)) {
+      return "Target name may only contain letters, digits and '-'";
+    }
+    if (this->kind == Kind::Plane and (this->count_u == 0 or this->count_v == 0)) {
+      return "Plane sample count is not positive";
+    }
+    if (this->kind == Kind::Polyline and this->vertices.size() < 2) {
+      return "Polyline has less than 2 vertices";
+    }
+    if (this->kind == Kind::Polyline and this->spacing <= 0) {
+      return "Polyline spacing is not positive";
+    }
+    if (this->kind == Kind::PointCloud and this->point_file.empty()) {
+      return "Point cloud file is empty";
+    }
+
+    return std::string();
+  }
+};
+
+// Fields a whole box run can be asked to export, components of vector fields are
+// exported as `<name>_x` and so on (see Computation::field_nodes)
+constexpr auto output_fields = std::array<std::string_view, 11>{
+    "pressure",
+    "pressure_squared",
+    "pressure_gradient",
+    "pressure_gradient_squared",
+    "pressure_laplacian",
+    "potential",
+    "acoustic_intensity",
+    "kinetic_energy_density",
+    "potential_energy_density",
+    "force",
+    "potential_hessian"};
+
+// Particle whose potential and force are derived from the pressure of a run
+struct ParticleParameter {
+  std::string name;
+
+  double particle_radius = 0.0, particle_density = 0.0, particle_wave_speed = 0.0;
+  bool assume_large_particle_density = true;
+
+  [[nodiscard]] std::string checkInvalidParameter() const {
+    if (this->name.empty()) {
+      return "Particle name is empty";
+    }
+    // the name ends up in field and file names as potential_<name> and
+    // force_<name>_x, so it must not read as a path, an axis or a built-in field
+    if (not is_file_name_safe(this->name)) {
+      return "Particle name may only contain letters, digits and '-'";
+    }
+    if (this->name == "x" or this->name == "y" or this->name == "z" or
+        std::find(output_fields.begin(), output_fields.end(), this->name) !=
+            output_fields.end()) {
+      return "Particle name is a field or axis name: " + this->name;
+    }
+    if (this->particle_radius <= 0) {
+      return "Particle radius is not positive";
+    }
+    if (not assume_large_particle_density and this->particle_density <= 0) {
+      return "Particle density is not positive";
+    }
+    if (not assume_large_particle_density and this->particle_wave_speed <= 0) {
+      return "Particle wave speed is not positive";
+    }
+
+    return std::string();
+  }
+
+  // Parameters of the same simulation with this particle in place of its own
+  [[nodiscard]] SimulationParameter applied_to(
+      const SimulationParameter& simulation_parameter) const {
+    auto result = simulation_parameter;
+    result.particle_radius = this->particle_radius;
+    result.particle_density = this->particle_density;
+    result.particle_wave_speed = this->particle_wave_speed;
+    result.assume_large_particle_density = this->assume_large_particle_density;
+    return result;
+  }
+};
+
+// Parameter varied across the points of a sweep, each point is a complete run
+struct SweepParameter {
+  // Frequency in Hz, particle radius in m, phase shift in rad of one transducer, or
+  // spacing of the transducer array as a factor of its configured layout, scaled
+  // about the centroid of the transducers
+  enum class Kind { None, Frequency, ParticleRadius, TransducerPhase, ArraySpacing };
+
+  Kind kind = Kind::None;
+  // Id of the transducer whose phase is swept
+  std::string transducer;
+
+  // Points are `values` if not empty, otherwise begin, begin + step, ... up to end
+  std::vector<double> values;
+  double begin = 0.0, end = 0.0, step = 0.0;
+
+  [[nodiscard]] std::vector<double> points() const {
+    if (this->kind == Kind::None or not this->values.empty()) {
+      return this->values;
+    }
+    // tolerance keeps end in the range despite rounding of the step
+    const auto count = std::size_t(std::floor((this->end - this->begin) / this->step +
+                                              1e-9)) + 1;
+    auto result = std::vector<double>();
+    for (std::size_t i = 0; i < count; ++i) {
+      result.push_back(this->begin + double(i) * this->step);
+    }
+    return result;
+  }
+
+  [[nodiscard]] std::string checkInvalidParameter() const {
+    if (this->kind == Kind::None) {
+      return std::string();
+    }
+    if (this->kind == Kind::TransducerPhase and this->transducer.empty()) {
+      return "Swept transducer is empty";
+    }
+    if (this->values.empty() and
+        not(this->step > 0.0 and this->end >= this->begin)) {
+      return "Sweep range is not increasing";
+    }
+    if (this->values.empty() and (this->end - this->begin) / this->step > 10000.0) {
+      return "Sweep has more than 10000 points";
+    }
+    for (const auto value : this->points()) {
+      if (this->kind != Kind::TransducerPhase and not(value > 0.0)) {
+        return "Swept value is not positive";
+      }
+    }
+    return std::string();
+  }
+
+  // Set the swept parameter of a run to `value`, throws std::invalid_argument if
+  // the swept transducer does not exist
+  void apply(double value,
+             std::vector<Transducer>& transducers,
+             SimulationParameter& simulation_parameter) const {
+    switch (this->kind) {
+      case Kind::None:
+        break;
+      case Kind::Frequency:
+        simulation_parameter.frequency = value;
+        break;
+      case Kind::ParticleRadius:
+        simulation_parameter.particle_radius = value;
+        break;
+      case Kind::TransducerPhase: {
+        const auto found =
+            std::find_if(transducers.begin(), transducers.end(),
+                         [&](const Transducer& t) { return t.id == this->transducer; });
+        if (found == transducers.end()) {
+          throw std::invalid_argument("Swept transducer not found: " +
+                                      this->transducer);
+        }
+        found->phase_shift = value;
+        break;
+      }
+      case Kind::ArraySpacing: {
+        if (transducers.empty()) {
+          break;
+        }
+        auto centroid = Vec3<double>{0.0, 0.0, 0.0};
+        for (const auto& item : transducers) {
+          centroid = centroid + item.position;
+        }
+        centroid = centroid * (1.0 / double(transducers.size()));
+        // targets move along, so every transducer keeps its direction
+        for (auto& item : transducers) {
+          const auto position = centroid + (item.position - centroid) * value;
+          item.target = item.target + (position - item.position);
+          item.position = position;
+        }
+        break;
+      }
+    }
+  }
+};
+
+// Container holds every field as chunks of one file, legacy writes one raw file per
+// field and a separate metadata.json, stream writes framed records to stdout or a
+// named pipe, and shared memory appends them to a ring a local consumer maps
+enum class OutputFormat { Container, Legacy, Stream, SharedMemory };
+
+// Lossless shuffles bytes of each chunk and compresses them, lossy quantizes values
+// to a tolerance first
+enum class Compression { None, Lossless, Lossy };
+
+// Downsampled levels either average the cells they cover or keep the first one
+enum class PyramidReduction { Average, Decimate };
+
+// Complex pressure is exported to VTK as two scalar arrays of either form
+enum class VtkPressure { MagnitudePhase, RealImaginary };
+
+// Parallel loops are scheduled by OpenMP, by the thread pool of the engine or by the
+// parallel algorithms of the standard library
+enum class ParallelBackend { OpenMP, Pool, Standard };
+
+struct ExecutionParameter {
+  // Sweep the domain in x-slabs and write results as they are produced, so memory
+  // is bounded by slab size rather than grid size
+  bool slab_streaming = false;
+
+  // Map result files into memory and compute directly into them, so exporting
+  // only flushes the mapping (ignored when streaming slabs, can not be combined
+  // with VTK or pyramid export)
+  bool mapped_output = false;
+
+  // Write each result in the background as soon as its stage is done, overlapping
+  // export with the stages that follow
+  bool async_export = true;
+
+  // Result files and containers are written as chunks by this many concurrent
+  // positional writes, optionally bypassing the page cache (not for legacy files
+  // streamed one slab at a time, whose slabs are not aligned for it)
+  std::size_t write_queue_depth = 4;
+  bool direct_io = false;
+
+  // Results are written into a single chunked container unless legacy files are
+  // requested, chunks are cubes of this many cells per edge
+  OutputFormat output_format = OutputFormat::Container;
+  std::size_t container_chunk_edge = 32;
+
+  // Stream output goes to this named pipe, or to stdout for "-"
+  std::string output_stream = "-";
+  // Shared memory output goes to the region of this name, its ring holds this many
+  // MiB of records
+  std::string shared_memory_name = "acoustic_simulator";
+  std::size_t shared_memory_size = 256;
+
+  // Container chunks are compressed independently, lossy compression keeps every
+  // value within the tolerance, either absolute or relative to the largest
+  // magnitude of the chunk
+  Compression compression = Compression::None;
+  double compression_tolerance = 1e-6;
+  bool relative_tolerance = false;
+
+  // Write this many downsampled levels of every field next to full resolution,
+  // level k is coarser by 2^k along each axis
+  std::size_t pyramid_levels = 0;
+  PyramidReduction pyramid_reduction = PyramidReduction::Average;
+
+  // Also write every grid as a VTK ImageData file (.vti) with raw appended data
+  bool vtk_export = false;
+  VtkPressure vtk_pressure = VtkPressure::MagnitudePhase;
+
+  // Save intermediate fields into `checkpoint` of the export directory after each
+  // stage, and every `checkpoint_interval` seconds within the pressure stage, so
+  // a run with `resume` set continues from the last save of the same parameters.
+  // Only whole box runs of the default outputs are checkpointed
+  bool checkpoint = false;
+  std::size_t checkpoint_interval = 300;
+  bool resume = false;
+
+  // Keep results in this folder keyed by a hash of everything they depend on, and
+  // link them into the export directory instead of computing them again when the
+  // same parameters are run later. Least recently used results are removed once the
+  // cache exceeds `result_cache_size` MiB. Disabled if empty
+  std::string result_cache;
+  std::size_t result_cache_size = 16384;
+
+  // Also export |p|^2 and |grad p|^2 of whole box runs on the potential grid as
+  // `pressure_squared` and `pressure_gradient_squared`, the potential of any
+  // particle is 2 k1 |p|^2 - 2 k2 |grad p|^2 of them
+  bool export_intensity = false;
+  // Also write potential and force of each of these particles, derived from the
+  // same pressure (resident processing only)
+  std::vector<ParticleParameter> particles;
+
+  // Export only these fields of `output_fields`, computing just what they need,
+  // instead of pressure, potential and force if not empty
+  std::vector<std::string> outputs;
+
+  // Evaluate only these targets instead of the whole simulation box if not empty
+  std::vector<EvaluationTarget> targets;
+
+  // Also export the sum over the frequencies of a multi-frequency run of |p|^2,
+  // potential and force, the time average of products of different frequencies
+  // vanishes so these add up incoherently
+  bool incoherent_sum = false;
+
+  // Run every point of this sweep as one job, into one result folder per point.
+  // Pressure of `sweep_batch` points is evaluated in one pass sharing the geometry
+  // of each cell and transducer
+  SweepParameter sweep;
+  std::size_t sweep_batch = 4;
+
+  // Backend scheduling the parallel loops of the run, results do not depend on it
+  ParallelBackend parallel_backend = ParallelBackend::OpenMP;
+
+  [[nodiscard]] std::string checkInvalidParameter() const {
+    if (this->write_queue_depth == 0) {
+      return "Write queue depth is not positive";
+    }
+    if (this->direct_io and this->slab_streaming and
+        this->output_format == OutputFormat::Legacy) {
+      return "Direct I/O requires container output when streaming slabs";
+    }
+    if (this->container_chunk_edge == 0) {
+      return "Container chunk edge is not positive";
+    }
+    if (this->compression != Compression::None and
+        this->output_format != OutputFormat::Container) {
+      return "Compression requires container output";
+    }
+    if (this->output_format == OutputFormat::Stream and this->output_stream.empty()) {
+      return "Output stream is empty";
+    }
+    if (this->output_format == OutputFormat::SharedMemory and
+        (this->shared_memory_name.empty() or
+         this->shared_memory_name.find('/') != std::string::npos)) {
+      return "Shared memory name is empty or contains '/'";
+    }
+    if (this->output_format == OutputFormat::SharedMemory and
+        this->shared_memory_size == 0) {
+      return "Shared memory size is not positive";
+    }
+    if ((this->checkpoint or this->resume) and this->slab_streaming) {
+      return "Checkpoints require resident processing";
+    }
+    if ((this->checkpoint or this->resume) and
+        (not this->targets.empty() or not this->outputs.empty())) {
+      return "Checkpoints require whole box processing of the default outputs";
+    }
+    if (not this->result_cache.empty() and this->result_cache_size == 0) {
+      return "Result cache size is not positive";
+    }
+    if (this->pyramid_levels > 16) {
+      return "Pyramid levels exceed 16";
+    }
+    // mapped fields are only flushed, never passed through the sink, so exports
+    // derived from their cells would stay empty
+    const auto mapped_fields = this->mapped_output and not this->slab_streaming and
+                               this->output_format == OutputFormat::Legacy;
+    if (mapped_fields and this->vtk_export) {
+      return "VTK export does not support memory-mapped output";
+    }
+    if (mapped_fields and this->pyramid_levels > 0) {
+      return "Pyramid levels do not support memory-mapped output";
+    }
+    if (this->compression == Compression::Lossy and
+        not(this->compression_tolerance > 0.0)) {
+      return "Compression tolerance is not positive";
+    }
+    if (not this->particles.empty() and this->slab_streaming) {
+      return "Particle sets require resident processing";
+    }
+    for (std::size_t i = 0; i < this->particles.size(); ++i) {
+      const auto invalid_particle = this->particles[i].checkInvalidParameter();
+      if (not invalid_particle.empty()) {
+        return invalid_particle;
+      }
+      for (std::size_t j = 0; j < i; ++j) {
+        if (this->particles[i].name == this->particles[j].name) {
+          return "Particle names are not unique";
+        }
+      }
+    }
+    for (const auto& output : this->outputs) {
+      if (std::find(output_fields.begin(), output_fields.end(), output) ==
+          output_fields.end()) {
+        return "Unknown output field: " + output;
+      }
+    }
+    if (not this->outputs.empty() and
+        (this->slab_streaming or not this->targets.empty())) {
+      return "Output selection requires resident whole box processing";
+    }
+    if (not this->outputs.empty() and
+        (this->export_intensity or not this->particles.empty())) {
+      return "Intensity export and particle sets require the default outputs";
+    }
+    for (std::size_t i = 0; i < this->targets.size(); ++i) {
+      const auto invalid_target = this->targets[i].checkInvalidParameter();
+      if (not invalid_target.empty()) {
+        return invalid_target;
+      }
+      for (std::size_t j = 0; j < i; ++j) {
+        if (this->targets[i].name == this->targets[j].name) {
+          return "Target names are not unique";
+        }
+      }
+    }
+    const auto invalid_sweep = this->sweep.checkInvalidParameter();
+    if (not invalid_sweep.empty()) {
+      return invalid_sweep;
+    }
+    if (this->sweep.kind != SweepParameter::Kind::None and
+        (this->slab_streaming or not this->targets.empty() or
+         not this->outputs.empty() or not this->particles.empty() or
+         this->export_intensity or this->checkpoint or this->resume)) {
+      return "Sweeps require resident processing of the default outputs";
+    }
+    if (this->sweep.kind != SweepParameter::Kind::None and
+        this->output_format != OutputFormat::Container and
+        this->output_format != OutputFormat::Legacy) {
+      return "Sweeps require container or legacy output";
+    }
+    if (this->incoherent_sum and this->sweep.kind != SweepParameter::Kind::None) {
+      return "Incoherent sums require a single run";
+    }
+    if (this->sweep_batch == 0) {
+      return "Sweep batch is not positive";
+    }
+
+    return std::string();
+  }
+};
+
+// Check options of the execution parameter that depend on the simulation parameter
+[[nodiscard]] inline std::string checkInvalidCombination(
+    const SimulationParameter& simulation_parameter,
+    const ExecutionParameter& execution_parameter) {
+  // frequencies are only evaluated together by resident runs of the default outputs
+  if (not simulation_parameter.frequencies.empty() and
+      (execution_parameter.slab_streaming or not execution_parameter.targets.empty() or
+       not execution_parameter.outputs.empty() or
+       not execution_parameter.particles.empty() or
+       execution_parameter.export_intensity or execution_parameter.checkpoint or
+       execution_parameter.resume or
+       execution_parameter.sweep.kind != SweepParameter::Kind::None)) {
+    return "Multiple frequencies require resident processing of the default outputs";
+  }
+
+  return std::string();
+}
+
 }  // namespace Config
 
 namespace JSONConvert {
@@ -111,4 +594,22 @@ namespace JSONConvert {
 [[nodiscard]] nlohmann::json from_simulation_parameter(
     const Config::SimulationParameter& simulation_parameter);
 
+[[nodiscard]] Config::EvaluationTarget to_evaluation_target(const nlohmann::json& json);
+[[nodiscard]] nlohmann::json from_evaluation_target(
+    const Config::EvaluationTarget& evaluation_target);
+
+[[nodiscard]] Config::ParticleParameter to_particle_parameter(
+    const nlohmann::json& json);
+[[nodiscard]] nlohmann::json from_particle_parameter(
+    const Config::ParticleParameter& particle_parameter);
+
+[[nodiscard]] Config::SweepParameter to_sweep_parameter(const nlohmann::json& json);
+[[nodiscard]] nlohmann::json from_sweep_parameter(
+    const Config::SweepParameter& sweep_parameter);
+
+[[nodiscard]] Config::ExecutionParameter to_execution_parameter(
+    const nlohmann::json& json);
+[[nodiscard]] nlohmann::json from_execution_parameter(
+    const Config::ExecutionParameter& execution_parameter);
+
 }  // namespace JSONConvert
\ No newline at end of file
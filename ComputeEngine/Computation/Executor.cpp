@@ -0,0 +1,340 @@
+#include "Executor.h"
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <utility>
+#include <version>
+
+#ifdef __cpp_lib_parallel_algorithm
+#include <execution>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace Computation {
+
+namespace {
+
+thread_local const Executor* thread_executor = nullptr;
+
+// First exception thrown by the chunks of a loop, chunks starting after it are
+// skipped
+class LoopFailure {
+  std::atomic<bool> failed = false;
+  std::mutex error_lock;
+  std::exception_ptr error;
+
+ public:
+  template <typename Chunk>
+  void run(const Chunk& chunk) {
+    if (this->failed.load(std::memory_order_relaxed)) {
+      return;
+    }
+    try {
+      chunk();
+    } catch (...) {
+      const auto scoped_lock = std::scoped_lock(this->error_lock);
+      if (not this->error) {
+        this->error = std::current_exception();
+      }
+      this->failed.store(true);
+    }
+  }
+
+  void rethrow() {
+    if (this->error) {
+      std::rethrow_exception(this->error);
+    }
+  }
+};
+
+void run_serial(std::size_t chunk_count,
+                const std::function<void(std::size_t)>& chunk_body) {
+  for (std::size_t chunk = 0; chunk < chunk_count; ++chunk) {
+    chunk_body(chunk);
+  }
+}
+
+void run_openmp(const Executor& executor,
+                std::size_t chunk_count,
+                const std::function<void(std::size_t)>& chunk_body) {
+  auto failure = LoopFailure();
+  // OpenMP 2.0 of MSVC only takes signed loop counters, every other loop is indexed
+  // by std::size_t through this one
+  const auto chunk_lpn = int64_t(chunk_count);
+#pragma omp parallel for schedule(dynamic) num_threads(int(executor.thread_count))
+  for (int64_t chunk = 0; chunk < chunk_lpn; ++chunk) {
+    failure.run([&]() {
+      const auto executor_scope = ExecutorScope(executor);
+      chunk_body(std::size_t(chunk));
+    });
+  }
+  failure.rethrow();
+}
+
+void run_standard([[maybe_unused]] const Executor& executor,
+                  std::size_t chunk_count,
+                  const std::function<void(std::size_t)>& chunk_body) {
+#ifdef __cpp_lib_parallel_algorithm
+  auto failure = LoopFailure();
+  auto chunks = std::vector<std::size_t>(chunk_count);
+  std::iota(chunks.begin(), chunks.end(), std::size_t(0));
+  std::for_each(std::execution::par, chunks.begin(), chunks.end(),
+                [&](std::size_t chunk) {
+                  failure.run([&]() {
+                    const auto executor_scope = ExecutorScope(executor);
+                    chunk_body(chunk);
+                  });
+                });
+  failure.rethrow();
+#else
+  // standard libraries without parallel algorithms run loops on the calling thread
+  run_serial(chunk_count, chunk_body);
+#endif
+}
+
+/* A loop run on the pool. Every participant starts with an even share of the chunks
+ * and takes them from the front of its range, once done it steals the back half of
+ * the range of another participant, so uneven chunks end up balanced. */
+class PoolLoop {
+  // Chunks a participant has left, begin in the upper and end in the lower half
+  struct alignas(64) ChunkRange {
+    std::atomic<std::uint64_t> bounds = 0;
+  };
+
+  static std::uint64_t pack(std::uint64_t begin, std::uint64_t end) {
+    return begin << 32 | end;
+  }
+
+  Executor executor;
+  const std::function<void(std::size_t)>& chunk_body;
+  std::vector<ChunkRange> ranges;
+  LoopFailure failure;
+
+  // Participants not yet returned, no one joins once the loop is closed
+  std::mutex participants_lock;
+  std::condition_variable participants_left;
+  std::size_t active = 0;
+  bool closed = false;
+
+  std::optional<std::size_t> pop_front(ChunkRange& range) {
+    auto bounds = range.bounds.load();
+    while (true) {
+      const auto begin = bounds >> 32;
+      const auto end = bounds & 0xffffffff;
+      if (begin >= end) {
+        return std::nullopt;
+      }
+      if (range.bounds.compare_exchange_weak(bounds, pack(begin + 1, end))) {
+        return std::size_t(begin);
+      }
+    }
+  }
+
+  std::optional<std::uint64_t> steal_back(ChunkRange& range) {
+    auto bounds = range.bounds.load();
+    while (true) {
+      const auto begin = bounds >> 32;
+      const auto end = bounds & 0xffffffff;
+      if (begin >= end) {
+        return std::nullopt;
+      }
+      const auto middle = begin + (end - begin) / 2;
+      if (range.bounds.compare_exchange_weak(bounds, pack(begin, middle))) {
+        return pack(middle, end);
+      }
+    }
+  }
+
+ public:
+  PoolLoop(const Executor& loop_executor,
+           std::size_t chunk_count,
+           std::size_t participant_count,
+           const std::function<void(std::size_t)>& loop_chunk_body)
+      : executor(loop_executor),
+        chunk_body(loop_chunk_body),
+        ranges(participant_count) {
+    for (std::size_t i = 0; i < participant_count; ++i) {
+      this->ranges[i].bounds.store(pack(chunk_count * i / participant_count,
+                                        chunk_count * (i + 1) / participant_count));
+    }
+  }
+
+  // Run chunks until none is left in any range
+  void participate(std::size_t participant) {
+    auto& own = this->ranges[participant];
+    while (true) {
+      while (const auto chunk = this->pop_front(own)) {
+        this->failure.run([&]() { this->chunk_body(*chunk); });
+      }
+      auto stolen = std::optional<std::uint64_t>();
+      const auto range_cnt = this->ranges.size();
+      for (std::size_t i = 1; i < range_cnt and not stolen; ++i) {
+        stolen = this->steal_back(this->ranges[(participant + i) % range_cnt]);
+      }
+      if (not stolen) {
+        return;
+      }
+      own.bounds.store(*stolen);
+    }
+  }
+
+  // Called by helpers, which only participate while the loop is open
+  void help(std::size_t participant) {
+    {
+      const auto scoped_lock = std::scoped_lock(this->participants_lock);
+      if (this->closed) {
+        return;
+      }
+      ++this->active;
+    }
+    {
+      const auto executor_scope = ExecutorScope(this->executor);
+      this->participate(participant);
+    }
+    {
+      const auto scoped_lock = std::scoped_lock(this->participants_lock);
+      --this->active;
+    }
+    this->participants_left.notify_all();
+  }
+
+  // Called by the thread that started the loop once it ran out of chunks, waits for
+  // helpers still running one
+  void finish() {
+    {
+      auto unique_lock = std::unique_lock(this->participants_lock);
+      this->closed = true;
+      this->participants_left.wait(unique_lock, [&]() { return this->active == 0; });
+    }
+    this->failure.rethrow();
+  }
+};
+
+void run_pool(const Executor& executor,
+              std::size_t chunk_count,
+              const std::function<void(std::size_t)>& chunk_body) {
+  const auto participant_count = std::min(executor.thread_count, chunk_count);
+  // helpers that start after the loop finished find it closed, so it outlives them
+  auto loop =
+      std::make_shared<PoolLoop>(executor, chunk_count, participant_count, chunk_body);
+  auto& pool = loop_pool();
+  for (std::size_t participant = 1; participant < participant_count; ++participant) {
+    pool.post([loop, participant]() { loop->help(participant); });
+  }
+  // the calling thread works too, so loops progress even when every worker is busy
+  loop->participate(0);
+  loop->finish();
+}
+
+}  // namespace
+
+std::string_view to_string(Config::ParallelBackend backend) {
+  switch (backend) {
+    case Config::ParallelBackend::OpenMP:
+      return "openmp";
+    case Config::ParallelBackend::Pool:
+      return "pool";
+    case Config::ParallelBackend::Standard:
+      return "std";
+  }
+  return "unknown";
+}
+
+std::size_t default_thread_count() {
+#ifdef _OPENMP
+  static const auto result = std::size_t(std::max(omp_get_max_threads(), 1));
+#else
+  static const auto result =
+      std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+#endif
+  return result;
+}
+
+ThreadPool::ThreadPool(std::size_t thread_count) {
+  for (std::size_t i = 0; i < std::max<std::size_t>(thread_count, 1); ++i) {
+    this->workers.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    const auto scoped_lock = std::scoped_lock(this->tasks_lock);
+    this->stopping = true;
+  }
+  this->tasks_changed.notify_all();
+  for (auto& worker : this->workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::post(std::function<void()> task) {
+  {
+    const auto scoped_lock = std::scoped_lock(this->tasks_lock);
+    this->tasks.push_back(std::move(task));
+  }
+  this->tasks_changed.notify_one();
+}
+
+void ThreadPool::work() {
+  while (true) {
+    auto task = std::function<void()>();
+    {
+      auto unique_lock = std::unique_lock(this->tasks_lock);
+      this->tasks_changed.wait(unique_lock, [&]() {
+        return this->stopping or not this->tasks.empty();
+      });
+      if (this->tasks.empty()) {
+        return;
+      }
+      task = std::move(this->tasks.front());
+      this->tasks.pop_front();
+    }
+    task();
+  }
+}
+
+ThreadPool& loop_pool() {
+  static auto pool = ThreadPool(default_thread_count());
+  return pool;
+}
+
+const Executor& current_executor() {
+  static const auto default_executor = Executor();
+  return thread_executor != nullptr ? *thread_executor : default_executor;
+}
+
+ExecutorScope::ExecutorScope(Executor scope_executor)
+    : executor(scope_executor), previous(thread_executor) {
+  thread_executor = &this->executor;
+}
+
+ExecutorScope::~ExecutorScope() {
+  thread_executor = this->previous;
+}
+
+void run_chunks(std::size_t chunk_count,
+                const std::function<void(std::size_t)>& chunk_body) {
+  const auto& executor = current_executor();
+  if (chunk_count <= 1 or executor.thread_count <= 1) {
+    run_serial(chunk_count, chunk_body);
+    return;
+  }
+  switch (executor.backend) {
+    case Config::ParallelBackend::OpenMP:
+      run_openmp(executor, chunk_count, chunk_body);
+      return;
+    case Config::ParallelBackend::Pool:
+      run_pool(executor, chunk_count, chunk_body);
+      return;
+    case Config::ParallelBackend::Standard:
+      run_standard(executor, chunk_count, chunk_body);
+      return;
+  }
+}
+
+}  // namespace Computation
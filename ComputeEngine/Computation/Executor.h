@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "Config.h"
+#include "RunControl.h"
+
+namespace Computation {
+
+[[nodiscard]] std::string_view to_string(Config::ParallelBackend backend);
+
+// Threads loops run on unless told otherwise, OMP_NUM_THREADS when OpenMP is used,
+// every hardware thread otherwise
+[[nodiscard]] std::size_t default_thread_count();
+
+/* Persistent workers running queued tasks in submission order.
+ *
+ * Tasks of whole runs hold a worker for as long as the run lasts, tasks helping a
+ * parallel loop return as soon as the loop has no chunks left. */
+class ThreadPool {
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> tasks;
+  std::mutex tasks_lock;
+  std::condition_variable tasks_changed;
+  bool stopping = false;
+
+  void work();
+
+ public:
+  explicit ThreadPool(std::size_t thread_count);
+  // Runs the tasks already queued, then joins the workers
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  [[nodiscard]] std::size_t size() const { return workers.size(); }
+
+  void post(std::function<void()> task);
+};
+
+// Pool whose workers help the parallel loops of every run
+[[nodiscard]] ThreadPool& loop_pool();
+
+// How the parallel loops started by a thread are scheduled
+struct Executor {
+  Config::ParallelBackend backend = Config::ParallelBackend::OpenMP;
+  // Threads a loop runs on at most, the calling one included. The standard library
+  // decides on its own
+  std::size_t thread_count = default_thread_count();
+};
+
+// Executor of the calling thread, the default one outside of any scope
+[[nodiscard]] const Executor& current_executor();
+
+// Makes `executor` the one of the calling thread until the scope ends. Threads
+// running chunks of a loop use the executor of the thread that started it, so loops
+// nested in loops follow the same settings
+class ExecutorScope {
+  Executor executor;
+  const Executor* previous;
+
+ public:
+  explicit ExecutorScope(Executor scope_executor);
+  ~ExecutorScope();
+
+  ExecutorScope(const ExecutorScope&) = delete;
+  ExecutorScope& operator=(const ExecutorScope&) = delete;
+};
+
+// Call chunk_body(chunk) for every chunk in [0, chunk_count) with the executor of the
+// calling thread and return once all are done. The first exception thrown by a chunk
+// skips the chunks not yet started and is rethrown
+void run_chunks(std::size_t chunk_count,
+                const std::function<void(std::size_t)>& chunk_body);
+
+// Cells handled between two checks of the run control
+constexpr auto tile_size = std::size_t(4096);
+
+// Call body(begin, end) for consecutive ranges of `grain` ids covering [0, count) in
+// parallel. Each finished range counts `weight` units per id as done, and remaining
+// ranges are skipped once the run is cancelled, which then throws RunCancelled.
+// `control` may be null
+template <typename Body>
+void parallel_for_chunks(RunControl* control,
+                         std::size_t count,
+                         std::size_t grain,
+                         std::uint64_t weight,
+                         const Body& body) {
+  run_chunks((count + grain - 1) / grain, [&](std::size_t chunk) {
+    if (control != nullptr and control->should_stop()) {
+      return;
+    }
+    const auto begin = chunk * grain;
+    const auto end = std::min(begin + grain, count);
+    body(begin, end);
+    if (control != nullptr) {
+      control->advance((end - begin) * weight);
+    }
+  });
+  if (control != nullptr) {
+    control->check();
+  }
+}
+
+// Call body(id) for every id in [0, count) in parallel, one tile of ids after another
+template <typename Body>
+void parallel_for(RunControl* control,
+                  std::size_t count,
+                  std::uint64_t weight,
+                  const Body& body) {
+  parallel_for_chunks(control, count, tile_size, weight,
+                      [&](std::size_t begin, std::size_t end) {
+                        for (auto id = begin; id < end; ++id) {
+                          body(id);
+                        }
+                      });
+}
+
+// Call body(id) for every id in [0, count) in parallel, each id scheduled on its own,
+// for few ids of much work each
+template <typename Body>
+void parallel_for_each(std::size_t count, const Body& body) {
+  run_chunks(count, [&](std::size_t id) { body(id); });
+}
+
+// Reduce [0, count) in ranges of `grain` ids, body(partial, begin, end) accumulates a
+// range into a partial starting from `identity`. Partials are combined into the
+// result by combine(result, partial) in the order of their ranges, so the result
+// does not depend on the backend or on which thread ran which range
+template <typename T, typename Body, typename Combine>
+[[nodiscard]] T parallel_reduce(RunControl* control,
+                                std::size_t count,
+                                std::size_t grain,
+                                std::uint64_t weight,
+                                const T& identity,
+                                const Body& body,
+                                const Combine& combine) {
+  auto partials = std::vector<T>((count + grain - 1) / grain, identity);
+  parallel_for_chunks(control, count, grain, weight,
+                      [&](std::size_t begin, std::size_t end) {
+                        body(partials[begin / grain], begin, end);
+                      });
+  auto result = identity;
+  for (const auto& partial : partials) {
+    combine(result, partial);
+  }
+  return result;
+}
+
+}  // namespace Computation
@@ -0,0 +1,323 @@
+#include <fmt/format.h>
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <cstdint>
+#include <numbers>
+#include <vector>
+#include "BlockStorage.h"
+#include "ComputeGraph.h"
+#include "Kernels.h"
+#include "MemoryPlanner.h"
+#include "PressureEvaluation.h"
+#include "Processes.h"
+
+namespace Computation {
+
+void graphProcess(AtomicLogger::AtomicLogger* result_log,
+                  RunControl* control,
+                  const std::filesystem::path& export_directory,
+                  const std::vector<Config::Transducer>& transducers,
+                  const Config::SimulationParameter& simulation_parameter,
+                  const Config::ExecutionParameter& execution_parameter,
+                  const SimulationGrid& grid,
+                  ResultSink& sink) {
+  using enum FieldId;
+  const auto& nodes = field_nodes();
+  const auto plan = plan_graph(execution_parameter.outputs);
+  const auto padding = grid.padding;
+  const auto coefficients =
+      central_difference_coefficients(simulation_parameter.differentiation_order);
+  const auto second_coefficients =
+      second_difference_coefficients(simulation_parameter.differentiation_order);
+
+  const auto grid_blk = [&](FieldGrid field_grid) -> const CellBlockInterpolation& {
+    switch (field_grid) {
+      case FieldGrid::Pressure:
+        return grid.pressure;
+      case FieldGrid::Potential:
+        return grid.potential;
+      case FieldGrid::Force:
+        break;
+    }
+    return grid.force;
+  };
+
+  // Every component of a node is a block of its grid, complex nodes use the
+  // complex blocks and others the real ones
+  auto real_blocks = std::vector<std::vector<CellBlock<double>>>(nodes.size());
+  auto complex_blocks =
+      std::vector<std::vector<CellBlock<std::complex<double>>>>(nodes.size());
+  const auto real_block = [&](FieldId id,
+                              std::size_t component = 0) -> CellBlock<double>& {
+    return real_blocks[std::size_t(id)][component];
+  };
+  const auto complex_block =
+      [&](FieldId id, std::size_t component = 0) -> CellBlock<std::complex<double>>& {
+    return complex_blocks[std::size_t(id)][component];
+  };
+
+  // Only outputs are fields of the sink
+  auto fields = std::vector<std::vector<std::size_t>>(nodes.size());
+  for (std::size_t id = 0; id < nodes.size(); ++id) {
+    if (plan.exported[id]) {
+      const auto& node = nodes[id];
+      for (std::size_t component = 0; component < node.component_count(); ++component) {
+        fields[id].push_back(sink.begin_field(make_field_descriptor(
+            node.field_name(component), node.complex ? "complex128" : "float64",
+            node.cell_bytes(), grid_blk(node.grid))));
+      }
+    }
+  }
+
+  // Exported blocks are mapped from their legacy result file as in resident runs
+  const auto mapped_output =
+      execution_parameter.mapped_output and
+      execution_parameter.output_format == Config::OutputFormat::Legacy;
+  const auto allocate = [&](std::size_t id) {
+    const auto& node = nodes[id];
+    const auto size = grid_blk(node.grid).get_dimension_size();
+    for (std::size_t component = 0; component < node.component_count(); ++component) {
+      const auto emplace = [&](auto& blocks) {
+        if (mapped_output and plan.exported[id]) {
+          blocks.emplace_back(
+              size, export_directory / (node.field_name(component) + "_result.bin"));
+        } else {
+          blocks.emplace_back(size);
+        }
+      };
+      if (node.complex) {
+        emplace(complex_blocks[id]);
+      } else {
+        emplace(real_blocks[id]);
+      }
+    }
+  };
+  const auto release = [&](std::size_t id) {
+    const auto write = [&](auto& blocks) {
+      for (std::size_t component = 0; component < blocks.size(); ++component) {
+        if (not plan.exported[id]) {
+          continue;
+        }
+        if (blocks[component].is_mapped()) {
+          blocks[component].flush();
+        } else {
+          sink.write_field(fields[id][component],
+                           std::as_bytes(blocks[component].cells()));
+        }
+      }
+      blocks.clear();
+    };
+    write(real_blocks[id]);
+    write(complex_blocks[id]);
+  };
+
+  auto planner = MemoryPlanner();
+  for (const auto& sweep : plan.sweeps) {
+    planner.add_stage(std::string(to_string(sweep.grid)));
+  }
+  for (std::size_t id = 0; id < nodes.size(); ++id) {
+    if (plan.computed[id]) {
+      const auto& node = nodes[id];
+      planner.add_buffer(
+          std::string(node.name),
+          node.component_count() * grid_blk(node.grid).get_cell_count() *
+              node.cell_bytes(),
+          plan.first_sweep[id], plan.last_sweep[id], [&release, id]() { release(id); });
+    }
+  }
+
+  for (const auto& sweep : plan.sweeps) {
+    auto names = std::vector<std::string>();
+    for (const auto id : sweep.nodes) {
+      names.push_back(std::string(field_node(id).name) +
+                      (plan.exported[std::size_t(id)] ? "" : " (intermediate)"));
+    }
+    result_log->log(fmt::format(FMT_STRING("Sweep over {:s} grid: {:s}"),
+                                to_string(sweep.grid), fmt::join(names, ", ")));
+  }
+  result_log->log(fmt::format(FMT_STRING("Predicted peak memory: {:s} ({:s} stage)"),
+                              format_bytes(planner.predicted_peak_bytes()),
+                              planner.predicted_peak_stage()));
+
+  // Pressure takes a unit of work per cell and transducer, other sweeps one per cell
+  for (const auto& sweep : plan.sweeps) {
+    control->add_work(grid_blk(sweep.grid).get_cell_count() *
+                      (sweep.grid == FieldGrid::Pressure ? transducers.size() : 1));
+  }
+
+  const auto computes = [&](const GraphSweep& sweep, FieldId id) {
+    return std::find(sweep.nodes.begin(), sweep.nodes.end(), id) != sweep.nodes.end();
+  };
+
+  const auto pressure_sweep = [&](const GraphSweep&) {
+    const auto& pressure_blk = grid.pressure;
+    const auto strategy =
+        choose_pressure_strategy(pressure_blk.get_cell_count(), transducers.size());
+    result_log->log(fmt::format(FMT_STRING("Pressure evaluation: {:s}"),
+                                to_string(strategy)));
+    evaluate_pressure(
+        control, complex_block(Pressure).cells(),
+        [&](std::size_t id) { return pressure_blk.get_real_vec(id); }, transducers,
+        simulation_parameter, strategy);
+  };
+
+  const auto potential_sweep = [&](const GraphSweep& sweep) {
+    const auto& pressure_blk = grid.pressure;
+    const auto& potential_blk = grid.potential;
+    const auto& pressure = complex_block(Pressure);
+    const auto k1 = simulation_parameter.constant_k1();
+    const auto k2 = simulation_parameter.constant_k2();
+    const auto angular_frequency =
+        2.0 * std::numbers::pi * simulation_parameter.frequency;
+
+    // the gradient is shared by every node but |p|^2 and the Laplacian
+    const auto gradient_needed =
+        computes(sweep, PressureGradient) or computes(sweep, PressureGradientSquared) or
+        computes(sweep, Potential) or computes(sweep, AcousticIntensity) or
+        computes(sweep, KineticEnergyDensity);
+
+    parallel_for(control, potential_blk.get_cell_count(), 1, [&](std::size_t id) {
+      const auto mid = pressure_blk.get_id(potential_blk.get_int_vec(id) + padding);
+      const auto p = pressure.get_cell(mid);
+
+      const auto gradient =
+          gradient_needed
+              ? compute_gradient(
+                    [&](std::size_t axis, std::size_t k) {
+                      const auto offset = k * pressure_blk.get_stride(axis);
+                      return pressure.get_cell(mid + offset) -
+                             pressure.get_cell(mid - offset);
+                    },
+                    coefficients, simulation_parameter.cell_size)
+              : std::array<std::complex<double>, 3>();
+      const auto pressure_squared = euclidean_norm_squared(p);
+      auto gradient_squared = 0.0;
+      for (const auto& axis_gradient : gradient) {
+        gradient_squared += euclidean_norm_squared(axis_gradient);
+      }
+
+      for (const auto node : sweep.nodes) {
+        switch (node) {
+          case PressureSquared:
+            real_block(node).set_cell(id, pressure_squared);
+            break;
+          case PressureGradient:
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+              complex_block(node, axis).set_cell(id, gradient[axis]);
+            }
+            break;
+          case PressureGradientSquared:
+            real_block(node).set_cell(id, gradient_squared);
+            break;
+          case PressureLaplacian:
+            complex_block(node).set_cell(
+                id, compute_laplacian(
+                        p,
+                        [&](std::size_t axis, std::size_t k) {
+                          const auto offset = k * pressure_blk.get_stride(axis);
+                          return pressure.get_cell(mid + offset) +
+                                 pressure.get_cell(mid - offset);
+                        },
+                        second_coefficients, simulation_parameter.cell_size));
+            break;
+          case Potential:
+            real_block(node).set_cell(
+                id, combine_potential(pressure_squared, gradient_squared, k1, k2));
+            break;
+          case AcousticIntensity: {
+            const auto intensity = compute_acoustic_intensity(
+                p, gradient, angular_frequency, simulation_parameter.air_density);
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+              real_block(node, axis).set_cell(id, intensity[axis]);
+            }
+            break;
+          }
+          case KineticEnergyDensity:
+            real_block(node).set_cell(
+                id, kinetic_energy_density(gradient_squared,
+                                           simulation_parameter.air_density,
+                                           angular_frequency));
+            break;
+          case PotentialEnergyDensity:
+            real_block(node).set_cell(
+                id, potential_energy_density(pressure_squared,
+                                             simulation_parameter.air_density,
+                                             simulation_parameter.air_wave_speed));
+            break;
+          default:
+            break;
+        }
+      }
+    });
+  };
+
+  const auto force_sweep = [&](const GraphSweep& sweep) {
+    const auto& potential_blk = grid.potential;
+    const auto& force_blk = grid.force;
+    const auto& potential = real_block(Potential);
+    const auto stride = std::array{std::int64_t(potential_blk.get_stride(0)),
+                                   std::int64_t(potential_blk.get_stride(1)),
+                                   std::int64_t(potential_blk.get_stride(2))};
+    const auto force = computes(sweep, Force);
+    const auto hessian = computes(sweep, PotentialHessian);
+
+    parallel_for(control, force_blk.get_cell_count(), 1, [&](std::size_t id) {
+      const auto mid = potential_blk.get_id(force_blk.get_int_vec(id) + padding);
+
+      if (force) {
+        const auto f = compute_force(
+            [&](std::size_t axis, std::size_t k) {
+              const auto offset = k * potential_blk.get_stride(axis);
+              return potential.get_cell(mid + offset) -
+                     potential.get_cell(mid - offset);
+            },
+            coefficients, simulation_parameter.cell_size);
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+          real_block(Force, axis).set_cell(id, f[axis]);
+        }
+      }
+      if (hessian) {
+        const auto h = compute_hessian(
+            [&](const std::array<std::int64_t, 3>& offset) {
+              return potential.get_cell(
+                  std::size_t(std::int64_t(mid) + offset[0] * stride[0] +
+                              offset[1] * stride[1] + offset[2] * stride[2]));
+            },
+            coefficients, second_coefficients, simulation_parameter.cell_size);
+        for (std::size_t component = 0; component < h.size(); ++component) {
+          real_block(PotentialHessian, component).set_cell(id, h[component]);
+        }
+      }
+    });
+  };
+
+  for (std::size_t stage = 0; stage < plan.sweeps.size(); ++stage) {
+    const auto& sweep = plan.sweeps[stage];
+    result_log->log(
+        fmt::format(FMT_STRING("Computing {:s} sweep"), to_string(sweep.grid)));
+    planner.begin_stage(stage);
+    for (const auto id : sweep.nodes) {
+      allocate(std::size_t(id));
+    }
+    switch (sweep.grid) {
+      case FieldGrid::Pressure:
+        pressure_sweep(sweep);
+        break;
+      case FieldGrid::Potential:
+        potential_sweep(sweep);
+        break;
+      case FieldGrid::Force:
+        force_sweep(sweep);
+        break;
+    }
+    planner.finish_stage(stage);
+  }
+
+  result_log->log(fmt::format(
+      FMT_STRING("Peak memory: predicted {:s}, tracked {:s}, measured {:s}"),
+      format_bytes(planner.predicted_peak_bytes()),
+      format_bytes(planner.tracked_peak()), planner.format_measured_peak()));
+}
+
+}  // namespace Computation
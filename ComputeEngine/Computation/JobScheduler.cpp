@@ -0,0 +1,271 @@
+#include "JobScheduler.h"
+#include <fmt/format.h>
+#include <algorithm>
+#include "SimulationGrid.h"
+#include "Simulator.h"
+
+namespace Computation {
+
+// Pressure evaluations a core takes about a second for, smaller shares of a job are
+// not worth another core
+constexpr auto evaluations_per_core = std::size_t(1) << 24;
+
+std::string_view to_string(JobStatus status) {
+  switch (status) {
+    case JobStatus::Queued:
+      return "queued";
+    case JobStatus::Running:
+      return "running";
+    case JobStatus::Succeeded:
+      return "succeeded";
+    case JobStatus::Failed:
+      return "failed";
+    case JobStatus::Cancelled:
+      return "cancelled";
+  }
+  return "unknown";
+}
+
+std::size_t estimate_job_cores(const JobRequest& request, std::size_t core_budget) {
+  if (request.cores != 0) {
+    return std::min(request.cores, core_budget);
+  }
+  const auto& simulation_parameter = request.simulation_parameter;
+  const auto& sweep = request.execution_parameter.sweep;
+  const auto grid = make_simulation_grid(simulation_parameter);
+  const auto evaluations =
+      grid.pressure.get_cell_count() *
+      std::max<std::size_t>(request.transducers.size(), 1) *
+      std::max<std::size_t>(simulation_parameter.frequencies.size(), 1) *
+      std::max<std::size_t>(sweep.points().size(), 1);
+  const auto cores = (evaluations + evaluations_per_core - 1) / evaluations_per_core;
+  return std::clamp<std::size_t>(cores, 1, core_budget);
+}
+
+bool shares_output(const JobRequest& a, const JobRequest& b) {
+  const auto normal = [](const std::filesystem::path& path) {
+    auto result = std::filesystem::absolute(path).lexically_normal();
+    // "a/b/" names the same folder as "a/b"
+    return result.has_filename() ? result : result.parent_path();
+  };
+  const auto directory_a = normal(a.export_directory);
+  const auto directory_b = normal(b.export_directory);
+  const auto [end_a, end_b] = std::mismatch(directory_a.begin(), directory_a.end(),
+                                            directory_b.begin(), directory_b.end());
+  if (end_a == directory_a.end() or end_b == directory_b.end()) {
+    return true;
+  }
+
+  const auto& execution_a = a.execution_parameter;
+  const auto& execution_b = b.execution_parameter;
+  if (execution_a.output_format != execution_b.output_format) {
+    return false;
+  }
+  switch (execution_a.output_format) {
+    case Config::OutputFormat::Stream:
+      return execution_a.output_stream == execution_b.output_stream;
+    case Config::OutputFormat::SharedMemory:
+      return execution_a.shared_memory_name == execution_b.shared_memory_name;
+    case Config::OutputFormat::Container:
+    case Config::OutputFormat::Legacy:
+      return false;
+  }
+  return false;
+}
+
+JobScheduler::JobScheduler(std::size_t budget)
+    : core_budget(budget != 0 ? budget : default_thread_count()),
+      runners(core_budget) {}
+
+JobScheduler::~JobScheduler() {
+  auto results = std::vector<std::shared_future<JobStatus>>();
+  {
+    const auto scoped_lock = std::scoped_lock(this->jobs_lock);
+    this->stopping = true;
+    for (auto& job : this->jobs) {
+      if (job->status == JobStatus::Queued) {
+        this->finish(*job, JobStatus::Cancelled);
+      }
+      job->control.cancel();
+      results.push_back(job->result);
+    }
+  }
+  for (const auto& result : results) {
+    result.wait();
+  }
+}
+
+std::size_t JobScheduler::submit(JobRequest request) {
+  auto requests = std::vector<JobRequest>();
+  requests.push_back(std::move(request));
+  return this->submit(std::move(requests)).front();
+}
+
+std::vector<std::size_t> JobScheduler::submit(std::vector<JobRequest> requests) {
+  auto ids = std::vector<std::size_t>();
+  const auto scoped_lock = std::scoped_lock(this->jobs_lock);
+  for (auto& request : requests) {
+    auto job = std::make_unique<Job>();
+    job->id = this->jobs.size();
+    job->request = std::move(request);
+    job->request.cores = estimate_job_cores(job->request, this->core_budget);
+    job->submitted = Clock::now();
+    job->log.log(fmt::format(FMT_STRING("Queued with priority {:d} on {:d} cores"),
+                             job->request.priority, job->request.cores));
+    if (job->request.paused) {
+      job->control.pause();
+      job->log.log("Paused");
+    }
+    ids.push_back(job->id);
+    this->jobs.push_back(std::move(job));
+  }
+  this->start_jobs();
+  return ids;
+}
+
+bool JobScheduler::cancel(std::size_t id) {
+  const auto scoped_lock = std::scoped_lock(this->jobs_lock);
+  if (id >= this->jobs.size()) {
+    return false;
+  }
+  auto& job = *this->jobs[id];
+  if (job.status == JobStatus::Running) {
+    // the job finishes as cancelled once its run stops
+    job.control.cancel();
+    return true;
+  }
+  if (job.status != JobStatus::Queued) {
+    return false;
+  }
+  job.log.log("Cancelled before it started");
+  this->finish(job, JobStatus::Cancelled);
+  // jobs queued behind it may fit now
+  this->start_jobs();
+  return true;
+}
+
+void JobScheduler::pause(std::size_t id) {
+  const auto scoped_lock = std::scoped_lock(this->jobs_lock);
+  if (id < this->jobs.size() and this->jobs[id]->status == JobStatus::Running) {
+    this->jobs[id]->control.pause();
+    this->jobs[id]->log.log("Paused");
+  }
+}
+
+void JobScheduler::resume(std::size_t id) {
+  const auto scoped_lock = std::scoped_lock(this->jobs_lock);
+  if (id < this->jobs.size() and this->jobs[id]->control.is_paused()) {
+    this->jobs[id]->control.resume();
+    this->jobs[id]->log.log("Resumed");
+  }
+}
+
+std::vector<JobInfo> JobScheduler::snapshot() const {
+  const auto now = Clock::now();
+  const auto seconds = [](Clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+  };
+  const auto scoped_lock = std::scoped_lock(this->jobs_lock);
+  auto result = std::vector<JobInfo>();
+  for (const auto& job : this->jobs) {
+    auto info = JobInfo{job->id,
+                        job->request.name,
+                        job->request.export_directory,
+                        job->request.priority,
+                        job->request.cores,
+                        job->status,
+                        0.0,
+                        0.0,
+                        job->control.progress()};
+    switch (job->status) {
+      case JobStatus::Queued:
+        info.queued_seconds = seconds(now - job->submitted);
+        break;
+      case JobStatus::Running:
+        info.queued_seconds = seconds(job->started - job->submitted);
+        info.running_seconds = seconds(now - job->started);
+        break;
+      case JobStatus::Succeeded:
+      case JobStatus::Failed:
+      case JobStatus::Cancelled:
+        // jobs cancelled in the queue never started
+        if (job->started == Clock::time_point()) {
+          info.queued_seconds = seconds(job->finished - job->submitted);
+        } else {
+          info.queued_seconds = seconds(job->started - job->submitted);
+          info.running_seconds = seconds(job->finished - job->started);
+        }
+        break;
+    }
+    result.push_back(std::move(info));
+  }
+  return result;
+}
+
+std::shared_future<JobStatus> JobScheduler::result(std::size_t id) const {
+  const auto scoped_lock = std::scoped_lock(this->jobs_lock);
+  return this->jobs.at(id)->result;
+}
+
+AtomicLogger::AtomicLogger& JobScheduler::job_log(std::size_t id) {
+  const auto scoped_lock = std::scoped_lock(this->jobs_lock);
+  return this->jobs.at(id)->log;
+}
+
+JobScheduler::Job* JobScheduler::next_job() {
+  const auto output_in_use = [this](const Job& queued) {
+    return std::any_of(this->jobs.begin(), this->jobs.end(), [&](const auto& job) {
+      return job->status == JobStatus::Running and
+             shares_output(job->request, queued.request);
+    });
+  };
+  auto result = static_cast<Job*>(nullptr);
+  for (auto& job : this->jobs) {
+    if (job->status == JobStatus::Queued and
+        (result == nullptr or job->request.priority > result->request.priority) and
+        not output_in_use(*job)) {
+      result = job.get();
+    }
+  }
+  return result;
+}
+
+void JobScheduler::start_jobs() {
+  while (not this->stopping) {
+    auto* job = this->next_job();
+    if (job == nullptr or this->cores_in_use + job->request.cores > this->core_budget) {
+      return;
+    }
+    job->status = JobStatus::Running;
+    job->started = Clock::now();
+    this->cores_in_use += job->request.cores;
+    this->runners.post([this, job]() { this->run(*job); });
+  }
+}
+
+void JobScheduler::run(Job& job) {
+  const auto& request = job.request;
+  const auto backend = request.execution_parameter.parallel_backend;
+  const auto executor_scope = ExecutorScope(Executor{backend, request.cores});
+  job.log.log(fmt::format(FMT_STRING("Running on {:d} threads with the {:s} backend"),
+                          request.cores, to_string(backend)));
+  const auto succeeded =
+      simulationProcess(&job.log, &job.control, request.export_directory,
+                        request.transducers, request.simulation_parameter,
+                        request.execution_parameter);
+
+  const auto scoped_lock = std::scoped_lock(this->jobs_lock);
+  this->cores_in_use -= request.cores;
+  this->finish(job, succeeded                    ? JobStatus::Succeeded
+                    : job.control.is_cancelled() ? JobStatus::Cancelled
+                                                 : JobStatus::Failed);
+  this->start_jobs();
+}
+
+void JobScheduler::finish(Job& job, JobStatus status) {
+  job.status = status;
+  job.finished = Clock::now();
+  job.outcome.set_value(status);
+}
+
+}  // namespace Computation
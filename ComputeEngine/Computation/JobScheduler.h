@@ -0,0 +1,129 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../Utilities/AtomicLogger.h"
+#include "Config.h"
+#include "Executor.h"
+#include "RunControl.h"
+
+namespace Computation {
+
+enum class JobStatus { Queued, Running, Succeeded, Failed, Cancelled };
+
+[[nodiscard]] std::string_view to_string(JobStatus status);
+
+// A simulation submitted to the scheduler
+struct JobRequest {
+  std::string name;
+  std::filesystem::path export_directory;
+  std::vector<Config::Transducer> transducers;
+  Config::SimulationParameter simulation_parameter;
+  Config::ExecutionParameter execution_parameter;
+  // Higher priorities start first, equal priorities in submission order
+  int priority = 0;
+  // Cores the job runs on, 0 to estimate them from the size of the job
+  std::size_t cores = 0;
+  // Hold the job at its first tile once it starts, until it is resumed
+  bool paused = false;
+};
+
+// Snapshot of a job for queue views
+struct JobInfo {
+  std::size_t id;
+  std::string name;
+  std::filesystem::path export_directory;
+  int priority;
+  std::size_t cores;
+  JobStatus status;
+  // Seconds spent waiting in the queue and running, up to now for unfinished jobs
+  double queued_seconds;
+  double running_seconds;
+  RunProgress progress;
+};
+
+// Cores worth giving a job, so small runs share the machine and large ones get all
+// of `core_budget`
+[[nodiscard]] std::size_t estimate_job_cores(const JobRequest& request,
+                                             std::size_t core_budget);
+
+// Whether two jobs write to the same place: nested export directories, as sweeps
+// and checkpoints write below them, or the same stream or shared memory region
+[[nodiscard]] bool shares_output(const JobRequest& a, const JobRequest& b);
+
+/* Runs submitted simulations concurrently within a budget of cores.
+ *
+ * The queued job of highest priority starts as soon as its cores are free, later jobs
+ * wait behind it even if they would fit, so large jobs are not starved by a stream of
+ * small ones. Jobs sharing output with a running job are held back until it finished,
+ * so runs never overwrite or remove each other's results. Every job runs as a task on
+ * a pool of one worker per core, since each job takes at least one, with its parallel
+ * loops limited to its cores on the backend it asks for, and logs into its own
+ * logger. */
+class JobScheduler {
+  using Clock = std::chrono::steady_clock;
+
+  struct Job {
+    std::size_t id;
+    JobRequest request;
+    JobStatus status = JobStatus::Queued;
+    Clock::time_point submitted;
+    Clock::time_point started;
+    Clock::time_point finished;
+    AtomicLogger::AtomicLogger log;
+    RunControl control;
+    std::promise<JobStatus> outcome;
+    std::shared_future<JobStatus> result = outcome.get_future().share();
+  };
+
+  std::size_t core_budget;
+  std::size_t cores_in_use = 0;
+  // Jobs in submission order, never removed, so references to logs stay valid
+  std::vector<std::unique_ptr<Job>> jobs;
+  mutable std::mutex jobs_lock;
+  bool stopping = false;
+  // Last member, so workers finish before the jobs they run are destroyed
+  ThreadPool runners;
+
+  // Start queued jobs while their cores are free, called with `jobs_lock` held
+  void start_jobs();
+  void run(Job& job);
+  void finish(Job& job, JobStatus status);
+  [[nodiscard]] Job* next_job();
+
+ public:
+  // A budget of 0 uses every core
+  explicit JobScheduler(std::size_t budget = 0);
+  // Cancels every unfinished job and waits for running ones to stop
+  ~JobScheduler();
+
+  JobScheduler(const JobScheduler&) = delete;
+  JobScheduler& operator=(const JobScheduler&) = delete;
+
+  [[nodiscard]] std::size_t get_core_budget() const { return core_budget; }
+
+  // Queue a job, returns its id
+  std::size_t submit(JobRequest request);
+  // Queue jobs at once, so their priorities decide which starts first
+  std::vector<std::size_t> submit(std::vector<JobRequest> requests);
+  // Cancel a queued job, or stop a running one at its next tile. Returns whether
+  // the job was unfinished
+  bool cancel(std::size_t id);
+  // Hold a running job at its next tile, its cores stay reserved
+  void pause(std::size_t id);
+  void resume(std::size_t id);
+  // Every job in submission order
+  [[nodiscard]] std::vector<JobInfo> snapshot() const;
+  // Becomes ready with the final status of the job once it finished
+  [[nodiscard]] std::shared_future<JobStatus> result(std::size_t id) const;
+  [[nodiscard]] AtomicLogger::AtomicLogger& job_log(std::size_t id);
+};
+
+}  // namespace Computation
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <span>
+#include "Config.h"
+#include "Stencil.h"
+#include "Vec3.h"
+
+namespace Computation {
+
+// constant i
+constexpr auto i = std::complex<double>(0, 1);
+
+// Distance of a point to a transducer and sine of its angle off the transducer
+// axis, the terms of its pressure that depend on neither frequency nor phase
+struct PressureGeometry {
+  double distance;
+  double sine_angle;
+};
+
+inline PressureGeometry pressure_geometry(const Vec3<double>& point,
+                                          const Config::Transducer& transducer) {
+  const auto angle = transducer.position.cosine_angle(transducer.target, point);
+  return {transducer.position.euclidean_distance(point), std::sin(angle)};
+}
+
+inline double wave_number(const Config::SimulationParameter& simulation_parameter) {
+  return 2.0 * std::numbers::pi * simulation_parameter.frequency /
+         simulation_parameter.air_wave_speed;
+}
+
+inline std::complex<double> compute_pressure(const PressureGeometry& geometry,
+                                             const Config::Transducer& transducer,
+                                             double wave_number) {
+  const auto directivity = [&]() -> double {
+    const auto intermediate = wave_number * transducer.radius * geometry.sine_angle;
+    if (intermediate == 0.0) {
+      return 1.0;
+    }
+    return 2.0 * std::cyl_bessel_j(1, intermediate) / intermediate;
+  }();
+
+  return std::exp(i * (wave_number * geometry.distance + transducer.phase_shift)) *
+         (transducer.output_power * transducer.loss_factor * directivity /
+          geometry.distance);
+}
+
+// Add the pressure of a transducer at each wave number to the sum of the same
+// index, its geometry is computed once for all of them
+inline void accumulate_pressure(const PressureGeometry& geometry,
+                                const Config::Transducer& transducer,
+                                std::span<const double> wave_numbers,
+                                std::span<std::complex<double>> sums) {
+  for (std::size_t k = 0; k < wave_numbers.size(); ++k) {
+    sums[k] += compute_pressure(geometry, transducer, wave_numbers[k]);
+  }
+}
+
+inline std::complex<double> compute_pressure(
+    const Vec3<double>& point,
+    const Config::Transducer& transducer,
+    const Config::SimulationParameter& simulation_parameter) {
+  return compute_pressure(pressure_geometry(point, transducer), transducer,
+                          wave_number(simulation_parameter));
+}
+
+constexpr double euclidean_norm_squared(const std::complex<double>& complex) {
+  return complex.real() * complex.real() + complex.imag() * complex.imag();
+}
+
+// Return |p|^2 and |grad p|^2 at a cell from its pressure and its neighbours, the
+// only terms of the potential that do not depend on the particle
+// `pressure_difference(axis, k)` returns pressure at +k minus pressure at -k
+template <typename Difference>
+std::array<double, 2> compute_intensity(const std::complex<double>& pressure,
+                                        const Difference& pressure_difference,
+                                        std::span<const double> coefficients,
+                                        double cell_size) {
+  // squared magnitude of pressure gradient, summed over each axis
+  auto p_grad = 0.0;
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    p_grad += euclidean_norm_squared(central_difference(
+        [&](std::size_t k) { return pressure_difference(axis, k); }, coefficients,
+        cell_size));
+  }
+
+  return {euclidean_norm_squared(pressure), p_grad};
+}
+
+// Return potential of a particle with constants k1 and k2 from |p|^2 and |grad p|^2
+constexpr double combine_potential(double pressure_squared,
+                                   double gradient_squared,
+                                   double k1,
+                                   double k2) {
+  return 2.0 * k1 * pressure_squared - 2.0 * k2 * gradient_squared;
+}
+
+// Return potential at a cell from its pressure and its neighbours
+template <typename Difference>
+double compute_potential(const std::complex<double>& pressure,
+                         const Difference& pressure_difference,
+                         std::span<const double> coefficients,
+                         double cell_size,
+                         double k1,
+                         double k2) {
+  const auto [pressure_squared, gradient_squared] =
+      compute_intensity(pressure, pressure_difference, coefficients, cell_size);
+  return combine_potential(pressure_squared, gradient_squared, k1, k2);
+}
+
+// Return pressure gradient at a cell from its neighbours
+// `pressure_difference(axis, k)` returns pressure at +k minus pressure at -k
+template <typename Difference>
+std::array<std::complex<double>, 3> compute_gradient(
+    const Difference& pressure_difference,
+    std::span<const double> coefficients,
+    double cell_size) {
+  auto result = std::array<std::complex<double>, 3>();
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    result[axis] = central_difference(
+        [&](std::size_t k) { return pressure_difference(axis, k); }, coefficients,
+        cell_size);
+  }
+  return result;
+}
+
+// Return pressure Laplacian at a cell from its pressure and its neighbours
+// `pressure_sum(axis, k)` returns pressure at +k plus pressure at -k
+template <typename Sum>
+std::complex<double> compute_laplacian(const std::complex<double>& pressure,
+                                       const Sum& pressure_sum,
+                                       std::span<const double> second_coefficients,
+                                       double cell_size) {
+  auto result = std::complex<double>();
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    result += central_second_difference(
+        pressure, [&](std::size_t k) { return pressure_sum(axis, k); },
+        second_coefficients, cell_size);
+  }
+  return result;
+}
+
+// Return time averaged acoustic intensity 1/2 Re(p conj(v)) from pressure and its
+// gradient, pressure varying as exp(i (k r - w t)) so v = grad p / (i w rho)
+inline std::array<double, 3> compute_acoustic_intensity(
+    const std::complex<double>& pressure,
+    const std::array<std::complex<double>, 3>& gradient,
+    double angular_frequency,
+    double air_density) {
+  auto result = std::array<double, 3>();
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    result[axis] = (std::conj(pressure) * gradient[axis]).imag() /
+                   (2.0 * air_density * angular_frequency);
+  }
+  return result;
+}
+
+// Return time averaged potential energy density |p|^2 / (4 rho c^2)
+constexpr double potential_energy_density(double pressure_squared,
+                                          double air_density,
+                                          double air_wave_speed) {
+  return pressure_squared / (4.0 * air_density * air_wave_speed * air_wave_speed);
+}
+
+// Return time averaged kinetic energy density rho |v|^2 / 4 = |grad p|^2 / (4 rho w^2)
+constexpr double kinetic_energy_density(double gradient_squared,
+                                        double air_density,
+                                        double angular_frequency) {
+  return gradient_squared / (4.0 * air_density * angular_frequency * angular_frequency);
+}
+
+// Return force (negative potential gradient) at a cell from its neighbours
+// `potential_difference(axis, k)` returns potential at +k minus potential at -k
+template <typename Difference>
+std::array<double, 3> compute_force(const Difference& potential_difference,
+                                    std::span<const double> coefficients,
+                                    double cell_size) {
+  auto result = std::array<double, 3>();
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    result[axis] = -central_difference(
+        [&](std::size_t k) { return potential_difference(axis, k); }, coefficients,
+        cell_size);
+  }
+  return result;
+}
+
+// Return potential Hessian (xx, yy, zz, xy, xz, yz) at a cell from its neighbours
+// `potential_at(offset)` returns potential at a signed cell offset
+template <typename At>
+std::array<double, 6> compute_hessian(const At& potential_at,
+                                      std::span<const double> coefficients,
+                                      std::span<const double> second_coefficients,
+                                      double cell_size) {
+  const auto at = [&](std::size_t axis_a, std::int64_t k_a, std::size_t axis_b,
+                      std::int64_t k_b) {
+    auto offset = std::array<std::int64_t, 3>();
+    offset[axis_a] += k_a;
+    offset[axis_b] += k_b;
+    return potential_at(offset);
+  };
+  const auto center = potential_at(std::array<std::int64_t, 3>());
+
+  auto result = std::array<double, 6>();
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    result[axis] = central_second_difference(
+        center,
+        [&](std::size_t k) {
+          return at(axis, std::int64_t(k), axis, 0) +
+                 at(axis, -std::int64_t(k), axis, 0);
+        },
+        second_coefficients, cell_size);
+  }
+
+  // mixed derivatives differentiate along one axis the derivative along the other
+  constexpr auto pairs =
+      std::array<std::array<std::size_t, 2>, 3>{{{0, 1}, {0, 2}, {1, 2}}};
+  for (std::size_t pair = 0; pair < pairs.size(); ++pair) {
+    const auto [axis_a, axis_b] = pairs[pair];
+    const auto derivative_b = [&](std::int64_t k_a) {
+      return central_difference(
+          [&](std::size_t k) {
+            return at(axis_a, k_a, axis_b, std::int64_t(k)) -
+                   at(axis_a, k_a, axis_b, -std::int64_t(k));
+          },
+          coefficients, cell_size);
+    };
+    result[3 + pair] = central_difference(
+        [&](std::size_t k) {
+          return derivative_b(std::int64_t(k)) - derivative_b(-std::int64_t(k));
+        },
+        coefficients, cell_size);
+  }
+  return result;
+}
+
+}  // namespace Computation
@@ -0,0 +1,126 @@
+#include "MemoryPlanner.h"
+#include <fmt/format.h>
+#include <algorithm>
+#include <atomic>
+#include "../Utilities/ProcessMemory.h"
+
+namespace Computation {
+
+namespace {
+
+// Planners alive in the process, one per running run
+std::atomic<std::size_t> live_planners = 0;
+// Resets of the high water mark, a planner whose reset was followed by another
+// one no longer knows its own peak
+std::atomic<std::uint64_t> peak_resets = 0;
+
+}  // namespace
+
+MemoryPlanner::MemoryPlanner() {
+  if (live_planners.fetch_add(1) == 0) {
+    this->peak_reset = ProcessMemory::reset_peak_resident();
+    if (this->peak_reset) {
+      this->peak_reset_generation = peak_resets.fetch_add(1) + 1;
+    }
+  } else {
+    this->shared_process = true;
+  }
+  this->sample_resident();
+}
+
+MemoryPlanner::~MemoryPlanner() {
+  live_planners.fetch_sub(1);
+}
+
+void MemoryPlanner::sample_resident() {
+  if (live_planners.load() > 1) {
+    this->shared_process = true;
+  }
+  this->sampled_peak_bytes =
+      std::max(this->sampled_peak_bytes, ProcessMemory::resident_bytes());
+}
+
+std::string MemoryPlanner::format_measured_peak() {
+  this->sample_resident();
+  auto result = this->sampled_peak_bytes;
+  if (this->peak_reset and peak_resets.load() == this->peak_reset_generation) {
+    result = std::max(result, ProcessMemory::peak_resident_bytes());
+  }
+  return format_bytes(result) + (this->shared_process ? " process-wide" : "");
+}
+
+std::size_t MemoryPlanner::add_stage(std::string name) {
+  this->stages.push_back(std::move(name));
+  return this->stages.size() - 1;
+}
+
+void MemoryPlanner::add_buffer(std::string name,
+                               std::size_t bytes,
+                               std::size_t first_stage,
+                               std::size_t last_stage,
+                               std::function<void()> retire,
+                               std::function<void()> produced) {
+  this->buffers.push_back(Buffer{std::move(name), bytes, first_stage, last_stage,
+                                 std::move(retire), std::move(produced)});
+}
+
+void MemoryPlanner::begin_stage(std::size_t stage) {
+  for (const auto& buffer : this->buffers) {
+    if (buffer.first_stage == stage) {
+      this->alive_bytes += buffer.bytes;
+    }
+  }
+  this->tracked_peak_bytes = std::max(this->tracked_peak_bytes, this->alive_bytes);
+  this->sample_resident();
+}
+
+void MemoryPlanner::finish_stage(std::size_t stage) {
+  for (auto& buffer : this->buffers) {
+    if (buffer.first_stage == stage and buffer.produced) {
+      buffer.produced();
+    }
+  }
+  for (auto& buffer : this->buffers) {
+    if (buffer.last_stage == stage) {
+      buffer.retire();
+      this->alive_bytes -= buffer.bytes;
+    }
+  }
+  this->sample_resident();
+}
+
+std::size_t MemoryPlanner::predicted_stage_bytes(std::size_t stage) const {
+  auto result = std::size_t(0);
+  for (const auto& buffer : this->buffers) {
+    if (buffer.first_stage <= stage and stage <= buffer.last_stage) {
+      result += buffer.bytes;
+    }
+  }
+  return result;
+}
+
+std::size_t MemoryPlanner::predicted_peak_bytes() const {
+  auto result = std::size_t(0);
+  for (std::size_t stage = 0; stage < this->stages.size(); ++stage) {
+    result = std::max(result, this->predicted_stage_bytes(stage));
+  }
+  return result;
+}
+
+std::string MemoryPlanner::predicted_peak_stage() const {
+  auto peak = std::size_t(0);
+  auto result = std::string();
+  for (std::size_t stage = 0; stage < this->stages.size(); ++stage) {
+    if (this->predicted_stage_bytes(stage) > peak) {
+      peak = this->predicted_stage_bytes(stage);
+      result = this->stages[stage];
+    }
+  }
+  return result;
+}
+
+std::string format_bytes(std::size_t bytes) {
+  return fmt::format(FMT_STRING("{:.1f} MiB"), double(bytes) / (1024.0 * 1024.0));
+}
+
+}  // namespace Computation
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Computation {
+
+class MemoryPlanner {
+  // A buffer lives from the start of its first stage until the end of its last
+  // stage. Once its first stage is done its content is final and `produced` is
+  // called, once its last stage is done it is retired (persisted and released)
+  struct Buffer {
+    std::string name;
+    std::size_t bytes;
+    std::size_t first_stage;
+    std::size_t last_stage;
+    std::function<void()> retire;
+    std::function<void()> produced;
+  };
+
+  std::vector<std::string> stages;
+  std::vector<Buffer> buffers;
+
+  std::size_t alive_bytes = 0;
+  std::size_t tracked_peak_bytes = 0;
+
+  // Resident memory of the process while the planner lives: its high water mark,
+  // reset when the planner is created unless another run is alive, and resident
+  // memory sampled at every stage boundary
+  bool peak_reset = false;
+  std::uint64_t peak_reset_generation = 0;
+  std::size_t sampled_peak_bytes = 0;
+  // Another run was alive, so measurements include its memory
+  bool shared_process = false;
+
+  void sample_resident();
+
+ public:
+  MemoryPlanner();
+  ~MemoryPlanner();
+
+  MemoryPlanner(const MemoryPlanner&) = delete;
+  MemoryPlanner& operator=(const MemoryPlanner&) = delete;
+
+  std::size_t add_stage(std::string name);
+  void add_buffer(std::string name,
+                  std::size_t bytes,
+                  std::size_t first_stage,
+                  std::size_t last_stage,
+                  std::function<void()> retire,
+                  std::function<void()> produced = {});
+
+  // Account for buffers allocated by a stage
+  void begin_stage(std::size_t stage);
+  // Notify buffers produced by this stage, then retire buffers whose last consumer
+  // is this stage
+  void finish_stage(std::size_t stage);
+
+  // Return bytes alive during a stage if lifetimes are followed
+  [[nodiscard]] std::size_t predicted_stage_bytes(std::size_t stage) const;
+  [[nodiscard]] std::size_t predicted_peak_bytes() const;
+  [[nodiscard]] std::string predicted_peak_stage() const;
+  [[nodiscard]] std::size_t tracked_peak() const { return tracked_peak_bytes; }
+  // Peak resident memory measured during the run so far, formatted for logging and
+  // labelled process-wide if other runs were alive
+  [[nodiscard]] std::string format_measured_peak();
+};
+
+// Format byte count for logging
+[[nodiscard]] std::string format_bytes(std::size_t bytes);
+
+}  // namespace Computation
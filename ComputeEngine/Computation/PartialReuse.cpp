@@ -0,0 +1,179 @@
+#include "PartialReuse.h"
+#include <fmt/format.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include "Executor.h"
+#include "SimulationGrid.h"
+
+namespace Computation {
+
+namespace {
+
+// Box a grid starting at `source_origin` shares with the block, if their cells sit
+// on the same lattice of `cell_size`
+std::optional<ReusedBox> shared_box(const Vec3<double>& source_origin,
+                                    const Vec3<std::size_t>& source_size,
+                                    const CellBlockInterpolation& blk,
+                                    double cell_size) {
+  const auto origin = blk.get_begin();
+  const auto size = blk.get_dimension_size();
+  const auto shift = (source_origin - origin) / cell_size;
+
+  auto result = ReusedBox();
+  const auto axes = std::array{
+      std::tuple(shift.x, source_size.x, size.x, &result.begin.x,
+                 &result.source_begin.x, &result.count.x),
+      std::tuple(shift.y, source_size.y, size.y, &result.begin.y,
+                 &result.source_begin.y, &result.count.y),
+      std::tuple(shift.z, source_size.z, size.z, &result.begin.z,
+                 &result.source_begin.z, &result.count.z)};
+  for (const auto& [axis_shift, source_cnt, cnt, begin, source_begin, count] : axes) {
+    // cells of the source are `offset` cells after those of the block
+    const auto offset = std::round(axis_shift);
+    if (std::abs(axis_shift - offset) > 1e-6) {
+      return std::nullopt;
+    }
+    const auto first = std::max(offset, 0.0);
+    const auto last = std::min(offset + double(source_cnt), double(cnt));
+    if (last <= first) {
+      return std::nullopt;
+    }
+    *begin = std::size_t(first);
+    *source_begin = std::size_t(first - offset);
+    *count = std::size_t(last - first);
+  }
+  return result;
+}
+
+}  // namespace
+
+std::vector<std::size_t> cells_outside(const CellBlockInterpolation& blk,
+                                       const ReusedBox& box) {
+  const auto& size = blk.get_dimension_size();
+  auto result = std::vector<std::size_t>();
+  result.reserve(size.product() - box.count.product());
+  for (std::size_t x = 0; x < size.x; ++x) {
+    for (std::size_t y = 0; y < size.y; ++y) {
+      const auto row = (x * size.y + y) * size.z;
+      // rows crossing the box skip its z range, others are missing entirely
+      const auto crosses = box.contains(Vec3<std::size_t>{x, y, box.begin.z});
+      for (std::size_t z = 0; z < size.z; ++z) {
+        if (crosses and z == box.begin.z) {
+          z += box.count.z - 1;
+          continue;
+        }
+        result.push_back(row + z);
+      }
+    }
+  }
+  return result;
+}
+
+PartialReuse::PartialReuse(const std::filesystem::path& path,
+                           double cell_size,
+                           bool reuse_fields)
+    : reader(path), cell_size(cell_size), reuse_fields(reuse_fields) {}
+
+std::optional<ReusedBox> PartialReuse::overlap(
+    std::string_view name,
+    const CellBlockInterpolation& blk) const {
+  const auto names = this->reader.field_names();
+  if ((name != "pressure" and not this->reuse_fields) or
+      std::find(names.begin(), names.end(), name) == names.end()) {
+    return std::nullopt;
+  }
+  const auto field = this->reader.field(name);
+  return shared_box(field.origin, field.dimension_size, blk, this->cell_size);
+}
+
+std::optional<ReusedBox> PartialReuse::copy(std::string_view name,
+                                            const CellBlockInterpolation& blk,
+                                            std::span<std::byte> cells) const {
+  const auto box = this->overlap(name, blk);
+  if (not box) {
+    return std::nullopt;
+  }
+
+  const auto cell_bytes = this->reader.field(name).cell_bytes;
+  const auto source = this->reader.read_box(name, box->source_begin, box->count);
+  const auto row_bytes = box->count.z * cell_bytes;
+
+  parallel_for(nullptr, box->count.x * box->count.y, 0, [&](std::size_t row) {
+    const auto x = box->begin.x + row / box->count.y;
+    const auto y = box->begin.y + row % box->count.y;
+    const auto id = blk.get_id(Vec3<std::size_t>{x, y, box->begin.z});
+    std::memcpy(cells.data() + id * cell_bytes, source.data() + row * row_bytes,
+                row_bytes);
+  });
+  return box;
+}
+
+std::unique_ptr<PartialReuse> find_partial_reuse(AtomicLogger::AtomicLogger* result_log,
+                                                 const ResultCache& cache,
+                                                 const nlohmann::json& parameters) {
+  const auto& simulation = parameters.at("simulation_parameter");
+  const auto simulation_parameter = JSONConvert::to_simulation_parameter(simulation);
+  const auto pressure_blk = make_simulation_grid(simulation_parameter).pressure;
+
+  // Simulation parameters pressure depends on besides the position of a cell
+  constexpr auto pressure_keys = std::array{"cell_size", "frequency", "air_wave_speed"};
+  // Everything but the box, on which potential and force depend
+  const auto without_box = [](nlohmann::json json) {
+    json.erase("begin");
+    json.erase("end");
+    return json;
+  };
+
+  auto best = std::optional<CacheEntry>();
+  auto best_cnt = std::size_t(0);
+  auto best_fields = false;
+  for (const auto& entry : cache.entries()) {
+    const auto& source = entry.parameters;
+    const auto& source_simulation = source.at("simulation_parameter");
+    const auto& execution = source.at("execution_parameter");
+    // lossy chunks no longer hold the computed values, and selected outputs or
+    // several frequencies may leave out pressure
+    if (source.at("engine_version") != parameters.at("engine_version") or
+        source.at("precision") != parameters.at("precision") or
+        source.at("transducers") != parameters.at("transducers") or
+        not execution.value("targets", nlohmann::json::array()).empty() or
+        not execution.value("outputs", nlohmann::json::array()).empty() or
+        not source_simulation.value("frequencies", nlohmann::json::array()).empty() or
+        execution.value("compression", std::string("none")) == "lossy") {
+      continue;
+    }
+    if (std::any_of(pressure_keys.begin(), pressure_keys.end(), [&](const auto* key) {
+          return source_simulation.at(key) != simulation.at(key);
+        })) {
+      continue;
+    }
+
+    const auto source_blk =
+        make_simulation_grid(JSONConvert::to_simulation_parameter(source_simulation))
+            .pressure;
+    const auto box = shared_box(source_blk.get_begin(), source_blk.get_dimension_size(),
+                                pressure_blk, simulation_parameter.cell_size);
+    // entries are most recently used first, so ties keep the most recent one
+    if (box and box->count.product() > best_cnt) {
+      best = entry;
+      best_cnt = box->count.product();
+      best_fields = without_box(source_simulation) == without_box(simulation);
+    }
+  }
+  if (not best) {
+    return nullptr;
+  }
+
+  result_log->log(fmt::format(
+      FMT_STRING("Reusing {:d} of {:d} pressure cells of cached results {:s}{:s}"),
+      best_cnt, pressure_blk.get_cell_count(), best->key,
+      best_fields ? ", with potential and force" : ""));
+  return std::make_unique<PartialReuse>(cache.get_directory() / best->key,
+                                        simulation_parameter.cell_size, best_fields);
+}
+
+}  // namespace Computation
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "../Utilities/AtomicLogger.h"
+#include "BlockStorage.h"
+#include "Config.h"
+#include "ResultCache.h"
+#include "ResultReader.h"
+#include "Vec3.h"
+
+namespace Computation {
+
+// Box of cells a block shares with a field of an earlier run on the same lattice
+struct ReusedBox {
+  // First cell of the box in the block and in the earlier field
+  Vec3<std::size_t> begin;
+  Vec3<std::size_t> source_begin;
+  Vec3<std::size_t> count;
+
+  [[nodiscard]] bool contains(const Vec3<std::size_t>& cell) const {
+    // cells before begin wrap around to large differences
+    return cell.x - begin.x < count.x and cell.y - begin.y < count.y and
+           cell.z - begin.z < count.z;
+  }
+};
+
+// Ids of the cells of a block outside of a box, in increasing order
+[[nodiscard]] std::vector<std::size_t> cells_outside(const CellBlockInterpolation& blk,
+                                                     const ReusedBox& box);
+
+/* Fields of a cached run that a run on the same lattice takes over where their
+ * grids overlap, so only cells it did not cover are computed.
+ *
+ * Pressure only depends on transducers, frequency, air wave speed and the position
+ * of a cell, so it is reused whenever those and the cell size are equal. Potential
+ * and force also depend on air and particle constants and the differentiation
+ * order, and are reused only when every simulation parameter but the box is equal.
+ * A potential cell of the earlier run had its whole stencil inside the earlier
+ * pressure grid, so where both potential grids overlap its value is still valid;
+ * the same holds for force. */
+class PartialReuse {
+  ResultReader reader;
+  double cell_size;
+  bool reuse_fields;
+
+ public:
+  // Results at `path` computed with cells of `cell_size`, potential and force are
+  // reused only if `reuse_fields` is set
+  PartialReuse(const std::filesystem::path& path, double cell_size, bool reuse_fields);
+
+  // Box shared by the block with field `name` of the earlier run, if it is reused
+  [[nodiscard]] std::optional<ReusedBox> overlap(
+      std::string_view name,
+      const CellBlockInterpolation& blk) const;
+  // Copy the cells of the shared box of field `name` into the cells of the block
+  // and return the box
+  std::optional<ReusedBox> copy(std::string_view name,
+                                const CellBlockInterpolation& blk,
+                                std::span<std::byte> cells) const;
+};
+
+// Cached whole box run with the same pressure parameters whose pressure grid shares
+// the most cells with the run of `parameters` (as in cache_parameters), or null
+[[nodiscard]] std::unique_ptr<PartialReuse> find_partial_reuse(
+    AtomicLogger::AtomicLogger* result_log,
+    const ResultCache& cache,
+    const nlohmann::json& parameters);
+
+}  // namespace Computation
@@ -0,0 +1,172 @@
+#include <fmt/format.h>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include "Kernels.h"
+#include "Processes.h"
+#include "ResultReader.h"
+
+namespace Computation {
+
+std::size_t particle_process_bytes(const SimulationGrid& grid) {
+  // force of both intensity fields, then potential and force of one particle
+  return (9 * grid.force.get_cell_count() + grid.potential.get_cell_count()) *
+         sizeof(double);
+}
+
+void particleProcess(AtomicLogger::AtomicLogger* result_log,
+                     RunControl* control,
+                     const Config::SimulationParameter& simulation_parameter,
+                     const SimulationGrid& grid,
+                     std::span<const double> pressure_squared,
+                     std::span<const double> gradient_squared,
+                     const std::vector<Config::ParticleParameter>& particles,
+                     ResultSink& sink) {
+  const auto& force_blk = grid.force;
+  const auto& potential_blk = grid.potential;
+  const auto padding = grid.padding;
+  const auto coefficients =
+      central_difference_coefficients(simulation_parameter.differentiation_order);
+
+  result_log->log(fmt::format(
+      FMT_STRING("Computing potential and force of {:d} particles"), particles.size()));
+  control->add_work(force_blk.get_cell_count() +
+                    particles.size() *
+                        (potential_blk.get_cell_count() + force_blk.get_cell_count()));
+
+  // Potential is linear in |p|^2 and |grad p|^2, and so is force, so both are
+  // differentiated once and every particle is a weighted sum of them
+  auto intensity_force = std::array<std::vector<double>, 6>();
+  for (auto& axis_force : intensity_force) {
+    axis_force.resize(force_blk.get_cell_count());
+  }
+
+  parallel_for(control, force_blk.get_cell_count(), 1, [&](std::size_t id) {
+    const auto mid = potential_blk.get_id(force_blk.get_int_vec(id) + padding);
+    for (std::size_t term = 0; term < 2; ++term) {
+      const auto& intensity = term == 0 ? pressure_squared : gradient_squared;
+      const auto f = compute_force(
+          [&](std::size_t axis, std::size_t k) {
+            const auto offset = k * potential_blk.get_stride(axis);
+            return intensity[mid + offset] - intensity[mid - offset];
+          },
+          coefficients, simulation_parameter.cell_size);
+      for (std::size_t axis = 0; axis < 3; ++axis) {
+        intensity_force[3 * term + axis][id] = f[axis];
+      }
+    }
+  });
+
+  auto potential_val = std::vector<double>(potential_blk.get_cell_count());
+  auto force_val = std::array<std::vector<double>, 3>();
+  for (auto& axis_force : force_val) {
+    axis_force.resize(force_blk.get_cell_count());
+  }
+
+  for (const auto& particle : particles) {
+    const auto particle_parameter = particle.applied_to(simulation_parameter);
+    const auto k1 = particle_parameter.constant_k1();
+    const auto k2 = particle_parameter.constant_k2();
+
+    parallel_for(control, potential_blk.get_cell_count(), 1, [&](std::size_t id) {
+      potential_val[id] =
+          combine_potential(pressure_squared[id], gradient_squared[id], k1, k2);
+    });
+    parallel_for(control, force_blk.get_cell_count(), 1, [&](std::size_t id) {
+      for (std::size_t axis = 0; axis < 3; ++axis) {
+        force_val[axis][id] = combine_potential(intensity_force[axis][id],
+                                                intensity_force[3 + axis][id], k1, k2);
+      }
+    });
+
+    const auto attributes = nlohmann::json{
+        {"particle", JSONConvert::from_particle_parameter(particle)}};
+    auto potential_field = make_field_descriptor(
+        "potential_" + particle.name, "float64", sizeof(double), potential_blk);
+    potential_field.attributes = attributes;
+    sink.write_field(sink.begin_field(potential_field),
+                     std::as_bytes(std::span(potential_val)));
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      auto force_field = make_field_descriptor(
+          fmt::format(FMT_STRING("force_{:s}_{:c}"), particle.name, "xyz"[axis]),
+          "float64", sizeof(double), force_blk);
+      force_field.attributes = attributes;
+      sink.write_field(sink.begin_field(force_field),
+                       std::as_bytes(std::span(force_val[axis])));
+    }
+    result_log->log(fmt::format(FMT_STRING("Particle {:s}: k1 {:g}, k2 {:g}"),
+                                particle.name, k1, k2));
+  }
+}
+
+int particleCommand(const std::vector<std::string>& arguments, std::ostream& output) {
+  if (arguments.size() != 3) {
+    output << "Usage: particles <results> <particles.json> <output folder>\n";
+    return 2;
+  }
+
+  auto result_log = AtomicLogger::AtomicLogger();
+  try {
+    const auto reader = ResultReader(arguments[0]);
+    if (not reader.metadata().contains("simulation_parameter")) {
+      throw std::runtime_error("Results do not hold their simulation parameters");
+    }
+    const auto simulation_parameter =
+        JSONConvert::to_simulation_parameter(reader.metadata()["simulation_parameter"]);
+    const auto grid = make_simulation_grid(simulation_parameter);
+
+    auto particle_file = std::ifstream(arguments[1]);
+    if (not particle_file) {
+      throw std::runtime_error("Unable to read " + arguments[1]);
+    }
+    auto particles = std::vector<Config::ParticleParameter>();
+    for (const auto& particle : nlohmann::json::parse(particle_file)) {
+      particles.push_back(JSONConvert::to_particle_parameter(particle));
+    }
+    // validated the same way particles of a run are
+    auto particle_execution = Config::ExecutionParameter();
+    particle_execution.particles = particles;
+    if (const auto invalid = particle_execution.checkInvalidParameter();
+        not invalid.empty()) {
+      throw std::invalid_argument(invalid);
+    }
+
+    const auto pressure_squared = reader.load<double>("pressure_squared");
+    const auto gradient_squared = reader.load<double>("pressure_gradient_squared");
+    if (pressure_squared.get_dimension_size() != grid.potential.get_dimension_size() or
+        gradient_squared.get_dimension_size() != grid.potential.get_dimension_size()) {
+      throw std::runtime_error("Intensity fields do not match the potential grid");
+    }
+
+    // written with default execution parameters
+    const auto execution_parameter = Config::ExecutionParameter();
+    std::filesystem::create_directories(arguments[2]);
+    const auto sink = make_result_sink(&result_log, arguments[2], execution_parameter);
+    auto control = RunControl();
+    particleProcess(&result_log, &control, simulation_parameter, grid,
+                    pressure_squared.cells(), gradient_squared.cells(), particles,
+                    *sink);
+
+    auto metadata = nlohmann::json();
+    metadata["version"] = 1;
+    metadata["simulation_parameter"] = reader.metadata()["simulation_parameter"];
+    metadata["particles"] = nlohmann::json::array();
+    for (const auto& particle : particles) {
+      metadata["particles"].push_back(JSONConvert::from_particle_parameter(particle));
+    }
+    metadata["output_format"] =
+        JSONConvert::from_execution_parameter(execution_parameter)["output_format"];
+    sink->finish(metadata);
+  } catch (const std::exception& e) {
+    output << result_log.read().second;
+    output << "Particle command failed: " << e.what() << "\n";
+    return 1;
+  }
+  output << result_log.read().second;
+  return 0;
+}
+
+}  // namespace Computation
@@ -0,0 +1,36 @@
+#include "PressureEvaluation.h"
+
+namespace Computation {
+
+// Work items per thread needed for dynamic imbalance to stay negligible
+constexpr auto items_per_thread = std::size_t(16);
+
+PressureStrategy choose_pressure_strategy(std::size_t point_cnt,
+                                          std::size_t transducer_cnt) {
+  const auto thread_cnt = current_executor().thread_count;
+
+  if (point_cnt >= thread_cnt * items_per_thread) {
+    return PressureStrategy::PointParallel;
+  }
+  if (transducer_cnt > point_cnt and transducer_cnt >= thread_cnt * items_per_thread) {
+    return PressureStrategy::TransducerParallel;
+  }
+  return PressureStrategy::PointParallel;
+}
+
+std::size_t transducer_grain(std::size_t transducer_cnt) {
+  const auto thread_cnt = current_executor().thread_count;
+  return std::max<std::size_t>(transducer_cnt / (thread_cnt * items_per_thread), 1);
+}
+
+std::string_view to_string(PressureStrategy strategy) {
+  switch (strategy) {
+    case PressureStrategy::PointParallel:
+      return "point-parallel";
+    case PressureStrategy::TransducerParallel:
+      return "transducer-parallel";
+  }
+  return "unknown";
+}
+
+}  // namespace Computation
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <complex>
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "Config.h"
+#include "Executor.h"
+#include "Kernels.h"
+
+namespace Computation {
+
+enum class PressureStrategy {
+  // Each thread sums every transducer for its share of points
+  PointParallel,
+  // Each range of transducers is summed for every point into a partial sum, then
+  // partial sums are reduced
+  TransducerParallel
+};
+
+// Choose strategy from problem shape, points are split if there are enough of them
+// to keep every thread busy, otherwise transducers are split if there are enough
+[[nodiscard]] PressureStrategy choose_pressure_strategy(std::size_t point_cnt,
+                                                        std::size_t transducer_cnt);
+[[nodiscard]] std::string_view to_string(PressureStrategy strategy);
+
+// Transducers summed into one partial sum by transducer-parallel evaluation, few
+// enough for the ranges to balance threads
+[[nodiscard]] std::size_t transducer_grain(std::size_t transducer_cnt);
+
+// Set result[id] to the pressure at position(id) summed over all transducers,
+// counting a unit of work of `control` per point and transducer
+template <typename Position>
+void evaluate_pressure(RunControl* control,
+                       std::span<std::complex<double>> result,
+                       const Position& position,
+                       const std::vector<Config::Transducer>& transducers,
+                       const Config::SimulationParameter& simulation_parameter,
+                       PressureStrategy strategy) {
+  if (strategy == PressureStrategy::PointParallel) {
+    parallel_for(control, result.size(), transducers.size(), [&](std::size_t id) {
+      const auto point = position(id);
+      auto pressure_result = std::complex<double>();
+      for (const auto& transducer : transducers) {
+        pressure_result += compute_pressure(point, transducer, simulation_parameter);
+      }
+      result[id] = pressure_result;
+    });
+    return;
+  }
+
+  const auto partial_sum = [&](std::vector<std::complex<double>>& partial,
+                                std::size_t begin, std::size_t end) {
+    for (auto transducer = begin; transducer < end; ++transducer) {
+      for (std::size_t id = 0; id < result.size(); ++id) {
+        partial[id] += compute_pressure(position(id), transducers[transducer],
+                                        simulation_parameter);
+      }
+    }
+  };
+  const auto add = [](std::vector<std::complex<double>>& sum,
+                      const std::vector<std::complex<double>>& partial) {
+    for (std::size_t id = 0; id < sum.size(); ++id) {
+      sum[id] += partial[id];
+    }
+  };
+  const auto grain = transducer_grain(transducers.size());
+  const auto sum = parallel_reduce(control, transducers.size(), grain, result.size(),
+                                   std::vector<std::complex<double>>(result.size()),
+                                   partial_sum, add);
+  std::copy(sum.begin(), sum.end(), result.begin());
+}
+
+// Set results[k][id] to the pressure of wave number wave_numbers[k] at position(id)
+// summed over all transducers, evaluating every wave number in one pass so the
+// geometry of each point and transducer is computed once
+template <typename Position>
+void evaluate_pressure(RunControl* control,
+                       std::span<const std::span<std::complex<double>>> results,
+                       const Position& position,
+                       const std::vector<Config::Transducer>& transducers,
+                       std::span<const double> wave_numbers) {
+  if (results.empty()) {
+    return;
+  }
+  const auto point_cnt = results.front().size();
+  const auto weight = transducers.size() * wave_numbers.size();
+
+  // every range of points sums into its own scratch of all wave numbers
+  const auto evaluate_range = [&](std::size_t begin, std::size_t end) {
+    auto sums = std::vector<std::complex<double>>(wave_numbers.size());
+    for (auto id = begin; id < end; ++id) {
+      const auto point = position(id);
+      std::fill(sums.begin(), sums.end(), std::complex<double>());
+      for (const auto& transducer : transducers) {
+        accumulate_pressure(pressure_geometry(point, transducer), transducer,
+                            wave_numbers, sums);
+      }
+      for (std::size_t k = 0; k < sums.size(); ++k) {
+        results[k][id] = sums[k];
+      }
+    }
+  };
+  parallel_for_chunks(control, point_cnt, tile_size, weight, evaluate_range);
+}
+
+}  // namespace Computation
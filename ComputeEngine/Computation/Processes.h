@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+#include "../Utilities/AtomicLogger.h"
+#include "Checkpoint.h"
+#include "Config.h"
+#include "Executor.h"
+#include "PartialReuse.h"
+#include "ResultSink.h"
+#include "SimulationGrid.h"
+
+namespace Computation {
+
+// Processes write every result field into the sink. They announce their work to
+// `control` when they start, count it as they go and stop with RunCancelled once
+// it is cancelled
+
+// Compute every stage with whole grids held in memory, `export_directory` holds the
+// result files blocks are mapped from. Intermediate fields are saved into and
+// restored from `checkpoint` unless it is null, and cells shared with the cached
+// run of `reuse` are copied from it instead of computed unless it is null
+void residentProcess(AtomicLogger::AtomicLogger* result_log,
+                     RunControl* control,
+                     const std::filesystem::path& export_directory,
+                     const std::vector<Config::Transducer>& transducers,
+                     const Config::SimulationParameter& simulation_parameter,
+                     const Config::ExecutionParameter& execution_parameter,
+                     const SimulationGrid& grid,
+                     ResultSink& sink,
+                     Checkpoint* checkpoint,
+                     const PartialReuse* reuse);
+
+// Compute only the selected output fields and what they read, fusing the fields of
+// each grid into one sweep and releasing every block once no sweep reads it
+void graphProcess(AtomicLogger::AtomicLogger* result_log,
+                  RunControl* control,
+                  const std::filesystem::path& export_directory,
+                  const std::vector<Config::Transducer>& transducers,
+                  const Config::SimulationParameter& simulation_parameter,
+                  const Config::ExecutionParameter& execution_parameter,
+                  const SimulationGrid& grid,
+                  ResultSink& sink);
+
+// Compute every stage one x-slab at a time, writing each slab once it is done
+void slabStreamingProcess(AtomicLogger::AtomicLogger* result_log,
+                          RunControl* control,
+                          const std::vector<Config::Transducer>& transducers,
+                          const Config::SimulationParameter& simulation_parameter,
+                          const Config::ExecutionParameter& execution_parameter,
+                          const SimulationGrid& grid,
+                          ResultSink& sink);
+
+// Compute pressure, potential and force of every point of the sweep of the
+// execution parameter into the sink of the same index, sharing between points the
+// work that does not depend on the swept parameter
+void sweepProcess(AtomicLogger::AtomicLogger* result_log,
+                  RunControl* control,
+                  const std::vector<Config::Transducer>& transducers,
+                  const Config::SimulationParameter& simulation_parameter,
+                  const Config::ExecutionParameter& execution_parameter,
+                  const SimulationGrid& grid,
+                  std::span<const std::unique_ptr<ResultSink>> sinks);
+
+// Compute pressure, potential and force of every frequency of the simulation
+// parameter as fields suffixed with its index, evaluating pressure of all of them in
+// one pass, and their incoherent sum if the execution parameter asks for it
+void multiFrequencyProcess(AtomicLogger::AtomicLogger* result_log,
+                           RunControl* control,
+                           const std::vector<Config::Transducer>& transducers,
+                           const Config::SimulationParameter& simulation_parameter,
+                           const Config::ExecutionParameter& execution_parameter,
+                           const SimulationGrid& grid,
+                           ResultSink& sink);
+
+// Bytes particleProcess allocates for a grid
+[[nodiscard]] std::size_t particle_process_bytes(const SimulationGrid& grid);
+
+// Write potential and force of each particle, combined from |p|^2 and |grad p|^2 on
+// the potential grid, as fields `potential_<name>` and `force_<name>_x/y/z`
+void particleProcess(AtomicLogger::AtomicLogger* result_log,
+                     RunControl* control,
+                     const Config::SimulationParameter& simulation_parameter,
+                     const SimulationGrid& grid,
+                     std::span<const double> pressure_squared,
+                     std::span<const double> gradient_squared,
+                     const std::vector<Config::ParticleParameter>& particles,
+                     ResultSink& sink);
+
+// Command line deriving particles from exported intensity fields, arguments are
+// the results, a JSON list of particles and the folder to write their fields into.
+// Returns the exit code
+int particleCommand(const std::vector<std::string>& arguments, std::ostream& output);
+
+// Points a target is evaluated at, consecutive polyline samples are `spacing` apart
+// unless a segment is not a whole multiple of it, then they are evenly closer
+[[nodiscard]] std::vector<Vec3<double>> sample_target_points(
+    const Config::EvaluationTarget& target);
+
+// Compute fields only at the sampled points of each target, return their metadata
+nlohmann::json targetProcess(AtomicLogger::AtomicLogger* result_log,
+                             RunControl* control,
+                             const std::vector<Config::Transducer>& transducers,
+                             const Config::SimulationParameter& simulation_parameter,
+                             const Config::ExecutionParameter& execution_parameter,
+                             ResultSink& sink);
+
+}  // namespace Computation
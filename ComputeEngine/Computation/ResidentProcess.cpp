@@ -0,0 +1,407 @@
+#include <fmt/format.h>
+#include <array>
+#include <complex>
+#include <future>
+#include <map>
+#include <optional>
+#include "../Utilities/AsyncWriter.h"
+#include "BlockStorage.h"
+#include "Kernels.h"
+#include "MemoryPlanner.h"
+#include "PartialReuse.h"
+#include "PressureEvaluation.h"
+#include "Processes.h"
+#include "ResultSink.h"
+
+namespace Computation {
+
+void residentProcess(AtomicLogger::AtomicLogger* result_log,
+                     RunControl* control,
+                     const std::filesystem::path& export_directory,
+                     const std::vector<Config::Transducer>& transducers,
+                     const Config::SimulationParameter& simulation_parameter,
+                     const Config::ExecutionParameter& execution_parameter,
+                     const SimulationGrid& grid,
+                     ResultSink& sink,
+                     Checkpoint* checkpoint,
+                     const PartialReuse* reuse) {
+  const auto& force_blk = grid.force;
+  const auto& potential_blk = grid.potential;
+  const auto& pressure_blk = grid.pressure;
+  const auto padding = grid.padding;
+  const auto coefficients =
+      central_difference_coefficients(simulation_parameter.differentiation_order);
+
+  // Buffers are allocated when the stage producing them starts, and exported then
+  // freed as soon as the last stage reading them finishes, so peak memory is the
+  // largest set of buffers alive at once rather than the sum of all of them
+  auto pressure_val = std::optional<CellBlock<std::complex<double>>>();
+  auto potential_val = std::optional<CellBlock<double>>();
+  auto force_x_val = std::optional<CellBlock<double>>();
+  auto force_y_val = std::optional<CellBlock<double>>();
+  auto force_z_val = std::optional<CellBlock<double>>();
+  // |p|^2 and |grad p|^2 are kept when exported or when particles are derived
+  // from them
+  const auto intensity =
+      execution_parameter.export_intensity or not execution_parameter.particles.empty();
+  auto pressure_squared_val = std::optional<CellBlock<double>>();
+  auto gradient_squared_val = std::optional<CellBlock<double>>();
+
+  // Every block is one field of the sink
+  const auto pressure_field = sink.begin_field(make_field_descriptor(
+      "pressure", "complex128", sizeof(std::complex<double>), pressure_blk));
+  const auto potential_field = sink.begin_field(
+      make_field_descriptor("potential", "float64", sizeof(double), potential_blk));
+  const auto force_x_field = sink.begin_field(
+      make_field_descriptor("force_x", "float64", sizeof(double), force_blk));
+  const auto force_y_field = sink.begin_field(
+      make_field_descriptor("force_y", "float64", sizeof(double), force_blk));
+  const auto force_z_field = sink.begin_field(
+      make_field_descriptor("force_z", "float64", sizeof(double), force_blk));
+  auto intensity_fields = std::optional<std::array<std::size_t, 2>>();
+  if (execution_parameter.export_intensity) {
+    intensity_fields = std::array{
+        sink.begin_field(make_field_descriptor("pressure_squared", "float64",
+                                               sizeof(double), potential_blk)),
+        sink.begin_field(make_field_descriptor("pressure_gradient_squared", "float64",
+                                               sizeof(double), potential_blk))};
+  }
+
+  // Blocks are either allocated in memory or mapped from their legacy result file,
+  // the container stores chunks so it can not be computed into directly
+  const auto mapped_output =
+      execution_parameter.mapped_output and
+      execution_parameter.output_format == Config::OutputFormat::Legacy;
+  const auto allocate = [&](auto& block, const CellBlockInterpolation& blk,
+                            std::string_view file_name) {
+    if (mapped_output) {
+      block.emplace(blk.get_dimension_size(), export_directory / file_name);
+    } else {
+      block.emplace(blk.get_dimension_size());
+    }
+  };
+
+  // Blocks are written in the background as soon as their stage is done, while
+  // later stages still read them, and are waited on before being released. The
+  // writer is declared after the blocks so it finishes before they are destroyed
+  auto writer = std::optional<AsyncWriter::AsyncWriter>();
+  if (execution_parameter.async_export and not mapped_output) {
+    writer.emplace();
+  }
+  auto pending_exports = std::map<std::size_t, std::shared_future<void>>();
+
+  // Checkpoint saves also read blocks in the background, and finish before the
+  // blocks are destroyed even if a stage fails
+  struct SaveDrain {
+    Checkpoint* checkpoint;
+    ~SaveDrain() {
+      if (checkpoint != nullptr) {
+        checkpoint->drain();
+      }
+    }
+  };
+  const auto save_drain = SaveDrain{checkpoint};
+
+  const auto start_export = [&](auto& block, std::size_t field) {
+    if (writer) {
+      // the writer thread runs the loops of the sink with the executor of the run,
+      // so exports stay within its cores and backend
+      pending_exports[field] =
+          writer->submit([&sink, &block, field, executor = current_executor()]() {
+            const auto executor_scope = ExecutorScope(executor);
+            sink.write_field(field, std::as_bytes(block->cells()));
+          });
+    }
+  };
+  const auto finish_export = [&](auto& block, std::size_t field) {
+    if (const auto pending = pending_exports.find(field);
+        pending != pending_exports.end()) {
+      pending->second.get();
+      pending_exports.erase(pending);
+    } else if (block->is_mapped()) {
+      // mapped blocks already live in their result file
+      block->flush();
+    } else {
+      sink.write_field(field, std::as_bytes(block->cells()));
+    }
+    block.reset();
+  };
+
+  auto planner = MemoryPlanner();
+  const auto pressure_stage = planner.add_stage("pressure");
+  const auto potential_stage = planner.add_stage("potential");
+  const auto force_stage = planner.add_stage("force");
+  const auto particle_stage = execution_parameter.particles.empty()
+                                  ? force_stage
+                                  : planner.add_stage("particles");
+
+  planner.add_buffer(
+      "pressure", pressure_blk.get_cell_count() * sizeof(std::complex<double>),
+      pressure_stage, potential_stage,
+      [&]() {
+        result_log->log("Finishing pressure export");
+        if (checkpoint != nullptr) {
+          checkpoint->wait("pressure");
+        }
+        finish_export(pressure_val, pressure_field);
+      },
+      [&]() { start_export(pressure_val, pressure_field); });
+  planner.add_buffer(
+      "potential", potential_blk.get_cell_count() * sizeof(double), potential_stage,
+      force_stage,
+      [&]() {
+        result_log->log("Finishing potential export");
+        if (checkpoint != nullptr) {
+          checkpoint->wait("potential");
+        }
+        finish_export(potential_val, potential_field);
+      },
+      [&]() { start_export(potential_val, potential_field); });
+  planner.add_buffer(
+      "force", 3 * force_blk.get_cell_count() * sizeof(double), force_stage,
+      force_stage,
+      [&]() {
+        result_log->log("Finishing force export");
+        finish_export(force_x_val, force_x_field);
+        finish_export(force_y_val, force_y_field);
+        finish_export(force_z_val, force_z_field);
+      },
+      [&]() {
+        start_export(force_x_val, force_x_field);
+        start_export(force_y_val, force_y_field);
+        start_export(force_z_val, force_z_field);
+      });
+  if (intensity) {
+    planner.add_buffer(
+        "intensity", 2 * potential_blk.get_cell_count() * sizeof(double),
+        potential_stage,
+        execution_parameter.particles.empty() ? potential_stage : particle_stage,
+        [&]() {
+          if (intensity_fields) {
+            result_log->log("Finishing intensity export");
+            finish_export(pressure_squared_val, (*intensity_fields)[0]);
+            finish_export(gradient_squared_val, (*intensity_fields)[1]);
+          } else {
+            pressure_squared_val.reset();
+            gradient_squared_val.reset();
+          }
+        },
+        [&]() {
+          if (intensity_fields) {
+            start_export(pressure_squared_val, (*intensity_fields)[0]);
+            start_export(gradient_squared_val, (*intensity_fields)[1]);
+          }
+        });
+  }
+  if (not execution_parameter.particles.empty()) {
+    planner.add_buffer("particle fields", particle_process_bytes(grid), particle_stage,
+                       particle_stage, []() {});
+  }
+
+  result_log->log(fmt::format(FMT_STRING("Predicted peak memory: {:s} ({:s} stage)"),
+                              format_bytes(planner.predicted_peak_bytes()),
+                              planner.predicted_peak_stage()));
+
+  // Pressure takes a unit of work per cell and transducer, other stages one per cell
+  const auto pressure_work = transducers.size();
+  control->add_work(pressure_blk.get_cell_count() * pressure_work +
+                    potential_blk.get_cell_count() + force_blk.get_cell_count());
+
+  result_log->log("Computing pressure");
+
+  planner.begin_stage(pressure_stage);
+  allocate(pressure_val, pressure_blk, "pressure_result.bin");
+
+  // With checkpoints pressure is computed in batches of x-slabs, each one saved
+  // once the checkpoint interval elapsed, and resumed runs start after the slabs
+  // saved last
+  const auto pressure_slab = pressure_blk.get_stride(0);
+  const auto pressure_slab_cnt = pressure_blk.get_dimension_size().x;
+  const auto pressure_slab_bytes = pressure_slab * sizeof(std::complex<double>);
+  auto first_slab = std::size_t(0);
+  auto batch_slab_cnt = pressure_slab_cnt;
+  if (checkpoint != nullptr) {
+    first_slab = std::min(checkpoint->saved_bytes("pressure") / pressure_slab_bytes,
+                          pressure_slab_cnt);
+    if (first_slab > 0) {
+      checkpoint->restore("pressure", std::as_writable_bytes(pressure_val->cells())
+                                          .first(first_slab * pressure_slab_bytes));
+      control->advance(first_slab * pressure_slab * pressure_work);
+    }
+    batch_slab_cnt = std::max(pressure_slab_cnt / 32, std::size_t(1));
+  }
+
+  // Cells shared with a cached run on the same lattice are copied and only the
+  // others computed, unless pressure is resumed from a checkpoint instead
+  const auto pressure_box =
+      reuse != nullptr and first_slab == 0
+          ? reuse->copy("pressure", pressure_blk,
+                        std::as_writable_bytes(pressure_val->cells()))
+          : std::nullopt;
+  if (pressure_box) {
+    const auto missing = cells_outside(pressure_blk, *pressure_box);
+    const auto strategy = choose_pressure_strategy(missing.size(), transducers.size());
+    result_log->log(fmt::format(FMT_STRING("Pressure evaluation of {:d} cells: {:s}"),
+                                missing.size(), to_string(strategy)));
+    control->advance((pressure_blk.get_cell_count() - missing.size()) * pressure_work);
+    auto missing_val = std::vector<std::complex<double>>(missing.size());
+    evaluate_pressure(
+        control, std::span(missing_val),
+        [&](std::size_t id) { return pressure_blk.get_real_vec(missing[id]); },
+        transducers, simulation_parameter, strategy);
+
+    parallel_for(control, missing.size(), 0, [&](std::size_t id) {
+      pressure_val->set_cell(missing[id], missing_val[id]);
+    });
+
+    if (checkpoint != nullptr) {
+      checkpoint->save("pressure", std::as_bytes(pressure_val->cells()),
+                       pressure_slab_cnt * pressure_slab_bytes);
+    }
+  } else {
+    const auto strategy =
+        choose_pressure_strategy(batch_slab_cnt * pressure_slab, transducers.size());
+    result_log->log(fmt::format(FMT_STRING("Pressure evaluation: {:s}"),
+                                to_string(strategy)));
+    for (auto x = first_slab; x < pressure_slab_cnt; x += batch_slab_cnt) {
+      const auto last_slab = std::min(x + batch_slab_cnt, pressure_slab_cnt);
+      const auto offset = x * pressure_slab;
+      evaluate_pressure(
+          control,
+          pressure_val->cells().subspan(offset, (last_slab - x) * pressure_slab),
+          [&](std::size_t id) { return pressure_blk.get_real_vec(offset + id); },
+          transducers, simulation_parameter, strategy);
+
+      if (checkpoint != nullptr and
+          (last_slab == pressure_slab_cnt or checkpoint->is_due())) {
+        checkpoint->save("pressure", std::as_bytes(pressure_val->cells()),
+                         last_slab * pressure_slab_bytes);
+      }
+    }
+  }
+
+  planner.finish_stage(pressure_stage);
+
+  result_log->log("Computing potential");
+
+  // constant used for potential computation
+  const auto k1 = simulation_parameter.constant_k1();
+  const auto k2 = simulation_parameter.constant_k2();
+
+  planner.begin_stage(potential_stage);
+  allocate(potential_val, potential_blk, "potential_result.bin");
+  if (intensity_fields) {
+    allocate(pressure_squared_val, potential_blk, "pressure_squared_result.bin");
+    allocate(gradient_squared_val, potential_blk,
+             "pressure_gradient_squared_result.bin");
+  } else if (intensity) {
+    pressure_squared_val.emplace(potential_blk.get_dimension_size());
+    gradient_squared_val.emplace(potential_blk.get_dimension_size());
+  }
+
+  // Intensity is not checkpointed, so potential is computed again along with it
+  const auto potential_bytes = potential_blk.get_cell_count() * sizeof(double);
+  const auto potential_saved = checkpoint != nullptr and not intensity and
+                               checkpoint->saved_bytes("potential") == potential_bytes;
+  if (potential_saved) {
+    checkpoint->restore("potential", std::as_writable_bytes(potential_val->cells()));
+    control->advance(potential_blk.get_cell_count());
+  } else {
+    const auto potential_at = [&](std::size_t id) {
+      const auto mid = pressure_blk.get_id(potential_blk.get_int_vec(id) + padding);
+
+      const auto [pressure_squared, gradient_squared] = compute_intensity(
+          pressure_val->get_cell(mid),
+          [&](std::size_t axis, std::size_t k) {
+            const auto offset = k * pressure_blk.get_stride(axis);
+            return pressure_val->get_cell(mid + offset) -
+                   pressure_val->get_cell(mid - offset);
+          },
+          coefficients, simulation_parameter.cell_size);
+      potential_val->set_cell(
+          id, combine_potential(pressure_squared, gradient_squared, k1, k2));
+      if (intensity) {
+        pressure_squared_val->set_cell(id, pressure_squared);
+        gradient_squared_val->set_cell(id, gradient_squared);
+      }
+    };
+
+    // shared cells of a cached run had their whole stencil in its pressure grid,
+    // intensity is not cached so every cell is computed when it is kept
+    const auto potential_box =
+        reuse != nullptr and not intensity
+            ? reuse->copy("potential", potential_blk,
+                          std::as_writable_bytes(potential_val->cells()))
+            : std::nullopt;
+    if (potential_box) {
+      const auto missing = cells_outside(potential_blk, *potential_box);
+      control->advance(potential_blk.get_cell_count() - missing.size());
+      parallel_for(control, missing.size(), 1,
+                   [&](std::size_t id) { potential_at(missing[id]); });
+    } else {
+      parallel_for(control, potential_blk.get_cell_count(), 1, potential_at);
+    }
+
+    if (checkpoint != nullptr) {
+      checkpoint->save("potential", std::as_bytes(potential_val->cells()),
+                       potential_bytes);
+    }
+  }
+
+  planner.finish_stage(potential_stage);
+
+  result_log->log("Computing force");
+
+  planner.begin_stage(force_stage);
+  allocate(force_x_val, force_blk, "force_x_result.bin");
+  allocate(force_y_val, force_blk, "force_y_result.bin");
+  allocate(force_z_val, force_blk, "force_z_result.bin");
+
+  const auto force_at = [&](std::size_t id) {
+    const auto mid = potential_blk.get_id(force_blk.get_int_vec(id) + padding);
+
+    const auto f = compute_force(
+        [&](std::size_t axis, std::size_t k) {
+          const auto offset = k * potential_blk.get_stride(axis);
+          return potential_val->get_cell(mid + offset) -
+                 potential_val->get_cell(mid - offset);
+        },
+        coefficients, simulation_parameter.cell_size);
+
+    force_x_val->set_cell(id, f[0]);
+    force_y_val->set_cell(id, f[1]);
+    force_z_val->set_cell(id, f[2]);
+  };
+
+  const auto force_box =
+      reuse != nullptr ? reuse->copy("force_x", force_blk,
+                                     std::as_writable_bytes(force_x_val->cells()))
+                       : std::nullopt;
+  if (force_box) {
+    reuse->copy("force_y", force_blk, std::as_writable_bytes(force_y_val->cells()));
+    reuse->copy("force_z", force_blk, std::as_writable_bytes(force_z_val->cells()));
+    const auto missing = cells_outside(force_blk, *force_box);
+    control->advance(force_blk.get_cell_count() - missing.size());
+    parallel_for(control, missing.size(), 1,
+                 [&](std::size_t id) { force_at(missing[id]); });
+  } else {
+    parallel_for(control, force_blk.get_cell_count(), 1, force_at);
+  }
+
+  planner.finish_stage(force_stage);
+
+  if (not execution_parameter.particles.empty()) {
+    planner.begin_stage(particle_stage);
+    particleProcess(result_log, control, simulation_parameter, grid,
+                    pressure_squared_val->cells(), gradient_squared_val->cells(),
+                    execution_parameter.particles, sink);
+    planner.finish_stage(particle_stage);
+  }
+
+  result_log->log(fmt::format(
+      FMT_STRING("Peak memory: predicted {:s}, tracked {:s}, measured {:s}"),
+      format_bytes(planner.predicted_peak_bytes()),
+      format_bytes(planner.tracked_peak()), planner.format_measured_peak()));
+}
+
+}  // namespace Computation
@@ -0,0 +1,364 @@
+#include "ResultCache.h"
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+#include "../Utilities/Hash.h"
+#include "MemoryPlanner.h"
+#include "Simulator.h"
+
+namespace Computation {
+
+namespace {
+
+constexpr auto entry_name = std::string_view("entry.json");
+
+std::int64_t now() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+std::string format_time(std::int64_t milliseconds) {
+  const auto time = std::chrono::system_clock::time_point(
+      std::chrono::milliseconds(milliseconds));
+  return fmt::format(FMT_STRING("{:%Y-%m-%d %H:%M:%S}"),
+                     fmt::localtime(std::chrono::system_clock::to_time_t(time)));
+}
+
+// Keys name folders, so anything but a hash is refused
+void check_key(std::string_view key) {
+  if (key.empty() or not std::all_of(key.begin(), key.end(), [](char c) {
+        return (c >= '0' and c <= '9') or (c >= 'a' and c <= 'f');
+      })) {
+    throw std::invalid_argument("Invalid cache key: " + std::string(key));
+  }
+}
+
+std::uint64_t hash_file(const std::filesystem::path& path) {
+  auto file = std::ifstream(path, std::fstream::binary);
+  if (not file) {
+    throw std::runtime_error("Unable to read " + path.string());
+  }
+  auto hash = Hash::fnv1a_basis;
+  auto buffer = std::string(std::size_t(1) << 20, '\0');
+  while (file) {
+    file.read(buffer.data(), std::streamsize(buffer.size()));
+    hash = Hash::fnv1a(std::string_view(buffer.data(), std::size_t(file.gcount())),
+                       hash);
+  }
+  return hash;
+}
+
+void link_or_copy(const std::filesystem::path& source,
+                  const std::filesystem::path& target) {
+  auto link_error = std::error_code();
+  std::filesystem::create_hard_link(source, target, link_error);
+  if (link_error) {
+    std::filesystem::copy_file(source, target,
+                               std::filesystem::copy_options::overwrite_existing);
+  }
+}
+
+nlohmann::json to_json(const CacheEntry& entry) {
+  auto result = nlohmann::json();
+  result["version"] = 1;
+  result["key"] = entry.key;
+  result["parameters"] = entry.parameters;
+  result["files"] = entry.files;
+  result["bytes"] = entry.bytes;
+  result["created"] = entry.created;
+  result["last_used"] = entry.last_used;
+  return result;
+}
+
+void write_entry_file(const std::filesystem::path& folder, const CacheEntry& entry) {
+  // renaming replaces the entry file at once, so it is never seen half written
+  const auto entry_path = folder / entry_name;
+  auto temporary_path = entry_path;
+  temporary_path += ".tmp";
+  {
+    auto entry_file = std::ofstream(temporary_path, std::fstream::trunc);
+    entry_file << to_json(entry).dump();
+    if (not entry_file) {
+      throw std::runtime_error("Unable to write cache entry " + entry.key);
+    }
+  }
+  std::filesystem::rename(temporary_path, entry_path);
+}
+
+}  // namespace
+
+nlohmann::json cache_parameters(
+    const std::vector<Config::Transducer>& transducers,
+    const Config::SimulationParameter& simulation_parameter,
+    const Config::ExecutionParameter& execution_parameter) {
+  auto result = nlohmann::json();
+  result["engine_version"] = engine_version;
+  result["precision"] = precision_mode;
+  result["simulation_parameter"] =
+      JSONConvert::from_simulation_parameter(simulation_parameter);
+  result["transducers"] = nlohmann::json::array();
+  for (const auto& transducer : transducers) {
+    result["transducers"].push_back(JSONConvert::from_transducer(transducer));
+  }
+
+  // how results are computed and where they are streamed does not change files
+  auto execution = JSONConvert::from_execution_parameter(execution_parameter);
+  for (const auto* key :
+       {"slab_streaming", "mapped_output", "async_export", "write_queue_depth",
+        "direct_io", "output_stream", "shared_memory_name", "shared_memory_size",
+        "checkpoint", "checkpoint_interval", "resume", "result_cache",
+        "result_cache_size", "sweep_batch", "parallel_backend"}) {
+    execution.erase(key);
+  }
+  result["execution_parameter"] = execution;
+
+  result["point_files"] = nlohmann::json::object();
+  for (const auto& target : execution_parameter.targets) {
+    if (target.kind == Config::EvaluationTarget::Kind::PointCloud) {
+      result["point_files"][target.point_file] =
+          Hash::to_hex(hash_file(target.point_file));
+    }
+  }
+  return result;
+}
+
+std::string cache_key(const nlohmann::json& parameters) {
+  // objects are sorted by key, so equal parameters always dump the same
+  return Hash::to_hex(Hash::fnv1a(parameters.dump()));
+}
+
+ResultCache::ResultCache(std::filesystem::path directory)
+    : directory(std::move(directory)) {}
+
+std::optional<CacheEntry> ResultCache::read_entry(std::string_view key) const {
+  const auto entry_path = this->directory / key / entry_name;
+  if (not std::filesystem::exists(entry_path)) {
+    return std::nullopt;
+  }
+  try {
+    auto entry_file = std::ifstream(entry_path);
+    const auto json = nlohmann::json::parse(entry_file);
+    auto result = CacheEntry();
+    result.key = json.at("key").get<std::string>();
+    result.parameters = json.at("parameters");
+    result.files = json.at("files").get<std::vector<std::string>>();
+    result.bytes = json.at("bytes").get<std::uint64_t>();
+    result.created = json.at("created").get<std::int64_t>();
+    result.last_used = json.value("last_used", result.created);
+    return result;
+  } catch (const nlohmann::json::exception&) {
+    // an unreadable entry is treated as missing and replaced by the next store
+    return std::nullopt;
+  }
+}
+
+void ResultCache::write_entry(const CacheEntry& entry) const {
+  write_entry_file(this->directory / entry.key, entry);
+}
+
+std::vector<CacheEntry> ResultCache::entries() const {
+  auto result = std::vector<CacheEntry>();
+  if (not std::filesystem::is_directory(this->directory)) {
+    return result;
+  }
+  for (const auto& item : std::filesystem::directory_iterator(this->directory)) {
+    // unfinished entries have a suffix after the key and are skipped
+    const auto name = item.path().filename().string();
+    if (item.is_directory() and name.find('.') == std::string::npos) {
+      if (auto entry = this->read_entry(name)) {
+        result.push_back(std::move(*entry));
+      }
+    }
+  }
+  std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+    return a.last_used > b.last_used;
+  });
+  return result;
+}
+
+std::optional<CacheEntry> ResultCache::find(std::string_view key) const {
+  check_key(key);
+  return this->read_entry(key);
+}
+
+std::uint64_t ResultCache::size() const {
+  auto result = std::uint64_t(0);
+  for (const auto& entry : this->entries()) {
+    result += entry.bytes;
+  }
+  return result;
+}
+
+std::optional<CacheEntry> ResultCache::restore(
+    std::string_view key,
+    const nlohmann::json& parameters,
+    const std::filesystem::path& export_directory) {
+  auto entry = this->find(key);
+  // equal hashes of other parameters are a miss, and so are entries missing files
+  if (not entry or entry->parameters != parameters) {
+    return std::nullopt;
+  }
+  const auto entry_path = this->directory / entry->key;
+  for (const auto& file : entry->files) {
+    if (not std::filesystem::exists(entry_path / file)) {
+      return std::nullopt;
+    }
+  }
+
+  std::filesystem::create_directories(export_directory);
+  for (const auto& file : entry->files) {
+    std::filesystem::remove(export_directory / file);
+    link_or_copy(entry_path / file, export_directory / file);
+  }
+
+  entry->last_used = now();
+  this->write_entry(*entry);
+  return entry;
+}
+
+CacheEntry ResultCache::store(std::string_view key,
+                              const nlohmann::json& parameters,
+                              const std::vector<std::filesystem::path>& files) {
+  check_key(key);
+  auto entry = CacheEntry{std::string(key), parameters, {}, 0, now(), now()};
+
+  // assembled next to its final place and renamed, so it appears complete
+  auto random = std::random_device();
+  const auto temporary_path =
+      this->directory / fmt::format(FMT_STRING("{:s}.partial-{:08x}"), key, random());
+  std::filesystem::create_directories(temporary_path);
+  try {
+    for (const auto& file : files) {
+      const auto name = file.filename().string();
+      link_or_copy(file, temporary_path / name);
+      entry.files.push_back(name);
+      entry.bytes += std::filesystem::file_size(temporary_path / name);
+    }
+    write_entry_file(temporary_path, entry);
+
+    const auto entry_path = this->directory / entry.key;
+    std::filesystem::remove_all(entry_path);
+    std::filesystem::rename(temporary_path, entry_path);
+  } catch (...) {
+    auto remove_error = std::error_code();
+    std::filesystem::remove_all(temporary_path, remove_error);
+    throw;
+  }
+  return entry;
+}
+
+std::vector<CacheEntry> ResultCache::evict(std::uint64_t capacity) {
+  auto cached = this->entries();
+  auto total = std::uint64_t(0);
+  for (const auto& entry : cached) {
+    total += entry.bytes;
+  }
+
+  auto result = std::vector<CacheEntry>();
+  while (total > capacity and not cached.empty()) {
+    this->remove(cached.back().key);
+    total -= cached.back().bytes;
+    result.push_back(std::move(cached.back()));
+    cached.pop_back();
+  }
+  return result;
+}
+
+void ResultCache::remove(std::string_view key) {
+  check_key(key);
+  std::filesystem::remove_all(this->directory / key);
+}
+
+void ResultCache::clear() {
+  if (not std::filesystem::is_directory(this->directory)) {
+    return;
+  }
+  auto folders = std::vector<std::filesystem::path>();
+  for (const auto& item : std::filesystem::directory_iterator(this->directory)) {
+    if (item.is_directory()) {
+      folders.push_back(item.path());
+    }
+  }
+  for (const auto& folder : folders) {
+    std::filesystem::remove_all(folder);
+  }
+}
+
+int cacheCommand(const std::vector<std::string>& arguments, std::ostream& output) {
+  const auto command = arguments.empty() ? std::string() : arguments[0];
+  const auto argument_cnt = [&]() -> std::size_t {
+    if (command == "list" or command == "clear") {
+      return 2;
+    }
+    if (command == "info" or command == "remove" or command == "evict") {
+      return 3;
+    }
+    return 0;
+  }();
+  if (argument_cnt == 0 or arguments.size() != argument_cnt) {
+    output << "Usage: cache list <folder>\n"
+              "       cache info <folder> <key>\n"
+              "       cache remove <folder> <key>\n"
+              "       cache evict <folder> <MiB>\n"
+              "       cache clear <folder>\n";
+    return 2;
+  }
+
+  try {
+    auto cache = ResultCache(arguments[1]);
+    if (command == "list") {
+      const auto cached = cache.entries();
+      auto total = std::uint64_t(0);
+      for (const auto& entry : cached) {
+        output << fmt::format(FMT_STRING("{:s}  {:>10s}  {:3d} files  used {:s}\n"),
+                              entry.key, format_bytes(entry.bytes), entry.files.size(),
+                              format_time(entry.last_used));
+        total += entry.bytes;
+      }
+      output << fmt::format(FMT_STRING("{:d} entries, {:s}\n"), cached.size(),
+                            format_bytes(total));
+    } else if (command == "info") {
+      const auto entry = cache.find(arguments[2]);
+      if (not entry) {
+        output << "No cache entry " << arguments[2] << "\n";
+        return 1;
+      }
+      output << fmt::format(FMT_STRING("Key:       {:s}\n"
+                                       "Size:      {:s}\n"
+                                       "Created:   {:s}\n"
+                                       "Last used: {:s}\n"
+                                       "Files:     {:s}\n"),
+                            entry->key, format_bytes(entry->bytes),
+                            format_time(entry->created), format_time(entry->last_used),
+                            fmt::join(entry->files, ", "));
+      output << "Parameters:\n" << entry->parameters.dump(2) << "\n";
+    } else if (command == "remove") {
+      if (not cache.find(arguments[2])) {
+        output << "No cache entry " << arguments[2] << "\n";
+        return 1;
+      }
+      cache.remove(arguments[2]);
+    } else if (command == "evict") {
+      const auto capacity = std::uint64_t(std::stoull(arguments[2])) * 1024 * 1024;
+      for (const auto& entry : cache.evict(capacity)) {
+        output << fmt::format(FMT_STRING("Removed {:s} ({:s})\n"), entry.key,
+                              format_bytes(entry.bytes));
+      }
+    } else {
+      cache.clear();
+    }
+  } catch (const std::exception& e) {
+    output << "Cache command failed: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace Computation
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Config.h"
+
+namespace Computation {
+
+// Canonical JSON of everything results depend on: engine version, precision,
+// transducers, simulation parameters, the execution parameters that change output
+// files and the content of point cloud files
+[[nodiscard]] nlohmann::json cache_parameters(
+    const std::vector<Config::Transducer>& transducers,
+    const Config::SimulationParameter& simulation_parameter,
+    const Config::ExecutionParameter& execution_parameter);
+
+// Hash (hex FNV-1a of the canonical JSON) results are cached under
+[[nodiscard]] std::string cache_key(const nlohmann::json& parameters);
+
+struct CacheEntry {
+  std::string key;
+  nlohmann::json parameters;
+  // Names of the cached files
+  std::vector<std::string> files;
+  std::uint64_t bytes = 0;
+  // Milliseconds since epoch
+  std::int64_t created = 0;
+  std::int64_t last_used = 0;
+};
+
+/* Output files of earlier runs, keyed by their parameters.
+ *
+ * Every entry is a `<key>` folder holding the output files and `entry.json` with the
+ * parameters, file names, size and times of creation and last use. Entries are
+ * complete once they appear, as they are assembled in a temporary folder and renamed.
+ * Files are hard linked between the cache and export directories when both are on
+ * the same file system and copied otherwise; result writers replace existing files
+ * instead of writing into them, so later runs never change a cached file. */
+class ResultCache {
+  std::filesystem::path directory;
+
+  [[nodiscard]] std::optional<CacheEntry> read_entry(std::string_view key) const;
+  void write_entry(const CacheEntry& entry) const;
+
+ public:
+  explicit ResultCache(std::filesystem::path directory);
+
+  [[nodiscard]] const std::filesystem::path& get_directory() const { return directory; }
+
+  // Every entry, most recently used first
+  [[nodiscard]] std::vector<CacheEntry> entries() const;
+  [[nodiscard]] std::optional<CacheEntry> find(std::string_view key) const;
+  // Bytes of every entry
+  [[nodiscard]] std::uint64_t size() const;
+
+  // Put the files of the entry into the export directory if its parameters match,
+  // returns the entry restored
+  std::optional<CacheEntry> restore(std::string_view key,
+                                    const nlohmann::json& parameters,
+                                    const std::filesystem::path& export_directory);
+  // Add the output files of a run, replacing an entry of the same key
+  CacheEntry store(std::string_view key,
+                   const nlohmann::json& parameters,
+                   const std::vector<std::filesystem::path>& files);
+
+  // Remove least recently used entries until the cache holds at most `capacity`
+  // bytes, returns the entries removed
+  std::vector<CacheEntry> evict(std::uint64_t capacity);
+  void remove(std::string_view key);
+  // Remove every entry and unfinished one
+  void clear();
+};
+
+// Command line of the cache, arguments are a command and the cache folder:
+// `list <folder>`, `info <folder> <key>`, `remove <folder> <key>`,
+// `evict <folder> <MiB>` or `clear <folder>`. Returns the exit code
+int cacheCommand(const std::vector<std::string>& arguments, std::ostream& output);
+
+}  // namespace Computation
@@ -0,0 +1,375 @@
+#include "ResultContainer.h"
+#include <fmt/format.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include "Executor.h"
+
+namespace Computation {
+
+Vec3<std::size_t> chunk_count(const Vec3<std::size_t>& dimension_size,
+                              const Vec3<std::size_t>& chunk_shape) {
+  return Vec3<std::size_t>{(dimension_size.x + chunk_shape.x - 1) / chunk_shape.x,
+                           (dimension_size.y + chunk_shape.y - 1) / chunk_shape.y,
+                           (dimension_size.z + chunk_shape.z - 1) / chunk_shape.z};
+}
+
+ChunkBox chunk_box(const Vec3<std::size_t>& dimension_size,
+                   const Vec3<std::size_t>& chunk_shape,
+                   std::size_t chunk_id) {
+  const auto count = chunk_count(dimension_size, chunk_shape);
+  const auto chunk = Vec3<std::size_t>{chunk_id / count.z / count.y % count.x,
+                                       chunk_id / count.z % count.y,
+                                       chunk_id % count.z};
+  const auto origin = chunk.elem_product(chunk_shape);
+  const auto extent =
+      Vec3<std::size_t>{std::min(chunk_shape.x, dimension_size.x - origin.x),
+                        std::min(chunk_shape.y, dimension_size.y - origin.y),
+                        std::min(chunk_shape.z, dimension_size.z - origin.z)};
+  return ChunkBox{origin, extent};
+}
+
+// Copy a box of `extent` cells between two x-major arrays, row by row along z
+void copy_box(const std::byte* source,
+              const Vec3<std::size_t>& source_size,
+              const Vec3<std::size_t>& source_origin,
+              std::byte* target,
+              const Vec3<std::size_t>& target_size,
+              const Vec3<std::size_t>& target_origin,
+              const Vec3<std::size_t>& extent,
+              std::size_t cell_bytes) {
+  for (std::size_t x = 0; x < extent.x; ++x) {
+    for (std::size_t y = 0; y < extent.y; ++y) {
+      const auto source_row =
+          (source_origin.x + x) * source_size.y + source_origin.y + y;
+      const auto target_row =
+          (target_origin.x + x) * target_size.y + target_origin.y + y;
+      const auto source_id = source_row * source_size.z + source_origin.z;
+      const auto target_id = target_row * target_size.z + target_origin.z;
+      std::memcpy(target + target_id * cell_bytes, source + source_id * cell_bytes,
+                  extent.z * cell_bytes);
+    }
+  }
+}
+
+ContainerSink::ContainerSink(AtomicLogger::AtomicLogger* result_log,
+                             std::filesystem::path path,
+                             std::size_t chunk_edge,
+                             ChunkCodec codec,
+                             ParallelWriter::WriterOptions writer_options)
+    : result_log(result_log),
+      path(path),
+      writer_options(writer_options),
+      file(path, writer_options.direct_io),
+      chunk_edge(chunk_edge),
+      codec(codec),
+      write_slots(std::ptrdiff_t(writer_options.queue_depth)) {}
+
+std::uint64_t ContainerSink::allocate(std::size_t size) {
+  if (not this->writer_options.direct_io) {
+    return this->next_offset.fetch_add(size);
+  }
+  // direct I/O writes whole blocks, the gaps are left as holes
+  const auto alignment = ParallelWriter::direct_io_alignment;
+  return this->next_offset.fetch_add((size + alignment - 1) / alignment * alignment);
+}
+
+void ContainerSink::add_write_time(Field& field, double seconds) {
+  const auto scoped_lock = std::scoped_lock(this->field_lock);
+  field.write_seconds += seconds;
+}
+
+ContainerSink::Field& ContainerSink::get_field(std::size_t field) {
+  const auto scoped_lock = std::scoped_lock(this->field_lock);
+  return *this->fields.at(field);
+}
+
+std::size_t ContainerSink::begin_field(const FieldDescriptor& field) {
+  // streamed fields arrive one x-slab at a time, so their chunks are one slab deep
+  const auto chunk_shape =
+      Vec3<std::size_t>{field.streamed ? 1 : this->chunk_edge, this->chunk_edge,
+                        this->chunk_edge};
+  const auto chunk_cnt = chunk_count(field.dimension_size, chunk_shape).product();
+  auto entry = std::make_unique<Field>(
+      Field{field, chunk_shape, std::vector<std::array<std::uint64_t, 3>>(chunk_cnt)});
+
+  const auto scoped_lock = std::scoped_lock(this->field_lock);
+  this->fields.push_back(std::move(entry));
+  return this->fields.size() - 1;
+}
+
+void ContainerSink::write_chunk(Field& field,
+                                std::size_t chunk_id,
+                                std::size_t first_x,
+                                std::span<const std::byte> cells) {
+  const auto& descriptor = field.descriptor;
+  const auto box = chunk_box(descriptor.dimension_size, field.chunk_shape, chunk_id);
+
+  auto chunk = std::vector<std::byte>(box.extent.product() * descriptor.cell_bytes);
+  auto source_size = descriptor.dimension_size;
+  source_size.x = cells.size() / descriptor.slab_bytes();
+  copy_box(cells.data(), source_size,
+           Vec3<std::size_t>{box.origin.x - first_x, box.origin.y, box.origin.z},
+           chunk.data(), box.extent, Vec3<std::size_t>{0, 0, 0}, box.extent,
+           descriptor.cell_bytes);
+
+  const auto components = descriptor.cell_bytes / sizeof(double);
+  const auto encoded = encode_chunk(std::move(chunk), components, this->codec);
+  const auto offset = this->allocate(encoded.bytes.size());
+  // every chunk is a single write, the queue depth bounds how many run at once
+  auto chunk_options = this->writer_options;
+  chunk_options.queue_depth = 1;
+  this->write_slots.acquire();
+  try {
+    ParallelWriter::write_at(this->file, offset, encoded.bytes, chunk_options);
+  } catch (...) {
+    this->write_slots.release();
+    throw;
+  }
+  this->write_slots.release();
+  field.chunks[chunk_id] = {offset, encoded.bytes.size(),
+                            std::uint64_t(encoded.encoding)};
+}
+
+void ContainerSink::log_field(const Field& field) {
+  auto stored_bytes = std::uint64_t(0);
+  for (const auto& chunk : field.chunks) {
+    stored_bytes += chunk[1];
+  }
+  const auto report = [&]() {
+    const auto scoped_lock = std::scoped_lock(this->field_lock);
+    return ParallelWriter::WriteReport{stored_bytes, field.write_seconds};
+  }();
+  const auto field_bytes = field.descriptor.field_bytes();
+  this->result_log->log(fmt::format(
+      FMT_STRING("Exported {:s} into {:s} ({:d} chunks, {:.1f} MiB, ratio {:.2f}, "
+                 "{:.2f} GB/s)"),
+      field.descriptor.name, this->path.filename().string(), field.chunks.size(),
+      double(stored_bytes) / (1024.0 * 1024.0),
+      stored_bytes > 0 ? double(field_bytes) / double(stored_bytes) : 1.0,
+      report.gigabytes_per_second()));
+}
+
+void ContainerSink::write_field(std::size_t field, std::span<const std::byte> cells) {
+  auto& entry = this->get_field(field);
+
+  // chunks are independent, so they are gathered, compressed and written
+  // concurrently
+  const auto start_time = std::chrono::steady_clock::now();
+  parallel_for_each(entry.chunks.size(), [&](std::size_t chunk_id) {
+    this->write_chunk(entry, chunk_id, 0, cells);
+  });
+  this->add_write_time(
+      entry,
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time)
+          .count());
+
+  this->log_field(entry);
+}
+
+void ContainerSink::write_slab(std::size_t field,
+                               std::size_t x,
+                               std::span<const std::byte> cells) {
+  auto& entry = this->get_field(field);
+  const auto count = chunk_count(entry.descriptor.dimension_size, entry.chunk_shape);
+  const auto tile_cnt = count.y * count.z;
+
+  const auto start_time = std::chrono::steady_clock::now();
+  parallel_for_each(tile_cnt, [&](std::size_t tile) {
+    this->write_chunk(entry, x * tile_cnt + tile, x, cells);
+  });
+  this->add_write_time(
+      entry,
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time)
+          .count());
+
+  if (x + 1 == entry.descriptor.dimension_size.x) {
+    this->log_field(entry);
+  }
+}
+
+void ContainerSink::finish(const nlohmann::json& metadata) {
+  auto index = nlohmann::json();
+  index["format"] = "AcousticSimulator result container";
+  index["version"] = container_version;
+  index["attributes"] = metadata;
+  index["fields"] = nlohmann::json::array();
+
+  {
+    const auto scoped_lock = std::scoped_lock(this->field_lock);
+    for (const auto& field : this->fields) {
+      auto entry = to_json(field->descriptor);
+      entry["chunk_shape"] = field->chunk_shape.to_json();
+      entry["compression"] = chunk_codec_json(this->codec);
+      entry["chunks"] = field->chunks;
+      index["fields"].push_back(entry);
+    }
+  }
+
+  const auto index_text = index.dump();
+  const auto index_offset = this->allocate(index_text.size());
+  ParallelWriter::write_at(this->file, index_offset,
+                           std::as_bytes(std::span(index_text)), this->writer_options);
+
+  const auto header = ContainerHeader{container_magic, container_version, 0,
+                                      index_offset, index_text.size()};
+  ParallelWriter::write_at(this->file, 0, std::as_bytes(std::span(&header, 1)),
+                           this->writer_options);
+  // padding of direct I/O writes past the index is cut off
+  if (this->writer_options.direct_io) {
+    this->file.resize(index_offset + index_text.size());
+  }
+
+  this->result_log->log(fmt::format(
+      FMT_STRING("Exported {:s} ({:.1f} MiB)"), this->path.filename().string(),
+      double(index_offset + index_text.size()) / (1024.0 * 1024.0)));
+}
+
+std::vector<std::filesystem::path> ContainerSink::output_files() {
+  return {this->path};
+}
+
+ContainerReader::ContainerReader(std::filesystem::path path)
+    : path(std::move(path)), file(this->path, std::fstream::in | std::fstream::binary) {
+  auto header = ContainerHeader();
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (not file or header.magic != container_magic) {
+    throw std::runtime_error("Not a result container: " + this->path.string());
+  }
+  if (header.version == 0 or header.version > container_version) {
+    throw std::runtime_error("Unsupported result container version: " +
+                             this->path.string());
+  }
+
+  auto index_text = std::string(header.index_size, '\0');
+  file.seekg(std::streamoff(header.index_offset));
+  file.read(index_text.data(), std::streamsize(index_text.size()));
+  index = nlohmann::json::parse(index_text);
+}
+
+const nlohmann::json& ContainerReader::field_index(std::string_view name) const {
+  for (const auto& field : this->index.at("fields")) {
+    if (field.at("name").get<std::string_view>() == name) {
+      return field;
+    }
+  }
+  throw std::out_of_range("Result container has no field " + std::string(name));
+}
+
+std::vector<std::string> ContainerReader::field_names() const {
+  auto result = std::vector<std::string>();
+  for (const auto& field : this->index.at("fields")) {
+    result.push_back(field.at("name").get<std::string>());
+  }
+  return result;
+}
+
+FieldDescriptor ContainerReader::field(std::string_view name) const {
+  return field_descriptor_from_json(this->field_index(name));
+}
+
+std::optional<std::uint64_t> ContainerReader::contiguous_offset(
+    std::string_view name) const {
+  const auto& field = this->field_index(name);
+  const auto descriptor = field_descriptor_from_json(field);
+  const auto chunk_shape = Vec3<std::size_t>(field.at("chunk_shape"));
+  const auto& chunks = field.at("chunks");
+  if (chunks.empty() or chunk_shape.y < descriptor.dimension_size.y or
+      chunk_shape.z < descriptor.dimension_size.z) {
+    return std::nullopt;
+  }
+
+  // chunks spanning whole yz planes hold consecutive x-slabs, so raw ones stored
+  // back to back are the cells of the field in x-major order
+  const auto first_offset = chunks.front().at(0).get<std::uint64_t>();
+  auto next_offset = first_offset;
+  for (const auto& chunk : chunks) {
+    const auto encoding = chunk.size() > 2
+                              ? ChunkEncoding(chunk.at(2).get<std::uint64_t>())
+                              : ChunkEncoding::Raw;
+    if (encoding != ChunkEncoding::Raw or
+        chunk.at(0).get<std::uint64_t>() != next_offset) {
+      return std::nullopt;
+    }
+    next_offset += chunk.at(1).get<std::uint64_t>();
+  }
+  if (next_offset - first_offset != descriptor.field_bytes() or
+      first_offset % sizeof(double) != 0) {
+    return std::nullopt;
+  }
+  return first_offset;
+}
+
+std::vector<std::byte> ContainerReader::read_chunk(std::string_view name,
+                                                   std::size_t chunk_id) const {
+  const auto& field = this->field_index(name);
+  const auto& chunk = field.at("chunks").at(chunk_id);
+  const auto encoding = chunk.size() > 2
+                            ? ChunkEncoding(chunk.at(2).get<std::uint64_t>())
+                            : ChunkEncoding::Raw;
+  const auto cell_bytes = field.at("cell_size").get<std::size_t>();
+  const auto box = chunk_box(Vec3<std::size_t>(field.at("dimension_size")),
+                             Vec3<std::size_t>(field.at("chunk_shape")), chunk_id);
+
+  auto stored = std::vector<std::byte>(chunk.at(1).get<std::size_t>());
+  {
+    const auto scoped_lock = std::scoped_lock(this->file_lock);
+    this->file.seekg(std::streamoff(chunk.at(0).get<std::uint64_t>()));
+    this->file.read(reinterpret_cast<char*>(stored.data()),
+                    std::streamsize(stored.size()));
+    if (not this->file) {
+      throw std::runtime_error("Unable to read chunk of " + std::string(name));
+    }
+  }
+
+  return decode_chunk(stored, encoding, box.extent.product() * cell_bytes,
+                      cell_bytes / sizeof(double));
+}
+
+std::vector<std::byte> ContainerReader::read_box(std::string_view name,
+                                                 const Vec3<std::size_t>& begin,
+                                                 const Vec3<std::size_t>& count) const {
+  const auto descriptor = this->field(name);
+  const auto chunk_shape = Vec3<std::size_t>(this->field_index(name).at("chunk_shape"));
+  const auto& size = descriptor.dimension_size;
+  const auto end = begin + count;
+  if (end.x > size.x or end.y > size.y or end.z > size.z) {
+    throw std::out_of_range("Box is outside of field " + std::string(name));
+  }
+
+  auto result = std::vector<std::byte>(count.product() * descriptor.cell_bytes);
+  if (result.empty()) {
+    return result;
+  }
+
+  // only chunks overlapping the box are read
+  const auto first = begin.elem_division(chunk_shape);
+  const auto last = (end - 1).elem_division(chunk_shape);
+  const auto chunks = chunk_count(size, chunk_shape);
+  for (auto cx = first.x; cx <= last.x; ++cx) {
+    for (auto cy = first.y; cy <= last.y; ++cy) {
+      for (auto cz = first.z; cz <= last.z; ++cz) {
+        const auto chunk_id = (cx * chunks.y + cy) * chunks.z + cz;
+        const auto box = chunk_box(size, chunk_shape, chunk_id);
+        const auto chunk = this->read_chunk(name, chunk_id);
+
+        const auto overlap_begin = Vec3<std::size_t>{std::max(begin.x, box.origin.x),
+                                                     std::max(begin.y, box.origin.y),
+                                                     std::max(begin.z, box.origin.z)};
+        const auto box_end = box.origin + box.extent;
+        const auto overlap_end = Vec3<std::size_t>{std::min(end.x, box_end.x),
+                                                   std::min(end.y, box_end.y),
+                                                   std::min(end.z, box_end.z)};
+
+        copy_box(chunk.data(), box.extent, overlap_begin - box.origin, result.data(),
+                 count, overlap_begin - begin, overlap_end - overlap_begin,
+                 descriptor.cell_bytes);
+      }
+    }
+  }
+
+  return result;
+}
+
+}  // namespace Computation
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <semaphore>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../Utilities/AtomicLogger.h"
+#include "../Utilities/ParallelWriter.h"
+#include "ChunkCodec.h"
+#include "ResultSink.h"
+#include "Vec3.h"
+
+namespace Computation {
+
+/* Container layout:
+ * - header (first `container_header_size` bytes): magic, u32 version, u32 reserved,
+ *   u64 index offset, u64 index size
+ * - chunks, each one an independent x-major box of cells of one field, stored as
+ *   described by its ChunkEncoding
+ * - index (JSON): field descriptors, chunk shape, compression and (offset, size,
+ *   encoding) of every chunk in x-major chunk order, and run metadata under
+ *   "attributes". Version 1 chunks have no encoding and are raw */
+constexpr auto container_file_name = std::string_view("result.acsr");
+constexpr auto container_magic =
+    std::array<char, 8>{'A', 'C', 'S', 'I', 'M', 'R', 'E', 'S'};
+constexpr auto container_version = std::uint32_t(2);
+constexpr auto container_header_size = std::uint64_t(4096);
+
+struct ContainerHeader {
+  std::array<char, 8> magic;
+  std::uint32_t version;
+  std::uint32_t reserved;
+  std::uint64_t index_offset;
+  std::uint64_t index_size;
+};
+
+// Chunk `chunk_id` of a field split in boxes of `chunk_shape` cells
+struct ChunkBox {
+  Vec3<std::size_t> origin;
+  Vec3<std::size_t> extent;
+};
+[[nodiscard]] ChunkBox chunk_box(const Vec3<std::size_t>& dimension_size,
+                                 const Vec3<std::size_t>& chunk_shape,
+                                 std::size_t chunk_id);
+[[nodiscard]] Vec3<std::size_t> chunk_count(const Vec3<std::size_t>& dimension_size,
+                                            const Vec3<std::size_t>& chunk_shape);
+
+class ContainerSink : public ResultSink {
+  struct Field {
+    FieldDescriptor descriptor;
+    Vec3<std::size_t> chunk_shape;
+    // offset, stored size and encoding of every chunk in the file
+    std::vector<std::array<std::uint64_t, 3>> chunks;
+    // Time spent gathering, encoding and writing chunks
+    double write_seconds = 0.0;
+  };
+
+  AtomicLogger::AtomicLogger* result_log;
+  std::filesystem::path path;
+  ParallelWriter::WriterOptions writer_options;
+  ParallelWriter::OutputFile file;
+  std::size_t chunk_edge;
+  ChunkCodec codec;
+  // Chunks written at once, at most the queue depth of the writer options
+  std::counting_semaphore<> write_slots;
+
+  std::atomic<std::uint64_t> next_offset = container_header_size;
+  std::mutex field_lock;
+  std::vector<std::unique_ptr<Field>> fields;
+
+  [[nodiscard]] Field& get_field(std::size_t field);
+  void log_field(const Field& field);
+  // Reserve `size` bytes of the file, aligned for direct I/O if it is used
+  [[nodiscard]] std::uint64_t allocate(std::size_t size);
+  void add_write_time(Field& field, double seconds);
+  // Copy one chunk out of cells holding the x-slabs starting at `first_x`, then
+  // encode and write it
+  void write_chunk(Field& field,
+                   std::size_t chunk_id,
+                   std::size_t first_x,
+                   std::span<const std::byte> cells);
+
+ public:
+  ContainerSink(AtomicLogger::AtomicLogger* result_log,
+                std::filesystem::path path,
+                std::size_t chunk_edge,
+                ChunkCodec codec,
+                ParallelWriter::WriterOptions writer_options);
+
+  std::size_t begin_field(const FieldDescriptor& field) override;
+  void write_field(std::size_t field, std::span<const std::byte> cells) override;
+  void write_slab(std::size_t field,
+                  std::size_t x,
+                  std::span<const std::byte> cells) override;
+  void finish(const nlohmann::json& metadata) override;
+  std::vector<std::filesystem::path> output_files() override;
+};
+
+class ContainerReader {
+  std::filesystem::path path;
+  nlohmann::json index;
+  mutable std::mutex file_lock;
+  mutable std::ifstream file;
+
+  [[nodiscard]] const nlohmann::json& field_index(std::string_view name) const;
+
+ public:
+  explicit ContainerReader(std::filesystem::path path);
+
+  [[nodiscard]] const nlohmann::json& metadata() const {
+    return index.at("attributes");
+  }
+  [[nodiscard]] std::vector<std::string> field_names() const;
+  [[nodiscard]] FieldDescriptor field(std::string_view name) const;
+  // Offset in file of the cells of a field stored uncompressed in x-major order,
+  // so they can be mapped as they are
+  [[nodiscard]] std::optional<std::uint64_t> contiguous_offset(
+      std::string_view name) const;
+
+  // Read and decode cells of one chunk
+  [[nodiscard]] std::vector<std::byte> read_chunk(std::string_view name,
+                                                  std::size_t chunk_id) const;
+  // Read cells of the box [begin, begin + count) of a field in x-major order, with
+  // one read per chunk the box touches
+  [[nodiscard]] std::vector<std::byte> read_box(std::string_view name,
+                                                const Vec3<std::size_t>& begin,
+                                                const Vec3<std::size_t>& count) const;
+};
+
+}  // namespace Computation
@@ -0,0 +1,25 @@
+#include "ResultExport.h"
+#include <fmt/format.h>
+
+namespace Computation {
+
+ParallelWriter::WriterOptions make_writer_options(
+    const Config::ExecutionParameter& execution_parameter) {
+  auto result = ParallelWriter::WriterOptions();
+  result.queue_depth = execution_parameter.write_queue_depth;
+  result.direct_io = execution_parameter.direct_io;
+  return result;
+}
+
+void export_bytes(AtomicLogger::AtomicLogger* result_log,
+                  const std::filesystem::path& path,
+                  std::span<const std::byte> bytes,
+                  const ParallelWriter::WriterOptions& writer_options) {
+  const auto report = ParallelWriter::write_file(path, bytes, writer_options);
+  result_log->log(fmt::format(FMT_STRING("Exported {:s} ({:.1f} MiB, {:.2f} GB/s)"),
+                              path.filename().string(),
+                              double(report.bytes) / (1024.0 * 1024.0),
+                              report.gigabytes_per_second()));
+}
+
+}  // namespace Computation
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include "../Utilities/AtomicLogger.h"
+#include "../Utilities/ParallelWriter.h"
+#include "Config.h"
+
+namespace Computation {
+
+[[nodiscard]] ParallelWriter::WriterOptions make_writer_options(
+    const Config::ExecutionParameter& execution_parameter);
+
+// Write a whole result file and log the achieved throughput
+void export_bytes(AtomicLogger::AtomicLogger* result_log,
+                  const std::filesystem::path& path,
+                  std::span<const std::byte> bytes,
+                  const ParallelWriter::WriterOptions& writer_options);
+
+}  // namespace Computation
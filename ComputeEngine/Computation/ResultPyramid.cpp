@@ -0,0 +1,265 @@
+#include "ResultPyramid.h"
+#include <fmt/format.h>
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include "Executor.h"
+
+namespace Computation {
+
+namespace {
+
+double read_component(std::span<const std::byte> cells, std::size_t id) {
+  auto result = 0.0;
+  std::memcpy(&result, cells.data() + id * sizeof(double), sizeof(double));
+  return result;
+}
+
+// Range of fine cells [begin, end) covered by coarse cell `coarse` along one axis
+std::pair<std::size_t, std::size_t> fine_range(std::size_t coarse,
+                                               std::size_t factor,
+                                               std::size_t fine_cnt) {
+  return {coarse * factor, std::min(coarse * factor + factor, fine_cnt)};
+}
+
+// Add the cells of a grid of source_cnt cells to the grid halved along each axis,
+// whose cells are sums of `weights` fine cells. Source cells are `cells` if
+// source_sum is empty, otherwise sums of source_weight fine cells. Decimation adds
+// the first source cell of each coarse cell only
+void accumulate_halved(const Vec3<std::size_t>& source_cnt,
+                       std::size_t components,
+                       bool decimate,
+                       std::span<const std::byte> cells,
+                       std::span<const double> source_sum,
+                       std::span<const double> source_weight,
+                       std::span<double> sums,
+                       std::span<double> weights) {
+  const auto coarse_cnt = (source_cnt + std::size_t(1)) / std::size_t(2);
+
+  parallel_for(nullptr, coarse_cnt.product(), 0, [&](std::size_t id) {
+    const auto cx = id / coarse_cnt.z / coarse_cnt.y;
+    const auto cy = id / coarse_cnt.z % coarse_cnt.y;
+    const auto cz = id % coarse_cnt.z;
+    auto [x_begin, x_end] = fine_range(cx, 2, source_cnt.x);
+    auto [y_begin, y_end] = fine_range(cy, 2, source_cnt.y);
+    auto [z_begin, z_end] = fine_range(cz, 2, source_cnt.z);
+    if (decimate) {
+      x_end = x_begin + 1;
+      y_end = y_begin + 1;
+      z_end = z_begin + 1;
+    }
+
+    auto* sum = &sums[id * components];
+    for (auto x = x_begin; x < x_end; ++x) {
+      for (auto y = y_begin; y < y_end; ++y) {
+        for (auto z = z_begin; z < z_end; ++z) {
+          const auto source_id = (x * source_cnt.y + y) * source_cnt.z + z;
+          for (std::size_t c = 0; c < components; ++c) {
+            sum[c] += source_sum.empty()
+                          ? read_component(cells, source_id * components + c)
+                          : source_sum[source_id * components + c];
+          }
+          weights[id] += source_sum.empty() ? 1.0 : source_weight[source_id];
+        }
+      }
+    }
+  });
+}
+
+// Cells of a level from the sums accumulated for it
+std::vector<double> level_cells(const std::vector<double>& sums,
+                                const std::vector<double>& weights,
+                                std::size_t components) {
+  auto result = std::vector<double>(sums.size());
+  parallel_for(nullptr, weights.size(), 0, [&](std::size_t id) {
+    for (std::size_t c = 0; c < components; ++c) {
+      result[id * components + c] = sums[id * components + c] / weights[id];
+    }
+  });
+  return result;
+}
+
+}  // namespace
+
+std::string to_string(Config::PyramidReduction reduction) {
+  switch (reduction) {
+    case Config::PyramidReduction::Average:
+      return "average";
+    case Config::PyramidReduction::Decimate:
+      return "decimate";
+  }
+  return "unknown";
+}
+
+FieldDescriptor make_level_descriptor(const FieldDescriptor& field,
+                                      std::size_t level,
+                                      Config::PyramidReduction reduction) {
+  const auto factor = std::size_t(1) << level;
+  auto result = field;
+  result.name = fmt::format(FMT_STRING("{:s}_level{:d}"), field.name, level);
+  result.dimension_size = (field.dimension_size + (factor - 1)) / factor;
+  result.spacing = field.spacing * double(factor);
+  // an averaged cell sits at the center of the fine cells it covers
+  if (reduction == Config::PyramidReduction::Average) {
+    result.origin = field.origin + field.spacing * (double(factor - 1) / 2.0);
+  }
+  result.attributes["pyramid_base"] = field.name;
+  result.attributes["pyramid_level"] = level;
+  result.attributes["pyramid_factor"] = factor;
+  result.attributes["pyramid_reduction"] = to_string(reduction);
+  return result;
+}
+
+PyramidSink::PyramidSink(std::unique_ptr<ResultSink> sink,
+                         std::size_t level_cnt,
+                         Config::PyramidReduction reduction)
+    : sink(std::move(sink)), level_cnt(level_cnt), reduction(reduction) {}
+
+PyramidSink::Pyramid* PyramidSink::get_pyramid(std::size_t field) {
+  const auto scoped_lock = std::scoped_lock(this->pyramid_lock);
+  const auto pyramid = this->pyramids.find(field);
+  return pyramid != this->pyramids.end() ? pyramid->second.get() : nullptr;
+}
+
+std::size_t PyramidSink::begin_field(const FieldDescriptor& field) {
+  const auto id = this->sink->begin_field(field);
+  if (not field.gridded) {
+    return id;
+  }
+
+  auto pyramid = std::make_unique<Pyramid>();
+  pyramid->descriptor = field;
+  for (std::size_t level = 1; level <= this->level_cnt; ++level) {
+    const auto descriptor = make_level_descriptor(field, level, this->reduction);
+    auto slab_sum = std::vector<double>();
+    auto slab_weight = std::vector<double>();
+    if (field.streamed) {
+      slab_sum.resize(descriptor.slab_bytes() / sizeof(double));
+      slab_weight.resize(descriptor.dimension_size.y * descriptor.dimension_size.z);
+    }
+    pyramid->levels.push_back(Level{this->sink->begin_field(descriptor), descriptor,
+                                    std::size_t(1) << level, std::move(slab_sum),
+                                    std::move(slab_weight)});
+  }
+
+  const auto scoped_lock = std::scoped_lock(this->pyramid_lock);
+  this->pyramids[id] = std::move(pyramid);
+  return id;
+}
+
+void PyramidSink::write_field(std::size_t field, std::span<const std::byte> cells) {
+  this->sink->write_field(field, cells);
+
+  auto* pyramid = this->get_pyramid(field);
+  if (pyramid == nullptr) {
+    return;
+  }
+
+  const auto components = pyramid->descriptor.cell_bytes / sizeof(double);
+  const auto decimate = this->reduction == Config::PyramidReduction::Decimate;
+
+  // Each level is reduced from the one before, which carries the count of fine
+  // cells behind every sum so averages are exact even for partial edge cells
+  auto source_cnt = pyramid->descriptor.dimension_size;
+  auto source_sum = std::vector<double>();
+  auto source_weight = std::vector<double>();
+  for (const auto& level : pyramid->levels) {
+    const auto coarse_cnt = level.descriptor.dimension_size.product();
+    auto sums = std::vector<double>(coarse_cnt * components);
+    auto weights = std::vector<double>(coarse_cnt);
+    accumulate_halved(source_cnt, components, decimate, cells, source_sum,
+                      source_weight, sums, weights);
+
+    const auto level_val = level_cells(sums, weights, components);
+    this->sink->write_field(level.id, std::as_bytes(std::span(level_val)));
+
+    source_cnt = level.descriptor.dimension_size;
+    source_sum = std::move(sums);
+    source_weight = std::move(weights);
+  }
+}
+
+void PyramidSink::write_slab(std::size_t field,
+                             std::size_t x,
+                             std::span<const std::byte> cells) {
+  this->sink->write_slab(field, x, cells);
+
+  auto* pyramid = this->get_pyramid(field);
+  if (pyramid == nullptr) {
+    return;
+  }
+
+  const auto components = pyramid->descriptor.cell_bytes / sizeof(double);
+  const auto decimate = this->reduction == Config::PyramidReduction::Decimate;
+
+  // Each level sums the slabs emitted by the level before (the field itself for
+  // the first level), and emits a coarse slab with the second of them or the last
+  auto source_cnt = pyramid->descriptor.dimension_size;
+  auto source_x = x;
+  Level* source = nullptr;
+  for (auto& level : pyramid->levels) {
+    // decimation keeps the first source slab of every coarse slab only
+    if (not decimate or source_x % 2 == 0) {
+      accumulate_halved(
+          Vec3<std::size_t>{1, source_cnt.y, source_cnt.z}, components, decimate,
+          cells,
+          source != nullptr ? std::span<const double>(source->slab_sum)
+                            : std::span<const double>(),
+          source != nullptr ? std::span<const double>(source->slab_weight)
+                            : std::span<const double>(),
+          level.slab_sum, level.slab_weight);
+    }
+    if (source != nullptr) {
+      std::fill(source->slab_sum.begin(), source->slab_sum.end(), 0.0);
+      std::fill(source->slab_weight.begin(), source->slab_weight.end(), 0.0);
+      source = nullptr;
+    }
+    if (source_x % 2 == 0 and source_x + 1 < source_cnt.x) {
+      return;
+    }
+
+    const auto level_val = level_cells(level.slab_sum, level.slab_weight, components);
+    this->sink->write_slab(level.id, source_x / 2, std::as_bytes(std::span(level_val)));
+
+    source = &level;
+    source_cnt = level.descriptor.dimension_size;
+    source_x /= 2;
+  }
+  if (source != nullptr) {
+    std::fill(source->slab_sum.begin(), source->slab_sum.end(), 0.0);
+    std::fill(source->slab_weight.begin(), source->slab_weight.end(), 0.0);
+  }
+}
+
+void PyramidSink::finish(const nlohmann::json& metadata) {
+  auto result = metadata;
+  auto& description = result["pyramid"];
+  description["levels"] = this->level_cnt;
+  description["reduction"] = to_string(this->reduction);
+  description["fields"] = nlohmann::json::object();
+
+  {
+    const auto scoped_lock = std::scoped_lock(this->pyramid_lock);
+    for (const auto& [id, pyramid] : this->pyramids) {
+      auto& levels = description["fields"][pyramid->descriptor.name];
+      levels = nlohmann::json::array();
+      for (const auto& level : pyramid->levels) {
+        auto entry = nlohmann::json();
+        entry["field"] = level.descriptor.name;
+        entry["factor"] = level.factor;
+        entry["dimension_size"] = level.descriptor.dimension_size.to_json();
+        entry["origin"] = level.descriptor.origin.to_json();
+        entry["spacing"] = level.descriptor.spacing.to_json();
+        levels.push_back(entry);
+      }
+    }
+  }
+
+  this->sink->finish(result);
+}
+
+std::vector<std::filesystem::path> PyramidSink::output_files() {
+  return this->sink->output_files();
+}
+
+}  // namespace Computation
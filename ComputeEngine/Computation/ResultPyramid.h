@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Config.h"
+#include "ResultSink.h"
+
+namespace Computation {
+
+[[nodiscard]] std::string to_string(Config::PyramidReduction reduction);
+
+// Descriptor of level `level` of a field, downsampled by 2^level along each axis
+[[nodiscard]] FieldDescriptor make_level_descriptor(const FieldDescriptor& field,
+                                                    std::size_t level,
+                                                    Config::PyramidReduction reduction);
+
+class PyramidSink : public ResultSink {
+  // Writes every field to the wrapped sink along with its downsampled levels, each
+  // level reduced from the one before as cells arrive
+  struct Level {
+    std::size_t id;
+    FieldDescriptor descriptor;
+    std::size_t factor;
+    // Sums of the coarse slab being accumulated from streamed slabs, and the
+    // number of fine cells summed into each of its cells
+    std::vector<double> slab_sum;
+    std::vector<double> slab_weight;
+  };
+  struct Pyramid {
+    FieldDescriptor descriptor;
+    std::vector<Level> levels;
+  };
+
+  std::unique_ptr<ResultSink> sink;
+  std::size_t level_cnt;
+  Config::PyramidReduction reduction;
+
+  std::mutex pyramid_lock;
+  std::map<std::size_t, std::unique_ptr<Pyramid>> pyramids;
+
+  [[nodiscard]] Pyramid* get_pyramid(std::size_t field);
+
+ public:
+  PyramidSink(std::unique_ptr<ResultSink> sink,
+              std::size_t level_cnt,
+              Config::PyramidReduction reduction);
+
+  std::size_t begin_field(const FieldDescriptor& field) override;
+  void write_field(std::size_t field, std::span<const std::byte> cells) override;
+  void write_slab(std::size_t field,
+                  std::size_t x,
+                  std::span<const std::byte> cells) override;
+  // Describe levels of every field under "pyramid" in metadata
+  void finish(const nlohmann::json& metadata) override;
+  std::vector<std::filesystem::path> output_files() override;
+};
+
+}  // namespace Computation
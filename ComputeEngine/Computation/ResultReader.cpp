@@ -0,0 +1,179 @@
+#include "ResultReader.h"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+
+namespace Computation {
+
+namespace {
+
+// Fields of metadata written before descriptors were listed under "fields"
+std::vector<FieldDescriptor> legacy_fields(const nlohmann::json& metadata) {
+  const auto grids = std::array<std::tuple<std::string, std::string, std::size_t>, 3>{
+      std::tuple("pressure", "complex128", sizeof(double) * 2),
+      std::tuple("potential", "float64", sizeof(double)),
+      std::tuple("force", "float64", sizeof(double))};
+
+  auto result = std::vector<FieldDescriptor>();
+  for (const auto& [grid, dtype, cell_bytes] : grids) {
+    if (not metadata.contains(grid + "_cnt")) {
+      continue;
+    }
+    const auto blk =
+        CellBlockInterpolation(Vec3<std::size_t>(metadata.at(grid + "_cnt")),
+                               Vec3<double>(metadata.at(grid + "_beg")),
+                               Vec3<double>(metadata.at(grid + "_end")));
+    if (grid == "force") {
+      for (const auto* axis : {"_x", "_y", "_z"}) {
+        result.push_back(make_field_descriptor(grid + axis, dtype, cell_bytes, blk));
+      }
+    } else {
+      result.push_back(make_field_descriptor(grid, dtype, cell_bytes, blk));
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+ResultReader::ResultReader(std::filesystem::path path) : path(std::move(path)) {
+  if (not std::filesystem::is_directory(this->path)) {
+    this->open_container(this->path);
+  } else if (std::filesystem::exists(this->path / container_file_name)) {
+    this->open_container(this->path / container_file_name);
+  } else if (std::filesystem::exists(this->path / "metadata.json")) {
+    this->open_legacy(this->path);
+  } else {
+    throw std::runtime_error("No results found in " + this->path.string());
+  }
+}
+
+void ResultReader::open_legacy(const std::filesystem::path& directory) {
+  auto metadata_file = std::ifstream(directory / "metadata.json");
+  this->run_metadata = nlohmann::json::parse(metadata_file);
+
+  auto descriptors = std::vector<std::pair<FieldDescriptor, std::string>>();
+  if (this->run_metadata.contains("fields")) {
+    for (const auto& entry : this->run_metadata.at("fields")) {
+      descriptors.emplace_back(field_descriptor_from_json(entry),
+                               entry.at("file").get<std::string>());
+    }
+  } else {
+    for (auto& descriptor : legacy_fields(this->run_metadata)) {
+      auto file = descriptor.name + "_result.bin";
+      descriptors.emplace_back(std::move(descriptor), std::move(file));
+    }
+  }
+
+  for (auto& [descriptor, file_name] : descriptors) {
+    const auto file = directory / file_name;
+    if (not std::filesystem::exists(file)) {
+      continue;
+    }
+    // files of an interrupted run may be shorter than the field, which is reported
+    // once its cells are mapped
+    this->fields.push_back(Field{std::move(descriptor), file, 0});
+  }
+}
+
+void ResultReader::open_container(const std::filesystem::path& file) {
+  this->container = std::make_unique<ContainerReader>(file);
+  this->run_metadata = this->container->metadata();
+  for (const auto& name : this->container->field_names()) {
+    this->fields.push_back(Field{this->container->field(name), file,
+                                 this->container->contiguous_offset(name)});
+  }
+}
+
+const ResultReader::Field& ResultReader::get_field(std::string_view name) const {
+  const auto field =
+      std::find_if(this->fields.begin(), this->fields.end(),
+                   [&](const auto& f) { return f.descriptor.name == name; });
+  if (field == this->fields.end()) {
+    throw std::out_of_range("Results have no field " + std::string(name));
+  }
+  return *field;
+}
+
+std::vector<std::string> ResultReader::field_names() const {
+  auto result = std::vector<std::string>();
+  for (const auto& field : this->fields) {
+    result.push_back(field.descriptor.name);
+  }
+  return result;
+}
+
+FieldDescriptor ResultReader::field(std::string_view name) const {
+  return this->get_field(name).descriptor;
+}
+
+bool ResultReader::is_mappable(std::string_view name) const {
+  return this->get_field(name).offset.has_value();
+}
+
+void ResultReader::check_cell_bytes(const Field& field, std::size_t cell_bytes) const {
+  if (field.descriptor.cell_bytes != cell_bytes) {
+    throw std::invalid_argument("Cells of " + field.descriptor.name + " are " +
+                                std::to_string(field.descriptor.cell_bytes) +
+                                " bytes, not " + std::to_string(cell_bytes));
+  }
+}
+
+std::shared_ptr<const MappedFile::MappedFile> ResultReader::map_file(
+    const std::filesystem::path& file) const {
+  const auto scoped_lock = std::scoped_lock(this->mapping_lock);
+  auto& mapping = this->mappings[file];
+  auto result = mapping.lock();
+  if (not result) {
+    result = std::make_shared<const MappedFile::MappedFile>(file);
+    mapping = result;
+  }
+  return result;
+}
+
+std::pair<std::shared_ptr<const void>, const std::byte*> ResultReader::map_field(
+    const Field& field) const {
+  if (not field.offset) {
+    throw std::runtime_error("Field " + field.descriptor.name +
+                             " is chunked or compressed, load it instead");
+  }
+  auto mapping = this->map_file(field.file);
+  if (mapping->size() < *field.offset + field.descriptor.field_bytes()) {
+    throw std::runtime_error("File of " + field.descriptor.name + " is truncated");
+  }
+  const auto* data = mapping->data() + *field.offset;
+  return {std::move(mapping), data};
+}
+
+std::vector<std::byte> ResultReader::read_box(std::string_view name,
+                                              const Vec3<std::size_t>& begin,
+                                              const Vec3<std::size_t>& count) const {
+  const auto& field = this->get_field(name);
+  if (not field.offset) {
+    return this->container->read_box(name, begin, count);
+  }
+
+  const auto& size = field.descriptor.dimension_size;
+  const auto end = begin + count;
+  if (end.x > size.x or end.y > size.y or end.z > size.z) {
+    throw std::out_of_range("Box is outside of field " + std::string(name));
+  }
+
+  // raw fields are copied out of the mapping one z-run at a time
+  const auto [owner, data] = this->map_field(field);
+  const auto cell_bytes = field.descriptor.cell_bytes;
+  auto result = std::vector<std::byte>(count.product() * cell_bytes);
+  auto* out = result.data();
+  for (auto x = begin.x; x < end.x; ++x) {
+    for (auto y = begin.y; y < end.y; ++y) {
+      const auto first_id = (x * size.y + y) * size.z + begin.z;
+      std::memcpy(out, data + first_id * cell_bytes, count.z * cell_bytes);
+      out += count.z * cell_bytes;
+    }
+  }
+  return result;
+}
+
+}  // namespace Computation
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "../Utilities/MappedFile.h"
+#include "BlockStorage.h"
+#include "ResultContainer.h"
+#include "ResultSink.h"
+#include "Vec3.h"
+
+namespace Computation {
+
+/* Read access to the results of a run, given its export directory (legacy files or
+ * a container) or a container file. Nothing is read before a field is requested:
+ * - view() maps the file holding the field and returns cells in place, which needs
+ *   the cells stored raw and contiguous (legacy files, or uncompressed containers
+ *   whose chunks span whole yz planes and were stored in order)
+ * - load() copies cells of a field or a box of it, decoding chunks as needed
+ * Mapped files are shared by every view of them and stay mapped while a view
+ * exists, even after the reader is gone. */
+class ResultReader {
+  struct Field {
+    FieldDescriptor descriptor;
+    std::filesystem::path file;
+    // Offset of the first cell in file if cells are stored raw in x-major order
+    std::optional<std::uint64_t> offset;
+  };
+
+  std::filesystem::path path;
+  nlohmann::json run_metadata;
+  std::unique_ptr<ContainerReader> container;
+  std::vector<Field> fields;
+
+  mutable std::mutex mapping_lock;
+  mutable std::map<std::filesystem::path, std::weak_ptr<const MappedFile::MappedFile>>
+      mappings;
+
+  void open_legacy(const std::filesystem::path& directory);
+  void open_container(const std::filesystem::path& file);
+  [[nodiscard]] const Field& get_field(std::string_view name) const;
+  [[nodiscard]] std::shared_ptr<const MappedFile::MappedFile> map_file(
+      const std::filesystem::path& file) const;
+  // Throw unless cells of the field are `cell_bytes` bytes each
+  void check_cell_bytes(const Field& field, std::size_t cell_bytes) const;
+  // Cells of a field mapped in place, with the mapping owning them
+  [[nodiscard]] std::pair<std::shared_ptr<const void>, const std::byte*> map_field(
+      const Field& field) const;
+
+ public:
+  explicit ResultReader(std::filesystem::path path);
+
+  [[nodiscard]] const nlohmann::json& metadata() const { return run_metadata; }
+  [[nodiscard]] bool is_container() const { return container != nullptr; }
+  [[nodiscard]] std::vector<std::string> field_names() const;
+  [[nodiscard]] FieldDescriptor field(std::string_view name) const;
+  // Field can be viewed without copying its cells
+  [[nodiscard]] bool is_mappable(std::string_view name) const;
+
+  // Copy cells of the box [begin, begin + count) of a field in x-major order
+  [[nodiscard]] std::vector<std::byte> read_box(std::string_view name,
+                                                const Vec3<std::size_t>& begin,
+                                                const Vec3<std::size_t>& count) const;
+
+  // View cells of a field in place, throws if the field is not mappable
+  template <typename T>
+  [[nodiscard]] CellBlockView<T> view(std::string_view name) const {
+    const auto& field = this->get_field(name);
+    this->check_cell_bytes(field, sizeof(T));
+    auto [owner, data] = this->map_field(field);
+    return CellBlockView<T>(std::move(owner), reinterpret_cast<const T*>(data),
+                            field.descriptor.dimension_size, field.descriptor.origin,
+                            field.descriptor.spacing);
+  }
+
+  // Copy cells of the box [begin, begin + count) of a field, the view owns them
+  template <typename T>
+  [[nodiscard]] CellBlockView<T> load(std::string_view name,
+                                      const Vec3<std::size_t>& begin,
+                                      const Vec3<std::size_t>& count) const {
+    const auto& field = this->get_field(name);
+    this->check_cell_bytes(field, sizeof(T));
+    const auto bytes = this->read_box(name, begin, count);
+    auto cells = std::make_shared<std::vector<T>>(count.product());
+    std::memcpy(cells->data(), bytes.data(), bytes.size());
+    const auto* data = cells->data();
+    const auto& descriptor = field.descriptor;
+    return CellBlockView<T>(std::move(cells), data, count,
+                            descriptor.origin + descriptor.spacing.elem_product(
+                                                    begin.template cast<double>()),
+                            descriptor.spacing);
+  }
+  // Copy every cell of a field, the view owns them
+  template <typename T>
+  [[nodiscard]] CellBlockView<T> load(std::string_view name) const {
+    return this->load<T>(name, Vec3<std::size_t>{0, 0, 0},
+                         this->get_field(name).descriptor.dimension_size);
+  }
+};
+
+}  // namespace Computation
@@ -0,0 +1,203 @@
+#include "ResultSink.h"
+#include <fmt/format.h>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "../Utilities/ParallelWriter.h"
+#include "ChunkCodec.h"
+#include "ResultContainer.h"
+#include "ResultExport.h"
+#include "ResultPyramid.h"
+#include "ResultStream.h"
+#include "VtkExport.h"
+
+namespace Computation {
+
+FieldDescriptor make_field_descriptor(std::string name,
+                                      std::string dtype,
+                                      std::size_t cell_bytes,
+                                      const CellBlockInterpolation& blk) {
+  auto result = FieldDescriptor();
+  result.name = std::move(name);
+  result.dtype = std::move(dtype);
+  result.cell_bytes = cell_bytes;
+  result.dimension_size = blk.get_dimension_size();
+  result.origin = blk.get_begin();
+  result.spacing = blk.get_spacing();
+  return result;
+}
+
+nlohmann::json to_json(const FieldDescriptor& field) {
+  auto result = nlohmann::json();
+  result["name"] = field.name;
+  result["dtype"] = field.dtype;
+  result["cell_size"] = field.cell_bytes;
+  result["dimension_size"] = field.dimension_size.to_json();
+  result["origin"] = field.origin.to_json();
+  result["spacing"] = field.spacing.to_json();
+  result["layout"] = "x-major";
+  result["gridded"] = field.gridded;
+  result["attributes"] = field.attributes;
+  return result;
+}
+
+FieldDescriptor field_descriptor_from_json(const nlohmann::json& json) {
+  auto result = FieldDescriptor();
+  result.name = json.at("name").get<std::string>();
+  result.dtype = json.at("dtype").get<std::string>();
+  result.cell_bytes = json.at("cell_size").get<std::size_t>();
+  result.dimension_size = Vec3<std::size_t>(json.at("dimension_size"));
+  result.origin = Vec3<double>(json.at("origin"));
+  result.spacing = Vec3<double>(json.at("spacing"));
+  result.gridded = json.value("gridded", true);
+  result.attributes = json.value("attributes", nlohmann::json::object());
+  return result;
+}
+
+class LegacyFileSink : public ResultSink {
+  // One raw `<field>_result.bin` file per field next to `metadata.json`
+  AtomicLogger::AtomicLogger* result_log;
+  std::filesystem::path export_directory;
+  ParallelWriter::WriterOptions writer_options;
+
+  // File of a streamed field, written one slab at a time
+  struct SlabFile {
+    std::unique_ptr<ParallelWriter::OutputFile> file;
+    double write_seconds = 0.0;
+  };
+
+  std::mutex field_lock;
+  std::vector<std::unique_ptr<FieldDescriptor>> fields;
+  std::map<std::size_t, SlabFile> slab_files;
+
+  [[nodiscard]] std::filesystem::path field_path(const FieldDescriptor& field) const {
+    return export_directory / (field.name + "_result.bin");
+  }
+
+ public:
+  LegacyFileSink(AtomicLogger::AtomicLogger* result_log,
+                 std::filesystem::path export_directory,
+                 ParallelWriter::WriterOptions writer_options)
+      : result_log(result_log),
+        export_directory(std::move(export_directory)),
+        writer_options(writer_options) {}
+
+  std::size_t begin_field(const FieldDescriptor& field) override {
+    const auto scoped_lock = std::scoped_lock(this->field_lock);
+    const auto id = this->fields.size();
+    this->fields.push_back(std::make_unique<FieldDescriptor>(field));
+    if (field.streamed) {
+      this->slab_files[id].file =
+          std::make_unique<ParallelWriter::OutputFile>(this->field_path(field));
+    }
+    return id;
+  }
+
+  void write_field(std::size_t field, std::span<const std::byte> cells) override {
+    const auto path = [&]() {
+      const auto scoped_lock = std::scoped_lock(this->field_lock);
+      return this->field_path(*this->fields[field]);
+    }();
+    export_bytes(this->result_log, path, cells, this->writer_options);
+  }
+
+  void write_slab(std::size_t field,
+                  std::size_t x,
+                  std::span<const std::byte> cells) override {
+    const auto [file, descriptor] = [&]() {
+      const auto scoped_lock = std::scoped_lock(this->field_lock);
+      return std::pair(&this->slab_files.at(field), this->fields[field].get());
+    }();
+    const auto report = ParallelWriter::write_at(*file->file, x * cells.size(), cells,
+                                                 this->writer_options);
+
+    const auto scoped_lock = std::scoped_lock(this->field_lock);
+    file->write_seconds += report.seconds;
+    if (x + 1 == descriptor->dimension_size.x) {
+      const auto total =
+          ParallelWriter::WriteReport{descriptor->field_bytes(), file->write_seconds};
+      this->result_log->log(fmt::format(
+          FMT_STRING("Exported {:s} ({:.1f} MiB, {:.2f} GB/s)"),
+          this->field_path(*descriptor).filename().string(),
+          double(total.bytes) / (1024.0 * 1024.0), total.gigabytes_per_second()));
+    }
+  }
+
+  // Write metadata with every field descriptor and its file under "fields"
+  void finish(const nlohmann::json& metadata) override {
+    auto result = metadata;
+    result["fields"] = nlohmann::json::array();
+    {
+      const auto scoped_lock = std::scoped_lock(this->field_lock);
+      for (const auto& field : this->fields) {
+        auto entry = to_json(*field);
+        entry["file"] = this->field_path(*field).filename().string();
+        result["fields"].push_back(entry);
+      }
+    }
+
+    // replaced rather than truncated, like the field files
+    const auto metadata_path = this->export_directory / "metadata.json";
+    std::filesystem::remove(metadata_path);
+    auto metadata_export = std::ofstream(
+        metadata_path, std::fstream::out | std::fstream::trunc | std::fstream::binary);
+    metadata_export << result.dump();
+    metadata_export.close();
+  }
+
+  std::vector<std::filesystem::path> output_files() override {
+    const auto scoped_lock = std::scoped_lock(this->field_lock);
+    auto result = std::vector<std::filesystem::path>();
+    for (const auto& field : this->fields) {
+      result.push_back(this->field_path(*field));
+    }
+    result.push_back(this->export_directory / "metadata.json");
+    return result;
+  }
+};
+
+std::unique_ptr<ResultSink> make_result_sink(
+    AtomicLogger::AtomicLogger* result_log,
+    const std::filesystem::path& export_directory,
+    const Config::ExecutionParameter& execution_parameter) {
+  const auto writer_options = make_writer_options(execution_parameter);
+
+  auto result = std::unique_ptr<ResultSink>();
+  switch (execution_parameter.output_format) {
+    case Config::OutputFormat::Container:
+      result = std::make_unique<ContainerSink>(
+          result_log, export_directory / container_file_name,
+          execution_parameter.container_chunk_edge,
+          make_chunk_codec(execution_parameter), writer_options);
+      break;
+    case Config::OutputFormat::Legacy:
+      result = std::make_unique<LegacyFileSink>(result_log, export_directory,
+                                                writer_options);
+      break;
+    case Config::OutputFormat::Stream:
+      result =
+          std::make_unique<StreamSink>(result_log, execution_parameter.output_stream);
+      break;
+    case Config::OutputFormat::SharedMemory:
+      result = std::make_unique<SharedMemorySink>(
+          result_log, execution_parameter.shared_memory_name,
+          execution_parameter.shared_memory_size * 1024 * 1024);
+      break;
+  }
+
+  // levels are passed through the VTK export, so they get images of their own
+  if (execution_parameter.vtk_export) {
+    result = std::make_unique<VtkSink>(std::move(result), result_log, export_directory,
+                                       execution_parameter.vtk_pressure);
+  }
+  if (execution_parameter.pyramid_levels > 0) {
+    result = std::make_unique<PyramidSink>(std::move(result),
+                                           execution_parameter.pyramid_levels,
+                                           execution_parameter.pyramid_reduction);
+  }
+  return result;
+}
+
+}  // namespace Computation
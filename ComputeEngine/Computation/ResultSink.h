@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <span>
+#include <string>
+#include <vector>
+#include "../Utilities/AtomicLogger.h"
+#include "BlockStorage.h"
+#include "Config.h"
+#include "Vec3.h"
+
+namespace Computation {
+
+struct FieldDescriptor {
+  std::string name;
+  // Element type of each component ("complex128" or "float64")
+  std::string dtype;
+  // Bytes of one cell, cells may hold several components (e.g. target records)
+  std::size_t cell_bytes;
+  // Cells are x-major: z is the fastest changing index
+  Vec3<std::size_t> dimension_size;
+  Vec3<double> origin;
+  Vec3<double> spacing;
+  // Field is written one x-slab at a time instead of all at once
+  bool streamed = false;
+  // Field is a regular grid rather than a list of records, so it can be
+  // downsampled and exported as an image
+  bool gridded = true;
+  nlohmann::json attributes = nlohmann::json::object();
+
+  [[nodiscard]] std::size_t slab_bytes() const {
+    return dimension_size.y * dimension_size.z * cell_bytes;
+  }
+  [[nodiscard]] std::size_t field_bytes() const {
+    return dimension_size.product() * cell_bytes;
+  }
+};
+
+[[nodiscard]] FieldDescriptor make_field_descriptor(std::string name,
+                                                    std::string dtype,
+                                                    std::size_t cell_bytes,
+                                                    const CellBlockInterpolation& blk);
+
+// Descriptor as stored in result metadata and container indices
+[[nodiscard]] nlohmann::json to_json(const FieldDescriptor& field);
+[[nodiscard]] FieldDescriptor field_descriptor_from_json(const nlohmann::json& json);
+
+class ResultSink {
+  // Destination of every result field and of the run metadata
+ public:
+  ResultSink() = default;
+  ResultSink(const ResultSink&) = delete;
+  ResultSink& operator=(const ResultSink&) = delete;
+  virtual ~ResultSink() = default;
+
+  // Declare a field and return its id, safe to call from any thread
+  virtual std::size_t begin_field(const FieldDescriptor& field) = 0;
+  // Write every cell of a field at once
+  virtual void write_field(std::size_t field, std::span<const std::byte> cells) = 0;
+  // Write the cells of x-slab `x` of a streamed field, slabs are written in order
+  virtual void write_slab(std::size_t field,
+                          std::size_t x,
+                          std::span<const std::byte> cells) = 0;
+  // Persist metadata after every field is written
+  virtual void finish(const nlohmann::json& metadata) = 0;
+  // Files written into the export directory, complete once finish returned
+  [[nodiscard]] virtual std::vector<std::filesystem::path> output_files() {
+    return {};
+  }
+};
+
+// Create sink selected by execution parameter inside the export directory
+[[nodiscard]] std::unique_ptr<ResultSink> make_result_sink(
+    AtomicLogger::AtomicLogger* result_log,
+    const std::filesystem::path& export_directory,
+    const Config::ExecutionParameter& execution_parameter);
+
+}  // namespace Computation
@@ -0,0 +1,201 @@
+#include "ResultStream.h"
+#include <fmt/format.h>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace Computation {
+
+namespace {
+
+std::string begin_payload(const FieldDescriptor& field, std::size_t id) {
+  auto result = to_json(field);
+  result["id"] = id;
+  result["streamed"] = field.streamed;
+  return result.dump();
+}
+
+// Bytes taken in the ring by a record with `size` bytes of payload
+std::uint64_t record_length(std::uint64_t size) {
+  return record_alignment + (size + record_alignment - 1) / record_alignment *
+                                record_alignment;
+}
+
+}  // namespace
+
+StreamSink::StreamSink(AtomicLogger::AtomicLogger* result_log, std::string target)
+    : result_log(result_log), stream(std::move(target)) {}
+
+void StreamSink::write_record(RecordKind kind,
+                              std::size_t field,
+                              std::size_t slab,
+                              std::span<const std::byte> payload) {
+  const auto scoped_lock = std::scoped_lock(this->stream_lock);
+  const auto record =
+      RecordHeader{record_magic, kind, field, slab, payload.size(), this->record_cnt};
+  this->stream.write(std::as_bytes(std::span(&record, 1)));
+  this->stream.write(payload);
+  ++this->record_cnt;
+  this->byte_cnt += sizeof(record) + payload.size();
+}
+
+std::size_t StreamSink::begin_field(const FieldDescriptor& field) {
+  const auto id = [&]() {
+    const auto scoped_lock = std::scoped_lock(this->stream_lock);
+    this->fields.push_back(field);
+    return this->fields.size() - 1;
+  }();
+  const auto payload = begin_payload(field, id);
+  this->write_record(RecordKind::Begin, id, 0, std::as_bytes(std::span(payload)));
+  return id;
+}
+
+void StreamSink::write_field(std::size_t field, std::span<const std::byte> cells) {
+  this->write_record(RecordKind::Field, field, 0, cells);
+}
+
+void StreamSink::write_slab(std::size_t field,
+                            std::size_t x,
+                            std::span<const std::byte> cells) {
+  this->write_record(RecordKind::Slab, field, x, cells);
+}
+
+void StreamSink::finish(const nlohmann::json& metadata) {
+  const auto payload = metadata.dump();
+  this->write_record(RecordKind::Finish, 0, 0, std::as_bytes(std::span(payload)));
+
+  const auto scoped_lock = std::scoped_lock(this->stream_lock);
+  this->result_log->log(fmt::format(FMT_STRING("Streamed {:d} records ({:.1f} MiB)"),
+                                    this->record_cnt,
+                                    double(this->byte_cnt) / (1024.0 * 1024.0)));
+}
+
+SharedMemorySink::SharedMemorySink(AtomicLogger::AtomicLogger* result_log,
+                                   std::string name,
+                                   std::size_t ring_size)
+    : result_log(result_log),
+      region(std::move(name), shared_memory_header_size + ring_size),
+      capacity(ring_size / record_alignment * record_alignment) {
+  auto& header = this->header();
+  header.magic = shared_memory_magic;
+  header.version = shared_memory_version;
+  header.capacity = this->capacity;
+
+  this->result_log->log(fmt::format(
+      FMT_STRING("Streaming results into shared memory {:s} ({:.1f} MiB ring)"),
+      this->region.get_name(), double(this->capacity) / (1024.0 * 1024.0)));
+}
+
+SharedMemoryHeader& SharedMemorySink::header() const {
+  return *reinterpret_cast<SharedMemoryHeader*>(this->region.data());
+}
+
+std::byte* SharedMemorySink::ring() const {
+  return this->region.data() + shared_memory_header_size;
+}
+
+void SharedMemorySink::append(const RecordHeader& record,
+                              std::span<const std::byte> payload) {
+  auto& header = this->header();
+  auto sequence = std::atomic_ref(header.sequence);
+  auto head = std::atomic_ref(header.head);
+  auto tail = std::atomic_ref(header.tail);
+
+  const auto first_sequence = sequence.load(std::memory_order_relaxed);
+  sequence.store(first_sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // drop the oldest records until the new one no longer overlaps them
+  const auto position = head.load(std::memory_order_relaxed);
+  const auto length = record_length(record.size);
+  auto oldest = tail.load(std::memory_order_relaxed);
+  while (oldest < position and oldest + this->capacity < position + length) {
+    auto oldest_record = RecordHeader();
+    std::memcpy(&oldest_record, this->ring() + oldest % this->capacity,
+                sizeof(oldest_record));
+    oldest += record_length(oldest_record.size);
+  }
+  tail.store(oldest, std::memory_order_relaxed);
+
+  auto* destination = this->ring() + position % this->capacity;
+  std::memcpy(destination, &record, sizeof(record));
+  if (not payload.empty()) {
+    std::memcpy(destination + record_alignment, payload.data(), payload.size());
+  }
+  head.store(position + length, std::memory_order_relaxed);
+
+  sequence.store(first_sequence + 2, std::memory_order_release);
+}
+
+void SharedMemorySink::write_record(RecordKind kind,
+                                    std::size_t field,
+                                    std::size_t slab,
+                                    std::span<const std::byte> payload) {
+  const auto scoped_lock = std::scoped_lock(this->ring_lock);
+  const auto length = record_length(payload.size());
+  if (length > this->capacity) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("Record of {:d} bytes exceeds shared memory ring of {:d} bytes"),
+        length, this->capacity));
+  }
+
+  const auto offset = this->header().head % this->capacity;
+  if (offset + length > this->capacity) {
+    const auto wrap = RecordHeader{record_magic, RecordKind::Wrap, 0, 0,
+                                   this->capacity - offset - record_alignment,
+                                   this->record_cnt++};
+    this->append(wrap, std::span<const std::byte>());
+  }
+  this->append(RecordHeader{record_magic, kind, field, slab, payload.size(),
+                            this->record_cnt++},
+               payload);
+}
+
+std::size_t SharedMemorySink::begin_field(const FieldDescriptor& field) {
+  const auto id = [&]() {
+    const auto scoped_lock = std::scoped_lock(this->ring_lock);
+    this->fields.push_back(field);
+    return this->fields.size() - 1;
+  }();
+  const auto payload = begin_payload(field, id);
+  this->write_record(RecordKind::Begin, id, 0, std::as_bytes(std::span(payload)));
+  return id;
+}
+
+void SharedMemorySink::write_field(std::size_t field,
+                                   std::span<const std::byte> cells) {
+  if (record_length(cells.size()) <= this->capacity) {
+    this->write_record(RecordKind::Field, field, 0, cells);
+    return;
+  }
+
+  // fields larger than the ring are sent slab by slab
+  const auto slab_bytes = [&]() {
+    const auto scoped_lock = std::scoped_lock(this->ring_lock);
+    return this->fields.at(field).slab_bytes();
+  }();
+  for (std::size_t x = 0; x * slab_bytes < cells.size(); ++x) {
+    this->write_record(RecordKind::Slab, field, x,
+                       cells.subspan(x * slab_bytes, slab_bytes));
+  }
+}
+
+void SharedMemorySink::write_slab(std::size_t field,
+                                  std::size_t x,
+                                  std::span<const std::byte> cells) {
+  this->write_record(RecordKind::Slab, field, x, cells);
+}
+
+void SharedMemorySink::finish(const nlohmann::json& metadata) {
+  const auto payload = metadata.dump();
+  this->write_record(RecordKind::Finish, 0, 0, std::as_bytes(std::span(payload)));
+
+  const auto scoped_lock = std::scoped_lock(this->ring_lock);
+  std::atomic_ref(this->header().finished).store(1, std::memory_order_release);
+  this->result_log->log(fmt::format(
+      FMT_STRING("Streamed {:d} records into shared memory {:s}"), this->record_cnt,
+      this->region.get_name()));
+}
+
+}  // namespace Computation
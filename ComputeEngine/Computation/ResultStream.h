@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <span>
+#include <string>
+#include <vector>
+#include "../Utilities/AtomicLogger.h"
+#include "../Utilities/OutputStream.h"
+#include "../Utilities/SharedMemory.h"
+#include "ResultSink.h"
+
+namespace Computation {
+
+/* Results as a sequence of records for a consumer running next to the simulation.
+ * Every record is a `RecordHeader` (native byte order) followed by `size` bytes:
+ * - Begin: JSON descriptor of field `field` (as in container indices, plus
+ *   "streamed"), sent before any of its cells
+ * - Field: every cell of field `field` in x-major order
+ * - Slab: cells of x-slab `slab` of field `field`, slabs of a field arrive in order
+ * - Finish: JSON run metadata, the last record of a run
+ * - Wrap: shared memory only, the ring continues at its start */
+enum class RecordKind : std::uint64_t {
+  Begin = 0,
+  Field = 1,
+  Slab = 2,
+  Finish = 3,
+  Wrap = 4
+};
+
+constexpr auto record_magic =
+    std::array<char, 8>{'A', 'C', 'S', 'I', 'M', 'R', 'E', 'C'};
+
+struct RecordHeader {
+  std::array<char, 8> magic;
+  RecordKind kind;
+  std::uint64_t field;
+  std::uint64_t slab;
+  // Bytes following the header
+  std::uint64_t size;
+  // Records are numbered from 0 in the order they are written
+  std::uint64_t index;
+};
+
+class StreamSink : public ResultSink {
+  // Records written back to back to stdout or a named pipe
+  AtomicLogger::AtomicLogger* result_log;
+  OutputStream::OutputStream stream;
+
+  std::mutex stream_lock;
+  std::vector<FieldDescriptor> fields;
+  std::uint64_t record_cnt = 0;
+  std::uint64_t byte_cnt = 0;
+
+  void write_record(RecordKind kind,
+                    std::size_t field,
+                    std::size_t slab,
+                    std::span<const std::byte> payload);
+
+ public:
+  StreamSink(AtomicLogger::AtomicLogger* result_log, std::string target);
+
+  std::size_t begin_field(const FieldDescriptor& field) override;
+  void write_field(std::size_t field, std::span<const std::byte> cells) override;
+  void write_slab(std::size_t field,
+                  std::size_t x,
+                  std::span<const std::byte> cells) override;
+  void finish(const nlohmann::json& metadata) override;
+};
+
+/* Shared memory layout: `SharedMemoryHeader`, then from offset
+ * `shared_memory_header_size` a ring of `capacity` bytes holding records. Records
+ * and payloads start at multiples of `record_alignment`, so cells can be used in
+ * place, and a record never wraps: a Wrap record fills the end of the ring instead.
+ *
+ * Positions are byte counts since the start of the run, the record at position p
+ * is at ring offset p % capacity. `head` is the position of the next record and
+ * `tail` the position of the oldest record not overwritten yet. Writing a record
+ * makes `sequence` odd, moves tail past the records it overwrites, writes the
+ * record, moves head and makes `sequence` even again (a seqlock).
+ *
+ * A consumer reads sequence (acquire), head and tail, then sequence again, and
+ * retries while they differ or sequence is odd. Records at positions in
+ * [tail, head) are complete; a record used in place is still valid if tail has
+ * not passed its position when read again the same way afterwards. Fields larger
+ * than the ring are sent as Slab records. The region stays after the run, with
+ * `finished` set once the Finish record is written. */
+constexpr auto shared_memory_magic =
+    std::array<char, 8>{'A', 'C', 'S', 'I', 'M', 'S', 'H', 'M'};
+constexpr auto shared_memory_version = std::uint32_t(1);
+constexpr auto shared_memory_header_size = std::uint64_t(4096);
+constexpr auto record_alignment = std::uint64_t(64);
+
+struct SharedMemoryHeader {
+  std::array<char, 8> magic;
+  std::uint32_t version;
+  std::uint32_t reserved;
+  std::uint64_t capacity;
+  std::uint64_t sequence;
+  std::uint64_t head;
+  std::uint64_t tail;
+  std::uint64_t finished;
+};
+
+class SharedMemorySink : public ResultSink {
+  AtomicLogger::AtomicLogger* result_log;
+  SharedMemory::SharedMemory region;
+  std::uint64_t capacity;
+
+  std::mutex ring_lock;
+  std::vector<FieldDescriptor> fields;
+  std::uint64_t record_cnt = 0;
+
+  [[nodiscard]] SharedMemoryHeader& header() const;
+  [[nodiscard]] std::byte* ring() const;
+  // Append one record to the ring, wrapping first if it does not fit before the end
+  void write_record(RecordKind kind,
+                    std::size_t field,
+                    std::size_t slab,
+                    std::span<const std::byte> payload);
+  // Write a record at head while sequence is odd, ring_lock must be held
+  void append(const RecordHeader& record, std::span<const std::byte> payload);
+
+ public:
+  SharedMemorySink(AtomicLogger::AtomicLogger* result_log,
+                   std::string name,
+                   std::size_t ring_size);
+
+  std::size_t begin_field(const FieldDescriptor& field) override;
+  void write_field(std::size_t field, std::span<const std::byte> cells) override;
+  void write_slab(std::size_t field,
+                  std::size_t x,
+                  std::span<const std::byte> cells) override;
+  void finish(const nlohmann::json& metadata) override;
+};
+
+}  // namespace Computation
@@ -0,0 +1,104 @@
+#include "RunControl.h"
+#include <algorithm>
+
+namespace Computation {
+
+namespace {
+
+// Threads get slots in the order they first count work, whichever backend runs them
+std::atomic<std::size_t> next_slot = 0;
+thread_local const auto thread_slot = next_slot.fetch_add(1);
+
+}  // namespace
+
+void RunControl::cancel() {
+  {
+    const auto scoped_lock = std::scoped_lock(this->state_lock);
+    this->cancelled.store(true);
+  }
+  // paused loops wake up to stop
+  this->resumed.notify_all();
+}
+
+void RunControl::pause() {
+  const auto scoped_lock = std::scoped_lock(this->state_lock);
+  if (not this->paused.load()) {
+    this->pause_started = Clock::now();
+    this->paused.store(true);
+  }
+}
+
+void RunControl::resume() {
+  {
+    const auto scoped_lock = std::scoped_lock(this->state_lock);
+    if (this->paused.load()) {
+      this->paused_duration += Clock::now() - this->pause_started;
+      this->paused.store(false);
+    }
+  }
+  this->resumed.notify_all();
+}
+
+bool RunControl::should_stop() {
+  if (this->paused.load()) {
+    auto unique_lock = std::unique_lock(this->state_lock);
+    this->resumed.wait(unique_lock, [&]() {
+      return not this->paused.load() or this->cancelled.load();
+    });
+  }
+  return this->cancelled.load();
+}
+
+void RunControl::check() {
+  if (this->should_stop()) {
+    throw RunCancelled();
+  }
+}
+
+void RunControl::add_work(std::uint64_t units) {
+  {
+    const auto scoped_lock = std::scoped_lock(this->state_lock);
+    if (not this->started) {
+      this->started = Clock::now();
+    }
+  }
+  this->total.fetch_add(units);
+}
+
+void RunControl::advance(std::uint64_t units) {
+  this->slots[thread_slot % slot_count].done.fetch_add(units,
+                                                       std::memory_order_relaxed);
+}
+
+RunProgress RunControl::progress() const {
+  auto result = RunProgress();
+  result.paused = this->paused.load();
+  result.cancelled = this->cancelled.load();
+
+  auto done = std::uint64_t(0);
+  for (const auto& slot : this->slots) {
+    done += slot.done.load(std::memory_order_relaxed);
+  }
+  const auto total_units = this->total.load();
+  if (total_units > 0) {
+    result.fraction = std::min(double(done) / double(total_units), 1.0);
+  }
+
+  const auto scoped_lock = std::scoped_lock(this->state_lock);
+  if (this->started) {
+    const auto now = Clock::now();
+    auto elapsed = now - *this->started - this->paused_duration;
+    if (result.paused) {
+      elapsed -= now - this->pause_started;
+    }
+    result.elapsed_seconds =
+        std::max(std::chrono::duration<double>(elapsed).count(), 0.0);
+  }
+  if (result.fraction > 0.0) {
+    result.remaining_seconds =
+        result.elapsed_seconds * (1.0 - result.fraction) / result.fraction;
+  }
+  return result;
+}
+
+}  // namespace Computation
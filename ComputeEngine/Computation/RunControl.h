@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+
+namespace Computation {
+
+// Thrown out of a stage once its run is cancelled
+class RunCancelled : public std::runtime_error {
+ public:
+  RunCancelled() : std::runtime_error("Simulation cancelled") {}
+};
+
+struct RunProgress {
+  // Share of the announced work done, in [0, 1]
+  double fraction = 0.0;
+  // Seconds spent running, pauses excluded
+  double elapsed_seconds = 0.0;
+  // Estimated from the rate so far, once any work is done
+  std::optional<double> remaining_seconds;
+  bool paused = false;
+  bool cancelled = false;
+};
+
+/* Cancellation, pausing and progress of one run, shared by the thread driving the
+ * run, the threads of its parallel loops and the views watching it.
+ *
+ * Processes announce the work of their stages in units, a cell for stencils and a
+ * cell times transducers for pressure, and loops count the units of every finished
+ * tile. Each thread counts into its own slot, so workers never share a cache line
+ * and reading progress never blocks them. Loops check for cancellation and pauses
+ * between tiles. */
+class RunControl {
+  using Clock = std::chrono::steady_clock;
+
+  struct alignas(64) Slot {
+    std::atomic<std::uint64_t> done = 0;
+  };
+  static constexpr auto slot_count = std::size_t(64);
+
+  std::array<Slot, slot_count> slots;
+  std::atomic<std::uint64_t> total = 0;
+  std::atomic<bool> cancelled = false;
+  std::atomic<bool> paused = false;
+
+  // Guards pausing and the times below
+  mutable std::mutex state_lock;
+  std::condition_variable resumed;
+  std::optional<Clock::time_point> started;
+  Clock::time_point pause_started;
+  Clock::duration paused_duration = Clock::duration::zero();
+
+ public:
+  RunControl() = default;
+  RunControl(const RunControl&) = delete;
+  RunControl& operator=(const RunControl&) = delete;
+
+  void cancel();
+  void pause();
+  void resume();
+  [[nodiscard]] bool is_cancelled() const { return cancelled.load(); }
+  [[nodiscard]] bool is_paused() const { return paused.load(); }
+
+  // Called by loops between tiles, waits while paused and returns whether the run
+  // is cancelled
+  [[nodiscard]] bool should_stop();
+  // Called between stages, waits while paused and throws RunCancelled once cancelled
+  void check();
+
+  // Announce work of stages to come
+  void add_work(std::uint64_t units);
+  // Count finished work into the slot of the calling thread
+  void advance(std::uint64_t units);
+
+  [[nodiscard]] RunProgress progress() const;
+};
+
+}  // namespace Computation
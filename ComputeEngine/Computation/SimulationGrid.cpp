@@ -0,0 +1,34 @@
+#include "SimulationGrid.h"
+
+namespace Computation {
+
+SimulationGrid make_simulation_grid(
+    const Config::SimulationParameter& simulation_parameter) {
+  const auto force_cnt =
+      ((simulation_parameter.end - simulation_parameter.begin).elem_abs() /
+       simulation_parameter.cell_size)
+          .cast<std::size_t>() +
+      1;
+  const auto force_beg = simulation_parameter.begin;
+  const auto force_end =
+      simulation_parameter.begin +
+      ((force_cnt.cast<double>() - 1.0) * simulation_parameter.cell_size);
+
+  const auto padding = simulation_parameter.stencil_padding();
+  const auto padding_size = simulation_parameter.cell_size * double(padding);
+
+  const auto potential_cnt = force_cnt + 2 * padding;
+  const auto potential_beg = force_beg - padding_size;
+  const auto potential_end = force_end + padding_size;
+
+  const auto pressure_cnt = potential_cnt + 2 * padding;
+  const auto pressure_beg = potential_beg - padding_size;
+  const auto pressure_end = potential_end + padding_size;
+
+  return SimulationGrid{
+      padding, CellBlockInterpolation(force_cnt, force_beg, force_end),
+      CellBlockInterpolation(potential_cnt, potential_beg, potential_end),
+      CellBlockInterpolation(pressure_cnt, pressure_beg, pressure_end)};
+}
+
+}  // namespace Computation
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include "BlockStorage.h"
+#include "Config.h"
+
+namespace Computation {
+
+struct SimulationGrid {
+  // Cells added on each side of a grid to differentiate the grid inside it
+  std::size_t padding;
+
+  // force result is the smallest which will be used as the baseline, potential
+  // and pressure are padded to be differentiated once and twice respectively
+  CellBlockInterpolation force;
+  CellBlockInterpolation potential;
+  CellBlockInterpolation pressure;
+};
+
+[[nodiscard]] SimulationGrid make_simulation_grid(
+    const Config::SimulationParameter& simulation_parameter);
+
+}  // namespace Computation
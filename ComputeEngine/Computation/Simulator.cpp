@@ -1,229 +1,277 @@
 #include "Simulator.h"
+#include <fmt/format.h>
 #include <chrono>
-#include <complex>
 #include <filesystem>
 #include <fstream>
-#include <numbers>
-#include <string_view>
-#include "BlockStorage.h"
+#include <optional>
+#include <stdexcept>
+#include "Checkpoint.h"
+#include "MemoryPlanner.h"
+#include "PartialReuse.h"
+#include "Processes.h"
+#include "ResultCache.h"
+#include "ResultSink.h"
+#include "SimulationGrid.h"
 
 namespace Computation {
 
-// constant i
-constexpr auto i = std::complex<double>(0, 1);
-
-std::complex<double> compute_pressure(const Vec3<double>& point,
-                                      const Config::Transducer& transducer,
-                                      const Config::SimulationParameter& simulation_parameter) {
-  const auto angle = transducer.position.cosine_angle(transducer.target, point);
-  const auto dist = transducer.position.euclidean_distance(point);
-  const auto wave_number = 2.0 * std::numbers::pi * simulation_parameter.frequency /
-                           simulation_parameter.air_wave_speed;
-
-  const auto directivity = [&]() -> double {
-    const auto intermediate = wave_number * transducer.radius * std::sin(angle);
-    if (intermediate == 0.0) {
-      return 1.0;
-    }
-    return 2.0 * std::cyl_bessel_j(1, intermediate) / intermediate;
-  }();
-
-  return std::exp(i * (wave_number * dist + transducer.phase_shift)) *
-         (transducer.output_power * transducer.loss_factor * directivity / dist);
-}
+namespace {
 
-template <typename T, typename D>
-constexpr T numerical_differentiation(const T& lhs, const T& rhs, const D& dist) {
-  return (rhs - lhs) / (dist * 2);
+// Metadata every result starts with
+nlohmann::json run_metadata(const Config::SimulationParameter& simulation_parameter) {
+  auto metadata = nlohmann::json();
+  metadata["version"] = 1;
+  metadata["engine_version"] = engine_version;
+  metadata["precision"] = precision_mode;
+  metadata["simulation_parameter"] =
+      JSONConvert::from_simulation_parameter(simulation_parameter);
+  metadata["differentiation_order"] = simulation_parameter.differentiation_order;
+  metadata["stencil_padding"] = simulation_parameter.stencil_padding();
+  return metadata;
 }
 
-constexpr double euclidean_norm_squared(const std::complex<double>& complex) {
-  return complex.real() * complex.real() + complex.imag() * complex.imag();
+// Size and bounds of each grid of a whole box result
+void add_grid_metadata(nlohmann::json& metadata, const SimulationGrid& grid) {
+  metadata["pressure_cnt"] = grid.pressure.get_dimension_size().to_json();
+  metadata["pressure_beg"] = grid.pressure.get_begin().to_json();
+  metadata["pressure_end"] = grid.pressure.get_end().to_json();
+  metadata["potential_cnt"] = grid.potential.get_dimension_size().to_json();
+  metadata["potential_beg"] = grid.potential.get_begin().to_json();
+  metadata["potential_end"] = grid.potential.get_end().to_json();
+  metadata["force_cnt"] = grid.force.get_dimension_size().to_json();
+  metadata["force_beg"] = grid.force.get_begin().to_json();
+  metadata["force_end"] = grid.force.get_end().to_json();
 }
 
-void simulationProcess(std::atomic<bool>* process_lock_simulation_running,
-                       AtomicLogger::AtomicLogger* result_log,
-                       std::filesystem::path export_directory,
-                       std::vector<Config::Transducer> transducers,
-                       Config::SimulationParameter simulation_parameter) {
-  result_log->log("Simulation process started");
+// Compute every result into the sink selected by the execution parameter, reusing
+// cells of a cached run unless `reuse` is null, returns the files written
+std::vector<std::filesystem::path> run_simulation(
+    AtomicLogger::AtomicLogger* result_log,
+    RunControl* control,
+    const std::filesystem::path& export_directory,
+    const std::vector<Config::Transducer>& transducers,
+    const Config::SimulationParameter& simulation_parameter,
+    const Config::ExecutionParameter& execution_parameter,
+    const PartialReuse* reuse) {
+  auto metadata = run_metadata(simulation_parameter);
+
+  const auto sink = make_result_sink(result_log, export_directory, execution_parameter);
+
+  // Checkpoints only hold intermediate fields of whole box runs of every output
+  auto checkpoint = std::optional<Checkpoint>();
+  if ((execution_parameter.checkpoint or execution_parameter.resume) and
+      execution_parameter.targets.empty() and execution_parameter.outputs.empty()) {
+    checkpoint.emplace(result_log, export_directory / "checkpoint",
+                       checkpoint_tag(transducers, simulation_parameter),
+                       std::chrono::seconds(execution_parameter.checkpoint_interval),
+                       execution_parameter.resume);
+  }
 
-  // force result is the smallest which will be used as the baseline
-  const auto force_cnt =
-      ((simulation_parameter.end - simulation_parameter.begin).elem_abs() /
-       simulation_parameter.cell_size)
-          .cast<std::size_t>() +
-      1;
-  const auto force_beg = simulation_parameter.begin;
-  const auto force_end =
-      simulation_parameter.begin +
-      ((force_cnt.cast<double>() - 1.0) * simulation_parameter.cell_size);
-  const auto force_blk = CellBlockInterpolation(force_cnt, force_beg, force_end);
-  const auto force_lpn = int64_t(force_blk.get_cell_count());
-
-  // for pressure and potential result, padding is added for differentiation
-  const auto potential_cnt = force_cnt + 2;
-  const auto potential_beg = force_beg - simulation_parameter.cell_size;
-  const auto potential_end = force_end + simulation_parameter.cell_size;
-  const auto potential_blk =
-      CellBlockInterpolation(potential_cnt, potential_beg, potential_end);
-  const auto potential_lpn = int64_t(potential_blk.get_cell_count());
-
-  const auto pressure_cnt = potential_cnt + 2;
-  const auto pressure_beg = potential_beg - simulation_parameter.cell_size;
-  const auto pressure_end = potential_end + simulation_parameter.cell_size;
-  const auto pressure_blk =
-      CellBlockInterpolation(pressure_cnt, pressure_beg, pressure_end);
-  const auto pressure_lpn = int64_t(pressure_blk.get_cell_count());
-
-  // TODO: Update openmp loops (see comment)
-  /* OpenMP 2.0 (latest supported by MSVC) doesn't allow for unsigned loop counter
-   * for some reason. Making this project works with clang-cl should resolve this
-   * and allow loops to be indexed by std::size_t and some performance gain. */
-
-  result_log->log("Computing pressure");
-
-  auto pressure_val = CellBlock<std::complex<double>>(pressure_cnt);
-
-#pragma omp parallel for
-  for (int64_t id = 0; id < pressure_lpn; ++id) {
-    auto pressure_result = std::complex<double>();
-    for (const auto& transducer : transducers) {
-      pressure_result += compute_pressure(pressure_blk.get_real_vec(id), transducer,
-                                          simulation_parameter);
+  if (not execution_parameter.targets.empty()) {
+    metadata["targets"] =
+        targetProcess(result_log, control, transducers, simulation_parameter,
+                      execution_parameter, *sink);
+  } else {
+    const auto grid = make_simulation_grid(simulation_parameter);
+
+    if (not simulation_parameter.frequencies.empty()) {
+      multiFrequencyProcess(result_log, control, transducers, simulation_parameter,
+                            execution_parameter, grid, *sink);
+      metadata["incoherent_sum"] = execution_parameter.incoherent_sum;
+    } else if (not execution_parameter.outputs.empty()) {
+      graphProcess(result_log, control, export_directory, transducers,
+                   simulation_parameter, execution_parameter, grid, *sink);
+      metadata["outputs"] = execution_parameter.outputs;
+    } else if (execution_parameter.slab_streaming) {
+      slabStreamingProcess(result_log, control, transducers, simulation_parameter,
+                           execution_parameter, grid, *sink);
+    } else {
+      residentProcess(result_log, control, export_directory, transducers,
+                      simulation_parameter, execution_parameter, grid, *sink,
+                      checkpoint ? &*checkpoint : nullptr, reuse);
+    }
+    if (not execution_parameter.particles.empty()) {
+      metadata["particles"] = nlohmann::json::array();
+      for (const auto& particle : execution_parameter.particles) {
+        metadata["particles"].push_back(JSONConvert::from_particle_parameter(particle));
+      }
     }
-    pressure_val.set_cell(id, pressure_result);
+
+    metadata["slab_streaming"] = execution_parameter.slab_streaming;
+    metadata["mapped_output"] =
+        execution_parameter.mapped_output and
+        not execution_parameter.slab_streaming and
+        execution_parameter.output_format == Config::OutputFormat::Legacy;
+    add_grid_metadata(metadata, grid);
   }
 
-  result_log->log("Computing potential");
-
-  // constant used for potential computation
-  const auto k1 = simulation_parameter.constant_k1();
-  const auto k2 = simulation_parameter.constant_k2();
-
-  auto potential_val = CellBlock<double>(potential_cnt);
-
-#pragma omp parallel for
-  for (int64_t id = 0; id < potential_lpn; ++id) {
-    const auto idx_lhs = potential_blk.get_int_vec(id);
-    const auto idx_mid = idx_lhs + 1;
-    const auto idx_rhs = idx_lhs + 2;
-
-    // TODO: Refactor this
-    // Call below is unreadable and should be wrapped in a function or some kind of
-    // abstraction
-    const auto p_x = euclidean_norm_squared(numerical_differentiation(
-        pressure_val.get_cell(pressure_blk.get_id({idx_lhs.x, idx_mid.y, idx_mid.z})),
-        pressure_val.get_cell(pressure_blk.get_id({idx_rhs.x, idx_mid.y, idx_mid.z})),
-        simulation_parameter.cell_size));
-    const auto p_y = euclidean_norm_squared(numerical_differentiation(
-        pressure_val.get_cell(pressure_blk.get_id({idx_mid.x, idx_lhs.y, idx_mid.z})),
-        pressure_val.get_cell(pressure_blk.get_id({idx_mid.x, idx_rhs.y, idx_mid.z})),
-        simulation_parameter.cell_size));
-    const auto p_z = euclidean_norm_squared(numerical_differentiation(
-        pressure_val.get_cell(pressure_blk.get_id({idx_mid.x, idx_mid.y, idx_lhs.z})),
-        pressure_val.get_cell(pressure_blk.get_id({idx_mid.x, idx_mid.y, idx_rhs.z})),
-        simulation_parameter.cell_size));
-
-    const auto p = euclidean_norm_squared(
-        pressure_val.get_cell(pressure_blk.get_id({idx_mid.x, idx_mid.y, idx_mid.z})));
-
-    const auto u = 2.0 * k1 * p - 2.0 * k2 * (p_x + p_y + p_z);
-    potential_val.set_cell(id, u);
+  metadata["output_format"] =
+      JSONConvert::from_execution_parameter(execution_parameter)["output_format"];
+
+  result_log->log("Exporting metadata");
+  sink->finish(metadata);
+
+  // results are complete, so the run is never resumed from its checkpoint
+  if (checkpoint) {
+    checkpoint->remove();
+  }
+
+  return sink->output_files();
+}
+
+// Compute every point of the sweep into folder `point_<index>` of the export
+// directory, indexed by `sweep.json` there, returns the files written
+std::vector<std::filesystem::path> run_sweep(
+    AtomicLogger::AtomicLogger* result_log,
+    RunControl* control,
+    const std::filesystem::path& export_directory,
+    const std::vector<Config::Transducer>& transducers,
+    const Config::SimulationParameter& simulation_parameter,
+    const Config::ExecutionParameter& execution_parameter) {
+  const auto& sweep = execution_parameter.sweep;
+  const auto values = sweep.points();
+
+  // every point is checked before anything is computed
+  auto point_parameters = std::vector<Config::SimulationParameter>();
+  for (const auto value : values) {
+    auto point_transducers = transducers;
+    auto point_parameter = simulation_parameter;
+    sweep.apply(value, point_transducers, point_parameter);
+    const auto invalid_point = point_parameter.checkInvalidParameter();
+    if (not invalid_point.empty()) {
+      throw std::invalid_argument(
+          fmt::format(FMT_STRING("Sweep point {:g}: {:s}"), value, invalid_point));
+    }
+    point_parameters.push_back(point_parameter);
   }
 
-  result_log->log("Computing force");
-
-  auto force_x_val = CellBlock<double>(force_cnt);
-  auto force_y_val = CellBlock<double>(force_cnt);
-  auto force_z_val = CellBlock<double>(force_cnt);
-
-#pragma omp parallel for
-  for (int64_t id = 0; id < force_lpn; ++id) {
-    const auto idx_lhs = force_blk.get_int_vec(id);
-    const auto idx_mid = idx_lhs + 1;
-    const auto idx_rhs = idx_lhs + 2;
-
-    // TODO: Refactor this (too)
-    const auto f_x = -numerical_differentiation(
-        potential_val.get_cell(potential_blk.get_id({idx_lhs.x, idx_mid.y, idx_mid.z})),
-        potential_val.get_cell(potential_blk.get_id({idx_rhs.x, idx_mid.y, idx_mid.z})),
-        simulation_parameter.cell_size);
-    const auto f_y = -numerical_differentiation(
-        potential_val.get_cell(potential_blk.get_id({idx_mid.x, idx_lhs.y, idx_mid.z})),
-        potential_val.get_cell(potential_blk.get_id({idx_mid.x, idx_rhs.y, idx_mid.z})),
-        simulation_parameter.cell_size);
-    const auto f_z = -numerical_differentiation(
-        potential_val.get_cell(potential_blk.get_id({idx_mid.x, idx_mid.y, idx_lhs.z})),
-        potential_val.get_cell(potential_blk.get_id({idx_mid.x, idx_mid.y, idx_rhs.z})),
-        simulation_parameter.cell_size);
-
-    force_x_val.set_cell(id, f_x);
-    force_y_val.set_cell(id, f_y);
-    force_z_val.set_cell(id, f_z);
+  // no swept parameter changes the box or cell size, so every point shares a grid
+  const auto grid = make_simulation_grid(simulation_parameter);
+  auto sinks = std::vector<std::unique_ptr<ResultSink>>();
+  auto index = nlohmann::json();
+  index["version"] = 1;
+  index["sweep"] = JSONConvert::from_sweep_parameter(sweep);
+  index["points"] = nlohmann::json::array();
+  for (std::size_t point = 0; point < values.size(); ++point) {
+    const auto folder = fmt::format(FMT_STRING("point_{:04d}"), point);
+    std::filesystem::create_directories(export_directory / folder);
+    sinks.push_back(
+        make_result_sink(result_log, export_directory / folder, execution_parameter));
+    index["points"].push_back({{"index", point}, {"value", values[point]},
+                               {"folder", folder}});
   }
 
-  result_log->log("Exporting data");
-
-  auto pressure_exp =
-      std::ofstream(export_directory / std::string_view("pressure_result.bin"),
-                    std::fstream::out | std::fstream::trunc | std::fstream::binary);
-  pressure_exp.write(pressure_val.unsafe_get_raw_bytes(),
-                     pressure_val.size() * sizeof(std::complex<double>));
-  pressure_exp.close();
-
-  auto potential_exp =
-      std::ofstream(export_directory / std::string_view("potential_result.bin"),
-                    std::fstream::out | std::fstream::trunc | std::fstream::binary);
-  potential_exp.write(potential_val.unsafe_get_raw_bytes(),
-                      potential_val.size() * sizeof(double));
-  potential_exp.close();
-
-  auto force_x_exp =
-      std::ofstream(export_directory / std::string_view("force_x_result.bin"),
-                    std::fstream::out | std::fstream::trunc | std::fstream::binary);
-  force_x_exp.write(force_x_val.unsafe_get_raw_bytes(),
-                    force_x_val.size() * sizeof(double));
-  force_x_exp.close();
-
-  auto force_y_exp =
-      std::ofstream(export_directory / std::string_view("force_y_result.bin"),
-                    std::fstream::out | std::fstream::trunc | std::fstream::binary);
-  force_y_exp.write(force_y_val.unsafe_get_raw_bytes(),
-                    force_y_val.size() * sizeof(double));
-  force_y_exp.close();
-
-  auto force_z_exp =
-      std::ofstream(export_directory / std::string_view("force_z_result.bin"),
-                    std::fstream::out | std::fstream::trunc | std::fstream::binary);
-  force_z_exp.write(force_z_val.unsafe_get_raw_bytes(),
-                    force_z_val.size() * sizeof(double));
-  force_z_exp.close();
+  sweepProcess(result_log, control, transducers, simulation_parameter,
+               execution_parameter, grid, sinks);
 
   result_log->log("Exporting metadata");
+  auto files = std::vector<std::filesystem::path>();
+  for (std::size_t point = 0; point < values.size(); ++point) {
+    auto metadata = run_metadata(point_parameters[point]);
+    metadata["sweep"] = {{"parameter", index["sweep"]["parameter"]},
+                         {"index", point},
+                         {"value", values[point]}};
+    metadata["slab_streaming"] = false;
+    metadata["mapped_output"] = false;
+    add_grid_metadata(metadata, grid);
+    metadata["output_format"] =
+        JSONConvert::from_execution_parameter(execution_parameter)["output_format"];
+    sinks[point]->finish(metadata);
+    for (const auto& file : sinks[point]->output_files()) {
+      files.push_back(file);
+    }
+  }
 
-  auto metadata = nlohmann::json();
+  const auto index_path = export_directory / "sweep.json";
+  auto index_file = std::ofstream(index_path);
+  index_file << index.dump(2);
+  if (not index_file) {
+    throw std::runtime_error("Unable to write " + index_path.string());
+  }
+  files.push_back(index_path);
+  return files;
+}
 
-  metadata["version"] = 1;
-  metadata["pressure_cnt"] = pressure_cnt.to_json();
-  metadata["pressure_beg"] = pressure_beg.to_json();
-  metadata["pressure_end"] = pressure_end.to_json();
-  metadata["potential_cnt"] = potential_cnt.to_json();
-  metadata["potential_beg"] = potential_beg.to_json();
-  metadata["potential_end"] = potential_end.to_json();
-  metadata["force_cnt"] = force_cnt.to_json();
-  metadata["force_beg"] = force_beg.to_json();
-  metadata["force_end"] = force_end.to_json();
-
-  auto metadata_export =
-      std::ofstream(export_directory / std::string_view("metadata.json"),
-                    std::fstream::out | std::fstream::trunc | std::fstream::binary);
-  metadata_export << metadata.dump();
-  metadata_export.close();
-
-  // Unlock process
-  result_log->log("Simulation process done");
-  process_lock_simulation_running->store(false);
+}  // namespace
+
+bool simulationProcess(AtomicLogger::AtomicLogger* result_log,
+                       RunControl* control,
+                       std::filesystem::path export_directory,
+                       std::vector<Config::Transducer> transducers,
+                       Config::SimulationParameter simulation_parameter,
+                       Config::ExecutionParameter execution_parameter) {
+  result_log->log("Simulation process started");
+
+  auto succeeded = false;
+  try {
+    const auto invalid_combination =
+        Config::checkInvalidCombination(simulation_parameter, execution_parameter);
+    if (not invalid_combination.empty()) {
+      throw std::invalid_argument(invalid_combination);
+    }
+
+    // Streamed results leave no files behind to cache, and sweeps no single result
+    auto cache = std::optional<ResultCache>();
+    if (not execution_parameter.result_cache.empty() and
+        execution_parameter.sweep.kind == Config::SweepParameter::Kind::None and
+        (execution_parameter.output_format == Config::OutputFormat::Container or
+         execution_parameter.output_format == Config::OutputFormat::Legacy)) {
+      cache.emplace(execution_parameter.result_cache);
+    }
+    const auto parameters =
+        cache ? cache_parameters(transducers, simulation_parameter, execution_parameter)
+              : nlohmann::json();
+    const auto key = cache ? cache_key(parameters) : std::string();
+
+    if (const auto entry =
+            cache ? cache->restore(key, parameters, export_directory) : std::nullopt) {
+      result_log->log(fmt::format(FMT_STRING("Reused cached results {:s} ({:s})"),
+                                  key, format_bytes(entry->bytes)));
+    } else {
+      // a cached run on the same lattice saves computing the cells both share
+      const auto reuse =
+          cache and execution_parameter.targets.empty() and
+                  execution_parameter.outputs.empty() and
+                  simulation_parameter.frequencies.empty() and
+                  not execution_parameter.slab_streaming
+              ? find_partial_reuse(result_log, *cache, parameters)
+              : nullptr;
+      const auto files =
+          execution_parameter.sweep.kind != Config::SweepParameter::Kind::None
+              ? run_sweep(result_log, control, export_directory, transducers,
+                          simulation_parameter, execution_parameter)
+              : run_simulation(result_log, control, export_directory, transducers,
+                               simulation_parameter, execution_parameter, reuse.get());
+      // results are written at this point, so failing to cache them is not fatal
+      if (cache) {
+        try {
+          const auto stored = cache->store(key, parameters, files);
+          result_log->log(fmt::format(FMT_STRING("Cached results as {:s} ({:s})"),
+                                      key, format_bytes(stored.bytes)));
+          const auto capacity = execution_parameter.result_cache_size * 1024 * 1024;
+          for (const auto& evicted : cache->evict(capacity)) {
+            result_log->log(
+                fmt::format(FMT_STRING("Evicted cached results {:s} ({:s})"),
+                            evicted.key, format_bytes(evicted.bytes)));
+          }
+        } catch (const std::exception& e) {
+          result_log->log(
+              fmt::format(FMT_STRING("Unable to cache results: {:s}"), e.what()));
+        }
+      }
+    }
+
+    result_log->log("Simulation process done");
+    succeeded = true;
+  } catch (const RunCancelled&) {
+    // files written so far stay, checkpoints let resident runs resume later
+    result_log->log("Simulation process cancelled");
+  } catch (const std::exception& e) {
+    result_log->log(
+        fmt::format(FMT_STRING("Simulation process failed: {:s}"), e.what()));
+  }
+
+  return succeeded;
 }
 
 }  // namespace Computation
\ No newline at end of file
@@ -1,19 +1,30 @@
 #pragma once
 
-#include <atomic>
 #include <filesystem>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include "../Utilities/AtomicLogger.h"
 #include "Config.h"
+#include "RunControl.h"
 #include "Vec3.h"
 
 namespace Computation {
 
-void simulationProcess(std::atomic<bool>* process_lock_simulation_running,
-                       AtomicLogger::AtomicLogger* result_log,
+// Version of the numerical engine, increased whenever the same parameters lead to
+// different results, so results of older engines are not reused from the cache
+constexpr auto engine_version = 1;
+// Every field is computed and stored in double precision
+constexpr auto precision_mode = std::string_view("float64");
+
+// Compute and export results with the executor of the calling thread. `control`
+// cancels or pauses the run and reports its progress. Failures and cancellation are
+// logged, returns whether the run succeeded
+bool simulationProcess(AtomicLogger::AtomicLogger* result_log,
+                       RunControl* control,
                        std::filesystem::path export_directory,
                        std::vector<Config::Transducer> transducers,
-                       Config::SimulationParameter simulation_parameter);
+                       Config::SimulationParameter simulation_parameter,
+                       Config::ExecutionParameter execution_parameter);
 
 }  // namespace Computation
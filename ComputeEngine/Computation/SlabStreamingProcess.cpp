@@ -0,0 +1,197 @@
+#include <fmt/format.h>
+#include <array>
+#include <complex>
+#include <optional>
+#include "BlockStorage.h"
+#include "Kernels.h"
+#include "MemoryPlanner.h"
+#include "PressureEvaluation.h"
+#include "Processes.h"
+
+namespace Computation {
+
+void slabStreamingProcess(AtomicLogger::AtomicLogger* result_log,
+                          RunControl* control,
+                          const std::vector<Config::Transducer>& transducers,
+                          const Config::SimulationParameter& simulation_parameter,
+                          const Config::ExecutionParameter& execution_parameter,
+                          const SimulationGrid& grid,
+                          ResultSink& sink) {
+  const auto padding = grid.padding;
+  const auto coefficients =
+      central_difference_coefficients(simulation_parameter.differentiation_order);
+
+  // Cells are ordered x-major so every x-slab is a contiguous yz plane, and slabs
+  // are written in order as the sweep advances along x
+  const auto pressure_cnt = grid.pressure.get_dimension_size();
+  const auto potential_cnt = grid.potential.get_dimension_size();
+  const auto force_cnt = grid.force.get_dimension_size();
+  const auto pressure_slab = pressure_cnt.y * pressure_cnt.z;
+  const auto potential_slab = potential_cnt.y * potential_cnt.z;
+  const auto force_slab = force_cnt.y * force_cnt.z;
+
+  // A slab is differentiated with `padding` slabs on each side of it, so each ring
+  // only holds the slabs the next stage is still going to read
+  const auto ring_depth = 2 * padding + 1;
+  auto pressure_ring = SlabRing<std::complex<double>>(ring_depth, pressure_slab);
+  auto potential_ring = SlabRing<double>(ring_depth, potential_slab);
+  auto force_x_slab = std::vector<double>(force_slab);
+  auto force_y_slab = std::vector<double>(force_slab);
+  auto force_z_slab = std::vector<double>(force_slab);
+  const auto intensity = execution_parameter.export_intensity;
+  auto pressure_squared_slab = std::vector<double>(intensity ? potential_slab : 0);
+  auto gradient_squared_slab = std::vector<double>(intensity ? potential_slab : 0);
+
+  auto planner = MemoryPlanner();
+  const auto streaming_stage = planner.add_stage("streaming");
+  planner.add_buffer("pressure ring",
+                     pressure_ring.size() * sizeof(std::complex<double>),
+                     streaming_stage, streaming_stage, []() {});
+  planner.add_buffer("potential ring", potential_ring.size() * sizeof(double),
+                     streaming_stage, streaming_stage, []() {});
+  planner.add_buffer("force slabs", 3 * force_slab * sizeof(double), streaming_stage,
+                     streaming_stage, []() {});
+  if (intensity) {
+    planner.add_buffer("intensity slabs", 2 * potential_slab * sizeof(double),
+                       streaming_stage, streaming_stage, []() {});
+  }
+
+  result_log->log(fmt::format(FMT_STRING("Predicted peak memory: {:s} ({:s} stage)"),
+                              format_bytes(planner.predicted_peak_bytes()),
+                              planner.predicted_peak_stage()));
+
+  // Fields are handed to the sink one slab at a time as soon as a slab is done
+  const auto streamed_field = [&](std::string name, std::string dtype,
+                                  std::size_t cell_bytes,
+                                  const CellBlockInterpolation& blk) {
+    auto field =
+        make_field_descriptor(std::move(name), std::move(dtype), cell_bytes, blk);
+    field.streamed = true;
+    return sink.begin_field(field);
+  };
+  const auto pressure_field = streamed_field(
+      "pressure", "complex128", sizeof(std::complex<double>), grid.pressure);
+  const auto potential_field =
+      streamed_field("potential", "float64", sizeof(double), grid.potential);
+  const auto force_x_field =
+      streamed_field("force_x", "float64", sizeof(double), grid.force);
+  const auto force_y_field =
+      streamed_field("force_y", "float64", sizeof(double), grid.force);
+  const auto force_z_field =
+      streamed_field("force_z", "float64", sizeof(double), grid.force);
+  auto intensity_fields = std::optional<std::array<std::size_t, 2>>();
+  if (intensity) {
+    intensity_fields = std::array{
+        streamed_field("pressure_squared", "float64", sizeof(double), grid.potential),
+        streamed_field("pressure_gradient_squared", "float64", sizeof(double),
+                       grid.potential)};
+  }
+
+  // constant used for potential computation
+  const auto k1 = simulation_parameter.constant_k1();
+  const auto k2 = simulation_parameter.constant_k2();
+
+  const auto strategy = choose_pressure_strategy(pressure_slab, transducers.size());
+  result_log->log(
+      fmt::format(FMT_STRING("Streaming {:d} slabs, pressure evaluation: {:s}"),
+                  pressure_cnt.x, to_string(strategy)));
+
+  // Pressure takes a unit of work per cell and transducer, other stages one per cell
+  control->add_work(grid.pressure.get_cell_count() * transducers.size() +
+                    grid.potential.get_cell_count() + grid.force.get_cell_count());
+
+  planner.begin_stage(streaming_stage);
+
+  // Pressure slab x is followed by potential slab x - 2p and force slab x - 4p, as
+  // those are the newest slabs whose whole stencil is available
+  for (std::size_t pressure_x = 0; pressure_x < pressure_cnt.x; ++pressure_x) {
+    auto* pressure_out = pressure_ring.slab(pressure_x);
+    const auto pressure_offset = grid.pressure.get_id({pressure_x, 0, 0});
+
+    evaluate_pressure(
+        control, std::span(pressure_out, pressure_slab),
+        [&](std::size_t yz) {
+          return grid.pressure.get_real_vec(pressure_offset + yz);
+        },
+        transducers, simulation_parameter, strategy);
+    sink.write_slab(pressure_field, pressure_x,
+                    std::as_bytes(std::span(pressure_out, pressure_slab)));
+
+    if (pressure_x < 2 * padding) {
+      continue;
+    }
+    const auto potential_x = pressure_x - 2 * padding;
+    auto* potential_out = potential_ring.slab(potential_x);
+
+    parallel_for(control, potential_slab, 1, [&](std::size_t yz) {
+      const auto y = yz / potential_cnt.z + padding;
+      const auto z = yz % potential_cnt.z + padding;
+      const auto mid = y * pressure_cnt.z + z;
+      const auto* pressure_mid = pressure_ring.slab(potential_x + padding);
+
+      const auto [pressure_squared, gradient_squared] = compute_intensity(
+          pressure_mid[mid],
+          [&](std::size_t axis, std::size_t k) {
+            if (axis == 0) {
+              return pressure_ring.slab(potential_x + padding + k)[mid] -
+                     pressure_ring.slab(potential_x + padding - k)[mid];
+            }
+            const auto offset = axis == 1 ? k * pressure_cnt.z : k;
+            return pressure_mid[mid + offset] - pressure_mid[mid - offset];
+          },
+          coefficients, simulation_parameter.cell_size);
+      potential_out[yz] = combine_potential(pressure_squared, gradient_squared, k1, k2);
+      if (intensity) {
+        pressure_squared_slab[yz] = pressure_squared;
+        gradient_squared_slab[yz] = gradient_squared;
+      }
+    });
+    sink.write_slab(potential_field, potential_x,
+                    std::as_bytes(std::span(potential_out, potential_slab)));
+    if (intensity_fields) {
+      sink.write_slab((*intensity_fields)[0], potential_x,
+                      std::as_bytes(std::span(pressure_squared_slab)));
+      sink.write_slab((*intensity_fields)[1], potential_x,
+                      std::as_bytes(std::span(gradient_squared_slab)));
+    }
+
+    if (potential_x < 2 * padding) {
+      continue;
+    }
+    const auto force_x = potential_x - 2 * padding;
+
+    parallel_for(control, force_slab, 1, [&](std::size_t yz) {
+      const auto y = yz / force_cnt.z + padding;
+      const auto z = yz % force_cnt.z + padding;
+      const auto mid = y * potential_cnt.z + z;
+      const auto* potential_mid = potential_ring.slab(force_x + padding);
+
+      const auto f = compute_force(
+          [&](std::size_t axis, std::size_t k) {
+            if (axis == 0) {
+              return potential_ring.slab(force_x + padding + k)[mid] -
+                     potential_ring.slab(force_x + padding - k)[mid];
+            }
+            const auto offset = axis == 1 ? k * potential_cnt.z : k;
+            return potential_mid[mid + offset] - potential_mid[mid - offset];
+          },
+          coefficients, simulation_parameter.cell_size);
+
+      force_x_slab[yz] = f[0];
+      force_y_slab[yz] = f[1];
+      force_z_slab[yz] = f[2];
+    });
+    sink.write_slab(force_x_field, force_x, std::as_bytes(std::span(force_x_slab)));
+    sink.write_slab(force_y_field, force_x, std::as_bytes(std::span(force_y_slab)));
+    sink.write_slab(force_z_field, force_x, std::as_bytes(std::span(force_z_slab)));
+  }
+
+  planner.finish_stage(streaming_stage);
+
+  result_log->log(fmt::format(
+      FMT_STRING("Peak memory: predicted {:s}, tracked {:s}, measured {:s}"),
+      format_bytes(planner.predicted_peak_bytes()),
+      format_bytes(planner.tracked_peak()), planner.format_measured_peak()));
+}
+
+}  // namespace Computation
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <span>
+
+namespace Computation {
+
+// Central difference coefficients of the first derivative for offsets 1..n, the
+// coefficient of offset -k is the negation of the coefficient of offset k
+constexpr auto central_difference_2 = std::array<double, 1>{1.0 / 2.0};
+constexpr auto central_difference_4 = std::array<double, 2>{2.0 / 3.0, -1.0 / 12.0};
+constexpr auto central_difference_6 =
+    std::array<double, 3>{3.0 / 4.0, -3.0 / 20.0, 1.0 / 60.0};
+
+// Return coefficients for a supported accuracy order (2, 4 or 6), empty otherwise
+[[nodiscard]] constexpr std::span<const double> central_difference_coefficients(
+    int order) {
+  switch (order) {
+    case 2:
+      return central_difference_2;
+    case 4:
+      return central_difference_4;
+    case 6:
+      return central_difference_6;
+    default:
+      return {};
+  }
+}
+
+// Central difference coefficients of the second derivative for offsets 0..n, the
+// coefficient of offset -k equals the coefficient of offset k
+constexpr auto second_difference_2 = std::array<double, 2>{-2.0, 1.0};
+constexpr auto second_difference_4 =
+    std::array<double, 3>{-5.0 / 2.0, 4.0 / 3.0, -1.0 / 12.0};
+constexpr auto second_difference_6 =
+    std::array<double, 4>{-49.0 / 18.0, 3.0 / 2.0, -3.0 / 20.0, 1.0 / 90.0};
+
+// Return second derivative coefficients for a supported accuracy order (2, 4 or
+// 6), empty otherwise. They reach as far as those of the first derivative
+[[nodiscard]] constexpr std::span<const double> second_difference_coefficients(
+    int order) {
+  switch (order) {
+    case 2:
+      return second_difference_2;
+    case 4:
+      return second_difference_4;
+    case 6:
+      return second_difference_6;
+    default:
+      return {};
+  }
+}
+
+// Return first derivative from a central difference stencil
+// `difference(k)` must return value at offset +k minus value at offset -k
+template <typename Difference>
+[[nodiscard]] constexpr auto central_difference(const Difference& difference,
+                                                std::span<const double> coefficients,
+                                                double dist) {
+  auto result = difference(std::size_t(1)) * coefficients[0];
+  for (std::size_t k = 1; k < coefficients.size(); ++k) {
+    result += difference(k + 1) * coefficients[k];
+  }
+  return result / dist;
+}
+
+// Return second derivative from a central difference stencil
+// `sum(k)` must return value at offset +k plus value at offset -k
+template <typename Sum, typename T>
+[[nodiscard]] constexpr auto central_second_difference(
+    const T& center,
+    const Sum& sum,
+    std::span<const double> coefficients,
+    double dist) {
+  auto result = center * coefficients[0];
+  for (std::size_t k = 1; k < coefficients.size(); ++k) {
+    result += sum(k) * coefficients[k];
+  }
+  return result / (dist * dist);
+}
+
+}  // namespace Computation
@@ -0,0 +1,500 @@
+#include <fmt/format.h>
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "BlockStorage.h"
+#include "Kernels.h"
+#include "MemoryPlanner.h"
+#include "PressureEvaluation.h"
+#include "Processes.h"
+
+namespace Computation {
+
+namespace {
+
+struct DerivedFields {
+  CellBlock<double> potential;
+  std::array<CellBlock<double>, 3> force;
+};
+
+// Compute potential and force from pressure, a unit of work per cell. Potential is
+// combined from |p|^2 and |grad p|^2 if given, otherwise differentiated from pressure
+DerivedFields derive_fields(RunControl* control,
+                            const SimulationGrid& grid,
+                            const Config::SimulationParameter& simulation_parameter,
+                            CellBlock<std::complex<double>>& pressure,
+                            const CellBlock<double>* pressure_squared,
+                            const CellBlock<double>* gradient_squared) {
+  const auto& force_blk = grid.force;
+  const auto& potential_blk = grid.potential;
+  const auto& pressure_blk = grid.pressure;
+  const auto padding = grid.padding;
+  const auto coefficients =
+      central_difference_coefficients(simulation_parameter.differentiation_order);
+  const auto k1 = simulation_parameter.constant_k1();
+  const auto k2 = simulation_parameter.constant_k2();
+
+  auto result = DerivedFields{CellBlock<double>(potential_blk.get_dimension_size()),
+                              {CellBlock<double>(force_blk.get_dimension_size()),
+                               CellBlock<double>(force_blk.get_dimension_size()),
+                               CellBlock<double>(force_blk.get_dimension_size())}};
+  auto& potential = result.potential;
+  parallel_for(control, potential_blk.get_cell_count(), 1, [&](std::size_t id) {
+    if (pressure_squared != nullptr) {
+      potential.set_cell(id, combine_potential(pressure_squared->get_cell(id),
+                                               gradient_squared->get_cell(id), k1, k2));
+      return;
+    }
+    const auto mid = pressure_blk.get_id(potential_blk.get_int_vec(id) + padding);
+    potential.set_cell(
+        id, compute_potential(
+                pressure.get_cell(mid),
+                [&](std::size_t axis, std::size_t k) {
+                  const auto offset = k * pressure_blk.get_stride(axis);
+                  return pressure.get_cell(mid + offset) -
+                         pressure.get_cell(mid - offset);
+                },
+                coefficients, simulation_parameter.cell_size, k1, k2));
+  });
+
+  parallel_for(control, force_blk.get_cell_count(), 1, [&](std::size_t id) {
+    const auto mid = potential_blk.get_id(force_blk.get_int_vec(id) + padding);
+    const auto f = compute_force(
+        [&](std::size_t axis, std::size_t k) {
+          const auto offset = k * potential_blk.get_stride(axis);
+          return potential.get_cell(mid + offset) - potential.get_cell(mid - offset);
+        },
+        coefficients, simulation_parameter.cell_size);
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      result.force[axis].set_cell(id, f[axis]);
+    }
+  });
+  return result;
+}
+
+}  // namespace
+
+void sweepProcess(AtomicLogger::AtomicLogger* result_log,
+                  RunControl* control,
+                  const std::vector<Config::Transducer>& transducers,
+                  const Config::SimulationParameter& simulation_parameter,
+                  const Config::ExecutionParameter& execution_parameter,
+                  const SimulationGrid& grid,
+                  std::span<const std::unique_ptr<ResultSink>> sinks) {
+  using Kind = Config::SweepParameter::Kind;
+  const auto& sweep = execution_parameter.sweep;
+  const auto& force_blk = grid.force;
+  const auto& potential_blk = grid.potential;
+  const auto& pressure_blk = grid.pressure;
+  const auto pressure_cnt = pressure_blk.get_cell_count();
+  const auto padding = grid.padding;
+  const auto coefficients =
+      central_difference_coefficients(simulation_parameter.differentiation_order);
+
+  // Transducers and parameters of every point
+  const auto values = sweep.points();
+  auto point_transducers = std::vector<std::vector<Config::Transducer>>();
+  auto point_parameters = std::vector<Config::SimulationParameter>();
+  for (const auto value : values) {
+    point_transducers.push_back(transducers);
+    point_parameters.push_back(simulation_parameter);
+    sweep.apply(value, point_transducers.back(), point_parameters.back());
+  }
+
+  // Every sink gets the fields of a resident run
+  struct PointFields {
+    std::size_t pressure;
+    std::size_t potential;
+    std::array<std::size_t, 3> force;
+  };
+  auto fields = std::vector<PointFields>();
+  for (const auto& sink : sinks) {
+    fields.push_back(
+        {sink->begin_field(make_field_descriptor(
+             "pressure", "complex128", sizeof(std::complex<double>), pressure_blk)),
+         sink->begin_field(make_field_descriptor("potential", "float64", sizeof(double),
+                                                 potential_blk)),
+         {sink->begin_field(
+              make_field_descriptor("force_x", "float64", sizeof(double), force_blk)),
+          sink->begin_field(
+              make_field_descriptor("force_y", "float64", sizeof(double), force_blk)),
+          sink->begin_field(make_field_descriptor("force_z", "float64", sizeof(double),
+                                                  force_blk))}});
+  }
+
+  // Particle radius only changes the constants combining |p|^2 and |grad p|^2, so
+  // pressure and both of them are computed once for every point. Phase of one
+  // transducer only rotates its share of pressure, so the share of the others and
+  // its own are computed once. Frequency and spacing change every pressure, which
+  // is computed for a batch of points at once so cell positions, and for
+  // frequency the geometry of each transducer, are shared
+  const auto pressure_bytes =
+      pressure_blk.get_cell_count() * sizeof(std::complex<double>);
+  const auto batch = sweep.kind == Kind::Frequency or sweep.kind == Kind::ArraySpacing
+                         ? std::min(execution_parameter.sweep_batch, values.size())
+                         : std::size_t(1);
+  // Stages repeat for every batch, so the planner only predicts their peak
+  auto planner = MemoryPlanner();
+  const auto shared_stage = planner.add_stage("shared");
+  const auto pressure_stage = planner.add_stage("pressure");
+  const auto point_stage = planner.add_stage("points");
+  if (sweep.kind == Kind::ParticleRadius) {
+    planner.add_buffer("pressure", pressure_bytes, shared_stage, point_stage, []() {});
+    planner.add_buffer("intensity", 2 * potential_blk.get_cell_count() * sizeof(double),
+                       shared_stage, point_stage, []() {});
+  } else {
+    planner.add_buffer("positions",
+                       pressure_blk.get_cell_count() * sizeof(Vec3<double>),
+                       shared_stage, point_stage, []() {});
+    if (sweep.kind == Kind::TransducerPhase) {
+      planner.add_buffer("transducer shares", 2 * pressure_bytes, shared_stage,
+                         point_stage, []() {});
+    }
+    planner.add_buffer("pressure batch", batch * pressure_bytes, pressure_stage,
+                       point_stage, []() {});
+  }
+  planner.add_buffer("potential and force",
+                     (potential_blk.get_cell_count() + 3 * force_blk.get_cell_count()) *
+                         sizeof(double),
+                     point_stage, point_stage, []() {});
+
+  result_log->log(fmt::format(
+      FMT_STRING("Sweep of {:d} points over {:s}, {:d} pressure fields per pass"),
+      values.size(),
+      JSONConvert::from_sweep_parameter(sweep)["parameter"].get<std::string>(), batch));
+  result_log->log(fmt::format(FMT_STRING("Predicted peak memory: {:s} ({:s} stage)"),
+                              format_bytes(planner.predicted_peak_bytes()),
+                              planner.predicted_peak_stage()));
+
+  // Pressure takes a unit of work per cell and transducer, everything else one per
+  // cell, shared work is done once
+  const auto pressure_work = pressure_cnt * transducers.size();
+  auto work =
+      values.size() * (potential_blk.get_cell_count() + force_blk.get_cell_count());
+  if (sweep.kind == Kind::ParticleRadius) {
+    work += pressure_work + potential_blk.get_cell_count();
+  } else if (sweep.kind == Kind::TransducerPhase) {
+    work += pressure_cnt + pressure_work + values.size() * pressure_cnt;
+  } else {
+    work += pressure_cnt + values.size() * pressure_work;
+  }
+  control->add_work(work);
+
+  // Compute potential and force of a point and write all its fields
+  const auto finish_point = [&](std::size_t index,
+                                CellBlock<std::complex<double>>& pressure,
+                                const CellBlock<double>* pressure_squared,
+                                const CellBlock<double>* gradient_squared) {
+    auto& sink = *sinks[index];
+    result_log->log(fmt::format(FMT_STRING("Computing sweep point {:d} ({:g})"), index,
+                                values[index]));
+    auto derived = derive_fields(control, grid, point_parameters[index], pressure,
+                                 pressure_squared, gradient_squared);
+    sink.write_field(fields[index].pressure, std::as_bytes(pressure.cells()));
+    sink.write_field(fields[index].potential, std::as_bytes(derived.potential.cells()));
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      sink.write_field(fields[index].force[axis],
+                       std::as_bytes(derived.force[axis].cells()));
+    }
+  };
+
+  if (sweep.kind == Kind::ParticleRadius) {
+    result_log->log("Computing shared pressure and intensity");
+    auto pressure = CellBlock<std::complex<double>>(pressure_blk.get_dimension_size());
+    const auto strategy =
+        choose_pressure_strategy(pressure_blk.get_cell_count(), transducers.size());
+    evaluate_pressure(
+        control, pressure.cells(),
+        [&](std::size_t id) { return pressure_blk.get_real_vec(id); }, transducers,
+        simulation_parameter, strategy);
+
+    auto pressure_squared = CellBlock<double>(potential_blk.get_dimension_size());
+    auto gradient_squared = CellBlock<double>(potential_blk.get_dimension_size());
+    parallel_for(control, potential_blk.get_cell_count(), 1, [&](std::size_t id) {
+      const auto mid = pressure_blk.get_id(potential_blk.get_int_vec(id) + padding);
+      const auto [p_squared, grad_squared] = compute_intensity(
+          pressure.get_cell(mid),
+          [&](std::size_t axis, std::size_t k) {
+            const auto offset = k * pressure_blk.get_stride(axis);
+            return pressure.get_cell(mid + offset) - pressure.get_cell(mid - offset);
+          },
+          coefficients, simulation_parameter.cell_size);
+      pressure_squared.set_cell(id, p_squared);
+      gradient_squared.set_cell(id, grad_squared);
+    });
+
+    for (std::size_t index = 0; index < values.size(); ++index) {
+      finish_point(index, pressure, &pressure_squared, &gradient_squared);
+    }
+  } else {
+    result_log->log("Computing shared cell positions");
+    auto positions = std::vector<Vec3<double>>(pressure_cnt);
+    parallel_for(control, pressure_cnt, 1, [&](std::size_t id) {
+      positions[id] = pressure_blk.get_real_vec(id);
+    });
+
+    // Share of the swept transducer with zero phase, and of every other one
+    auto swept_share = std::optional<CellBlock<std::complex<double>>>();
+    auto other_share = std::optional<CellBlock<std::complex<double>>>();
+    if (sweep.kind == Kind::TransducerPhase) {
+      result_log->log("Computing shared transducer shares");
+      auto swept_transducer = transducers;
+      auto swept_parameter = simulation_parameter;
+      sweep.apply(0.0, swept_transducer, swept_parameter);
+      const auto swept = std::size_t(
+          std::find_if(swept_transducer.begin(), swept_transducer.end(),
+                       [&](const Config::Transducer& transducer) {
+                         return transducer.id == sweep.transducer;
+                       }) -
+          swept_transducer.begin());
+      const auto k = wave_number(simulation_parameter);
+      swept_share.emplace(pressure_blk.get_dimension_size());
+      other_share.emplace(pressure_blk.get_dimension_size());
+      parallel_for(control, pressure_cnt, transducers.size(), [&](std::size_t id) {
+        auto others = std::complex<double>();
+        for (std::size_t t = 0; t < swept_transducer.size(); ++t) {
+          const auto share = compute_pressure(
+              pressure_geometry(positions[id], swept_transducer[t]),
+              swept_transducer[t], k);
+          if (t == swept) {
+            swept_share->set_cell(id, share);
+          } else {
+            others += share;
+          }
+        }
+        other_share->set_cell(id, others);
+      });
+    }
+
+    for (std::size_t first = 0; first < values.size(); first += batch) {
+      const auto last = std::min(first + batch, values.size());
+      auto pressures = std::vector<CellBlock<std::complex<double>>>();
+      for (auto index = first; index < last; ++index) {
+        pressures.emplace_back(pressure_blk.get_dimension_size());
+      }
+
+      if (sweep.kind == Kind::TransducerPhase) {
+        const auto rotation = std::exp(i * values[first]);
+        parallel_for(control, pressure_cnt, 1, [&](std::size_t id) {
+          pressures[0].set_cell(
+              id, other_share->get_cell(id) + rotation * swept_share->get_cell(id));
+        });
+      } else if (sweep.kind == Kind::Frequency) {
+        result_log->log(fmt::format(
+            FMT_STRING("Computing pressure of sweep points {:d} to {:d}"), first,
+            last - 1));
+        auto wave_numbers = std::vector<double>();
+        auto results = std::vector<std::span<std::complex<double>>>();
+        for (auto index = first; index < last; ++index) {
+          wave_numbers.push_back(wave_number(point_parameters[index]));
+          results.push_back(pressures[index - first].cells());
+        }
+        evaluate_pressure(
+            control, std::span<const std::span<std::complex<double>>>(results),
+            [&](std::size_t id) { return positions[id]; }, transducers, wave_numbers);
+      } else {
+        result_log->log(fmt::format(
+            FMT_STRING("Computing pressure of sweep points {:d} to {:d}"), first,
+            last - 1));
+        const auto k = wave_number(simulation_parameter);
+        const auto batch_work = (last - first) * transducers.size();
+        parallel_for(control, pressure_cnt, batch_work, [&](std::size_t id) {
+          for (auto index = first; index < last; ++index) {
+            auto sum = std::complex<double>();
+            for (const auto& transducer : point_transducers[index]) {
+              sum += compute_pressure(pressure_geometry(positions[id], transducer),
+                                      transducer, k);
+            }
+            pressures[index - first].set_cell(id, sum);
+          }
+        });
+      }
+
+      for (auto index = first; index < last; ++index) {
+        finish_point(index, pressures[index - first], nullptr, nullptr);
+      }
+    }
+  }
+
+  result_log->log(
+      fmt::format(FMT_STRING("Peak memory: predicted {:s}, measured {:s}"),
+                  format_bytes(planner.predicted_peak_bytes()),
+                  planner.format_measured_peak()));
+}
+
+void multiFrequencyProcess(AtomicLogger::AtomicLogger* result_log,
+                           RunControl* control,
+                           const std::vector<Config::Transducer>& transducers,
+                           const Config::SimulationParameter& simulation_parameter,
+                           const Config::ExecutionParameter& execution_parameter,
+                           const SimulationGrid& grid,
+                           ResultSink& sink) {
+  const auto& frequencies = simulation_parameter.frequencies;
+  const auto& force_blk = grid.force;
+  const auto& potential_blk = grid.potential;
+  const auto& pressure_blk = grid.pressure;
+  const auto sum = execution_parameter.incoherent_sum;
+
+  // Fields of frequency k are suffixed with k and carry it as an attribute
+  const auto field = [&](std::string name, std::string dtype, std::size_t cell_bytes,
+                         const CellBlockInterpolation& blk,
+                         nlohmann::json attributes) {
+    auto descriptor = make_field_descriptor(std::move(name), std::move(dtype),
+                                            cell_bytes, blk);
+    descriptor.attributes = std::move(attributes);
+    return sink.begin_field(descriptor);
+  };
+  struct FrequencyFields {
+    std::size_t pressure;
+    std::size_t potential;
+    std::array<std::size_t, 3> force;
+  };
+  auto fields = std::vector<FrequencyFields>();
+  for (std::size_t k = 0; k < frequencies.size(); ++k) {
+    const auto attributes = nlohmann::json{{"frequency", frequencies[k]}};
+    auto frequency_fields = FrequencyFields();
+    frequency_fields.pressure =
+        field(fmt::format(FMT_STRING("pressure_{:d}"), k), "complex128",
+              sizeof(std::complex<double>), pressure_blk, attributes);
+    frequency_fields.potential =
+        field(fmt::format(FMT_STRING("potential_{:d}"), k), "float64", sizeof(double),
+              potential_blk, attributes);
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      frequency_fields.force[axis] =
+          field(fmt::format(FMT_STRING("force_{:d}_{:c}"), k, "xyz"[axis]), "float64",
+                sizeof(double), force_blk, attributes);
+    }
+    fields.push_back(frequency_fields);
+  }
+  const auto sum_attributes = nlohmann::json{{"frequencies", frequencies}};
+  auto sum_fields = std::optional<FrequencyFields>();
+  if (sum) {
+    sum_fields = FrequencyFields{
+        field("pressure_squared_sum", "float64", sizeof(double), pressure_blk,
+              sum_attributes),
+        field("potential_sum", "float64", sizeof(double), potential_blk,
+              sum_attributes),
+        {field("force_sum_x", "float64", sizeof(double), force_blk, sum_attributes),
+         field("force_sum_y", "float64", sizeof(double), force_blk, sum_attributes),
+         field("force_sum_z", "float64", sizeof(double), force_blk, sum_attributes)}};
+  }
+
+  auto planner = MemoryPlanner();
+  const auto pressure_stage = planner.add_stage("pressure");
+  const auto frequency_stage = planner.add_stage("frequencies");
+  planner.add_buffer(
+      "pressure",
+      frequencies.size() * pressure_blk.get_cell_count() * sizeof(std::complex<double>),
+      pressure_stage, frequency_stage, []() {});
+  planner.add_buffer("potential and force",
+                     (potential_blk.get_cell_count() + 3 * force_blk.get_cell_count()) *
+                         sizeof(double),
+                     frequency_stage, frequency_stage, []() {});
+  if (sum) {
+    planner.add_buffer("sums",
+                       (pressure_blk.get_cell_count() + potential_blk.get_cell_count() +
+                        3 * force_blk.get_cell_count()) *
+                           sizeof(double),
+                       pressure_stage, frequency_stage, []() {});
+  }
+  result_log->log(fmt::format(FMT_STRING("Predicted peak memory: {:s} ({:s} stage)"),
+                              format_bytes(planner.predicted_peak_bytes()),
+                              planner.predicted_peak_stage()));
+
+  // Pressure takes a unit of work per cell, transducer and frequency, everything
+  // else one per cell and frequency
+  const auto cell_work = pressure_blk.get_cell_count() * transducers.size() +
+                         potential_blk.get_cell_count() + force_blk.get_cell_count();
+  const auto sum_work = pressure_blk.get_cell_count() + potential_blk.get_cell_count() +
+                        force_blk.get_cell_count();
+  control->add_work(frequencies.size() * (cell_work + (sum ? sum_work : 0)));
+
+  // Every frequency is evaluated in one pass over cells and transducers
+  result_log->log(fmt::format(FMT_STRING("Computing pressure of {:d} frequencies"),
+                              frequencies.size()));
+  planner.begin_stage(pressure_stage);
+  auto frequency_parameters = std::vector<Config::SimulationParameter>();
+  auto wave_numbers = std::vector<double>();
+  auto pressures = std::vector<CellBlock<std::complex<double>>>();
+  auto results = std::vector<std::span<std::complex<double>>>();
+  for (const auto frequency : frequencies) {
+    auto frequency_parameter = simulation_parameter;
+    frequency_parameter.frequency = frequency;
+    frequency_parameters.push_back(frequency_parameter);
+    wave_numbers.push_back(wave_number(frequency_parameter));
+    pressures.emplace_back(pressure_blk.get_dimension_size());
+  }
+  for (auto& pressure : pressures) {
+    results.push_back(pressure.cells());
+  }
+  evaluate_pressure(control, std::span<const std::span<std::complex<double>>>(results),
+                    [&](std::size_t id) { return pressure_blk.get_real_vec(id); },
+                    transducers, wave_numbers);
+
+  auto pressure_squared_sum = std::optional<CellBlock<double>>();
+  auto potential_sum = std::optional<CellBlock<double>>();
+  auto force_sum = std::vector<CellBlock<double>>();
+  if (sum) {
+    pressure_squared_sum.emplace(pressure_blk.get_dimension_size());
+    potential_sum.emplace(potential_blk.get_dimension_size());
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      force_sum.emplace_back(force_blk.get_dimension_size());
+    }
+  }
+  planner.finish_stage(pressure_stage);
+
+  planner.begin_stage(frequency_stage);
+  for (std::size_t k = 0; k < frequencies.size(); ++k) {
+    result_log->log(fmt::format(FMT_STRING("Computing frequency {:d} ({:g} Hz)"), k,
+                                frequencies[k]));
+    auto& pressure = pressures[k];
+    auto derived = derive_fields(control, grid, frequency_parameters[k], pressure,
+                                 nullptr, nullptr);
+
+    if (sum) {
+      parallel_for(control, pressure_blk.get_cell_count(), 1, [&](std::size_t id) {
+        pressure_squared_sum->set_cell(
+            id, pressure_squared_sum->get_cell(id) +
+                    euclidean_norm_squared(pressure.get_cell(id)));
+      });
+      parallel_for(control, potential_blk.get_cell_count(), 1, [&](std::size_t id) {
+        potential_sum->set_cell(
+            id, potential_sum->get_cell(id) + derived.potential.get_cell(id));
+      });
+      parallel_for(control, force_blk.get_cell_count(), 1, [&](std::size_t id) {
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+          force_sum[axis].set_cell(
+              id, force_sum[axis].get_cell(id) + derived.force[axis].get_cell(id));
+        }
+      });
+    }
+
+    sink.write_field(fields[k].pressure, std::as_bytes(pressure.cells()));
+    sink.write_field(fields[k].potential, std::as_bytes(derived.potential.cells()));
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      sink.write_field(fields[k].force[axis],
+                       std::as_bytes(derived.force[axis].cells()));
+    }
+  }
+
+  if (sum) {
+    result_log->log("Exporting incoherent sums");
+    sink.write_field(sum_fields->pressure,
+                     std::as_bytes(pressure_squared_sum->cells()));
+    sink.write_field(sum_fields->potential, std::as_bytes(potential_sum->cells()));
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      sink.write_field(sum_fields->force[axis], std::as_bytes(force_sum[axis].cells()));
+    }
+  }
+  planner.finish_stage(frequency_stage);
+
+  result_log->log(fmt::format(
+      FMT_STRING("Peak memory: predicted {:s}, tracked {:s}, measured {:s}"),
+      format_bytes(planner.predicted_peak_bytes()),
+      format_bytes(planner.tracked_peak()), planner.format_measured_peak()));
+}
+
+}  // namespace Computation
@@ -0,0 +1,261 @@
+#include <fmt/format.h>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include "Kernels.h"
+#include "PressureEvaluation.h"
+#include "Processes.h"
+
+namespace Computation {
+
+namespace {
+
+using LatticeOffset = std::array<std::int64_t, 3>;
+
+// Offsets (in cells) of every sample needed to compute force at one point: force
+// reads potential on a star of `padding` cells along each axis, and each of those
+// potentials reads pressure on a star around itself
+class PointStencil {
+  std::size_t padding;
+  std::vector<LatticeOffset> star_offsets;
+  std::vector<LatticeOffset> pressure_offsets;
+  std::map<LatticeOffset, std::size_t> pressure_index;
+
+  [[nodiscard]] static LatticeOffset add(LatticeOffset a, const LatticeOffset& b) {
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      a[axis] += b[axis];
+    }
+    return a;
+  }
+
+  [[nodiscard]] static LatticeOffset axis_offset(std::size_t axis, std::int64_t k) {
+    auto result = LatticeOffset{0, 0, 0};
+    result[axis] = k;
+    return result;
+  }
+
+ public:
+  explicit PointStencil(std::size_t padding) : padding(padding) {
+    // star index 0 is the point itself, followed by -k and +k for each axis
+    star_offsets.push_back({0, 0, 0});
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      for (std::size_t k = 1; k <= padding; ++k) {
+        star_offsets.push_back(axis_offset(axis, -std::int64_t(k)));
+        star_offsets.push_back(axis_offset(axis, std::int64_t(k)));
+      }
+    }
+
+    for (const auto& a : star_offsets) {
+      for (const auto& b : star_offsets) {
+        const auto offset = add(a, b);
+        if (pressure_index.try_emplace(offset, pressure_offsets.size()).second) {
+          pressure_offsets.push_back(offset);
+        }
+      }
+    }
+  }
+
+  [[nodiscard]] const std::vector<LatticeOffset>& pressure_samples() const {
+    return pressure_offsets;
+  }
+  [[nodiscard]] std::size_t star_size() const { return star_offsets.size(); }
+
+  // Index of the star point at offset +k or -k along axis
+  [[nodiscard]] std::size_t star_index(std::size_t axis,
+                                       std::size_t k,
+                                       bool positive) const {
+    return 1 + 2 * (axis * padding + k - 1) + (positive ? 1 : 0);
+  }
+
+  // Index of the pressure sample at star point `star` moved by `k` along axis
+  [[nodiscard]] std::size_t pressure_sample(std::size_t star,
+                                            std::size_t axis,
+                                            std::int64_t k) const {
+    return pressure_index.at(add(star_offsets[star], axis_offset(axis, k)));
+  }
+};
+
+// Segments of `length` split into steps of at most `spacing`. Ratios within rounding
+// of an integer take exactly that many steps, so samples of segments spanning whole
+// multiples of the spacing stay on its lattice
+std::size_t polyline_steps(double length, double spacing) {
+  const auto ratio = length / spacing;
+  const auto nearest = std::round(ratio);
+  const auto steps = std::abs(ratio - nearest) <= 1e-9 * std::max(nearest, 1.0)
+                         ? nearest
+                         : std::ceil(ratio);
+  return std::max(std::size_t(1), std::size_t(steps));
+}
+
+}  // namespace
+
+std::vector<Vec3<double>> sample_target_points(const Config::EvaluationTarget& target) {
+  auto result = std::vector<Vec3<double>>();
+
+  switch (target.kind) {
+    case Config::EvaluationTarget::Kind::Plane: {
+      const auto step = [](std::size_t idx, std::size_t count) {
+        return count > 1 ? double(idx) / double(count - 1) : 0.0;
+      };
+      for (std::size_t u = 0; u < target.count_u; ++u) {
+        for (std::size_t v = 0; v < target.count_v; ++v) {
+          result.push_back(target.origin + target.axis_u * step(u, target.count_u) +
+                           target.axis_v * step(v, target.count_v));
+        }
+      }
+      break;
+    }
+    case Config::EvaluationTarget::Kind::Polyline: {
+      for (std::size_t vertex = 0; vertex + 1 < target.vertices.size(); ++vertex) {
+        const auto& a = target.vertices[vertex];
+        const auto& b = target.vertices[vertex + 1];
+        const auto steps = polyline_steps(a.euclidean_distance(b), target.spacing);
+        for (std::size_t t = 0; t < steps; ++t) {
+          result.push_back(a + (b - a) * (double(t) / double(steps)));
+        }
+      }
+      result.push_back(target.vertices.back());
+      break;
+    }
+    case Config::EvaluationTarget::Kind::PointCloud: {
+      auto point_import = std::ifstream(target.point_file,
+                                        std::fstream::in | std::fstream::binary |
+                                            std::fstream::ate);
+      if (not point_import) {
+        throw std::runtime_error("Unable to open point cloud file: " +
+                                 target.point_file);
+      }
+      const auto bytes = std::size_t(point_import.tellg());
+      if (bytes % (3 * sizeof(double)) != 0) {
+        throw std::runtime_error("Point cloud file is not a list of xyz doubles: " +
+                                 target.point_file);
+      }
+      result.resize(bytes / (3 * sizeof(double)));
+      point_import.seekg(0);
+      for (auto& point : result) {
+        auto xyz = std::array<double, 3>();
+        point_import.read(reinterpret_cast<char*>(xyz.data()), sizeof(xyz));
+        point = Vec3<double>{xyz[0], xyz[1], xyz[2]};
+      }
+      break;
+    }
+  }
+
+  return result;
+}
+
+nlohmann::json targetProcess(AtomicLogger::AtomicLogger* result_log,
+                             RunControl* control,
+                             const std::vector<Config::Transducer>& transducers,
+                             const Config::SimulationParameter& simulation_parameter,
+                             const Config::ExecutionParameter& execution_parameter,
+                             ResultSink& sink) {
+  const auto stencil = PointStencil(simulation_parameter.stencil_padding());
+  const auto& pressure_samples = stencil.pressure_samples();
+  const auto sample_cnt = pressure_samples.size();
+  const auto star_cnt = stencil.star_size();
+  const auto coefficients =
+      central_difference_coefficients(simulation_parameter.differentiation_order);
+  const auto cell_size = simulation_parameter.cell_size;
+
+  // constant used for potential computation
+  const auto k1 = simulation_parameter.constant_k1();
+  const auto k2 = simulation_parameter.constant_k2();
+
+  auto metadata = nlohmann::json::array();
+
+  for (const auto& target : execution_parameter.targets) {
+    const auto points = sample_target_points(target);
+
+    // pressure of every sample of every point, grouped by point
+    auto pressure_val = std::vector<std::complex<double>>(points.size() * sample_cnt);
+    const auto strategy =
+        choose_pressure_strategy(pressure_val.size(), transducers.size());
+
+    result_log->log(fmt::format(
+        FMT_STRING("Computing target '{:s}' ({:d} points, {:d} pressure samples each, "
+                   "{:s})"),
+        target.name, points.size(), sample_cnt, to_string(strategy)));
+    // points are only known once sampled, so every target announces its own work
+    control->add_work(pressure_val.size() * transducers.size() + points.size());
+
+    evaluate_pressure(
+        control, std::span(pressure_val),
+        [&](std::size_t id) {
+          const auto& offset = pressure_samples[id % sample_cnt];
+          return points[id / sample_cnt] +
+                 Vec3<double>{double(offset[0]), double(offset[1]), double(offset[2])} *
+                     cell_size;
+        },
+        transducers, simulation_parameter, strategy);
+
+    // x, y, z, pressure (real, imaginary), potential, force (x, y, z) of each point
+    constexpr auto record_size = std::size_t(9);
+    auto record_val = std::vector<double>(points.size() * record_size);
+
+    parallel_for(control, points.size(), 1, [&](std::size_t id) {
+      const auto* pressure = &pressure_val[id * sample_cnt];
+
+      auto potential = std::vector<double>(star_cnt);
+      for (std::size_t star = 0; star < star_cnt; ++star) {
+        potential[star] = compute_potential(
+            pressure[stencil.pressure_sample(star, 0, 0)],
+            [&](std::size_t axis, std::size_t k) {
+              return pressure[stencil.pressure_sample(star, axis, std::int64_t(k))] -
+                     pressure[stencil.pressure_sample(star, axis, -std::int64_t(k))];
+            },
+            coefficients, cell_size, k1, k2);
+      }
+
+      const auto f = compute_force(
+          [&](std::size_t axis, std::size_t k) {
+            return potential[stencil.star_index(axis, k, true)] -
+                   potential[stencil.star_index(axis, k, false)];
+          },
+          coefficients, cell_size);
+
+      const auto& point = points[id];
+      const auto p = pressure[stencil.pressure_sample(0, 0, 0)];
+      auto* record = &record_val[id * record_size];
+      record[0] = point.x;
+      record[1] = point.y;
+      record[2] = point.z;
+      record[3] = p.real();
+      record[4] = p.imag();
+      record[5] = potential[0];
+      record[6] = f[0];
+      record[7] = f[1];
+      record[8] = f[2];
+    });
+
+    auto target_metadata = JSONConvert::from_evaluation_target(target);
+    target_metadata["field"] = fmt::format(FMT_STRING("target_{:s}"), target.name);
+    target_metadata["point_cnt"] = points.size();
+    target_metadata["pressure_samples_per_point"] = sample_cnt;
+    target_metadata["record"] = {"x",         "y",         "z",
+                                 "pressure_real", "pressure_imag", "potential",
+                                 "force_x",   "force_y",   "force_z"};
+
+    // Points are a one dimensional field of records, positions are in the records
+    auto field = FieldDescriptor();
+    field.name = target_metadata["field"].get<std::string>();
+    field.dtype = "float64";
+    field.cell_bytes = record_size * sizeof(double);
+    field.dimension_size = Vec3<std::size_t>{points.size(), 1, 1};
+    field.origin = Vec3<double>{0.0, 0.0, 0.0};
+    field.spacing = Vec3<double>{0.0, 0.0, 0.0};
+    field.gridded = false;
+    field.attributes["record"] = target_metadata["record"];
+    sink.write_field(sink.begin_field(field), std::as_bytes(std::span(record_val)));
+
+    metadata.push_back(target_metadata);
+  }
+
+  return metadata;
+}
+
+}  // namespace Computation
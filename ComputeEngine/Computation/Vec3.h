@@ -122,15 +122,16 @@ struct Vec3 {
   // endregion
 };
 
-// Specialization of abs for std::size_t as std::size_t is already unsigned
+// Specialization of abs for std::size_t as std::size_t is already unsigned, inline
+// as every translation unit including this header defines it
 template <>
-Vec3<std::size_t> Vec3<std::size_t>::elem_abs() const {
+inline Vec3<std::size_t> Vec3<std::size_t>::elem_abs() const {
   return Vec3<std::size_t>{this->x, this->y, this->z};
 }
 
 // Specialization of abs for double
 template <>
-Vec3<double> Vec3<double>::elem_abs() const {
+inline Vec3<double> Vec3<double>::elem_abs() const {
   return Vec3<double>{std::fabs(this->x), std::fabs(this->y), std::fabs(this->z)};
 }
 
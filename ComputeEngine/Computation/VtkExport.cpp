@@ -0,0 +1,217 @@
+#include "VtkExport.h"
+#include <fmt/format.h>
+#include <bit>
+#include <complex>
+#include <cstring>
+#include <regex>
+#include <stdexcept>
+#include <utility>
+#include "Executor.h"
+
+namespace Computation {
+
+VtkSink::VtkSink(std::unique_ptr<ResultSink> sink,
+                 AtomicLogger::AtomicLogger* result_log,
+                 std::filesystem::path export_directory,
+                 Config::VtkPressure pressure)
+    : sink(std::move(sink)),
+      result_log(result_log),
+      export_directory(std::move(export_directory)),
+      pressure(pressure) {}
+
+const VtkSink::Target* VtkSink::get_target(std::size_t field) {
+  const auto scoped_lock = std::scoped_lock(this->image_lock);
+  const auto target = this->targets.find(field);
+  return target != this->targets.end() ? &target->second : nullptr;
+}
+
+std::size_t VtkSink::begin_field(const FieldDescriptor& field) {
+  const auto id = this->sink->begin_field(field);
+
+  const auto complex = field.dtype == "complex128";
+  if (not field.gridded or (not complex and field.cell_bytes != sizeof(double))) {
+    return id;
+  }
+
+  // components of a vector are named <name>_x, <name>_y and <name>_z
+  static const auto component_name = std::regex("(.+)_([xyz])(_level[0-9]+)?");
+  auto image_name = field.name;
+  auto component = std::size_t(0);
+  auto component_cnt = std::size_t(1);
+  auto match = std::smatch();
+  if (not complex and std::regex_match(field.name, match, component_name)) {
+    image_name = match[1].str() + match[3].str();
+    component = std::size_t(match[2].str()[0] - 'x');
+    component_cnt = 3;
+  }
+
+  const auto scoped_lock = std::scoped_lock(this->image_lock);
+  // a component only joins an image created for a vector of the same size, otherwise
+  // it is written as a scalar image of its own
+  if (component_cnt == 3) {
+    const auto existing = this->images.find(image_name);
+    if (existing != this->images.end() and
+        (existing->second->component_cnt != 3 or
+         existing->second->dimension_size != field.dimension_size)) {
+      image_name = field.name;
+      component = 0;
+      component_cnt = 1;
+    }
+  }
+
+  auto arrays = std::vector<std::pair<std::string, std::size_t>>();
+  if (complex) {
+    const auto suffixes = this->pressure == Config::VtkPressure::MagnitudePhase
+                              ? std::pair("_magnitude", "_phase")
+                              : std::pair("_real", "_imag");
+    arrays.emplace_back(field.name + suffixes.first, 1);
+    arrays.emplace_back(field.name + suffixes.second, 1);
+  } else {
+    arrays.emplace_back(image_name, component_cnt);
+  }
+
+  auto& image = this->images[image_name];
+  if (image and component_cnt != 3) {
+    throw std::invalid_argument(fmt::format(
+        FMT_STRING("Field {:s} would overwrite {:s}"), field.name,
+        image->path.filename().string()));
+  }
+  if (not image) {
+    const auto& n = field.dimension_size;
+    const auto cell_cnt = n.product();
+    const auto extent =
+        fmt::format(FMT_STRING("0 {:d} 0 {:d} 0 {:d}"), n.z - 1, n.y - 1, n.x - 1);
+
+    auto header = fmt::format(
+        FMT_STRING("<?xml version=\"1.0\"?>\n"
+                   "<VTKFile type=\"ImageData\" version=\"1.0\" byte_order=\"{:s}\" "
+                   "header_type=\"UInt64\">\n"
+                   "  <ImageData WholeExtent=\"{:s}\" Origin=\"{} {} {}\" "
+                   "Spacing=\"{} {} {}\" Direction=\"0 0 1 0 1 0 1 0 0\">\n"
+                   "    <Piece Extent=\"{:s}\">\n"
+                   "      <PointData>\n"),
+        std::endian::native == std::endian::little ? "LittleEndian" : "BigEndian",
+        extent, field.origin.x, field.origin.y, field.origin.z, field.spacing.z,
+        field.spacing.y, field.spacing.x, extent);
+
+    // every array is a byte count followed by its values
+    auto appended_size = std::size_t(0);
+    auto appended_offsets = std::vector<std::size_t>();
+    for (const auto& [name, components] : arrays) {
+      header += fmt::format(
+          FMT_STRING("        <DataArray type=\"Float64\" Name=\"{:s}\" "
+                     "NumberOfComponents=\"{:d}\" format=\"appended\" "
+                     "offset=\"{:d}\"/>\n"),
+          name, components, appended_size);
+      appended_offsets.push_back(appended_size);
+      appended_size += sizeof(std::uint64_t) + cell_cnt * components * sizeof(double);
+    }
+    header +=
+        "      </PointData>\n"
+        "    </Piece>\n"
+        "  </ImageData>\n"
+        "  <AppendedData encoding=\"raw\">\n   ";
+    // pad so values are aligned to doubles in the mapping
+    const auto unaligned = (header.size() + 1) % sizeof(double);
+    header.append(unaligned == 0 ? 0 : sizeof(double) - unaligned, ' ');
+    header += "_";
+    const auto footer = std::string_view("\n  </AppendedData>\n</VTKFile>\n");
+
+    image = std::make_unique<Image>();
+    image->path = this->export_directory / (image_name + ".vti");
+    image->dimension_size = n;
+    image->component_cnt = component_cnt;
+    image->file = std::make_unique<MappedFile::MappedFile>(
+        image->path, header.size() + appended_size + footer.size());
+    auto* data = image->file->data();
+    std::memcpy(data, header.data(), header.size());
+    for (std::size_t array = 0; array < arrays.size(); ++array) {
+      const auto offset = header.size() + appended_offsets[array];
+      const auto bytes = cell_cnt * arrays[array].second * sizeof(double);
+      const auto bytes_header = std::uint64_t(bytes);
+      std::memcpy(data + offset, &bytes_header, sizeof(bytes_header));
+      image->array_offsets.push_back(offset + sizeof(bytes_header));
+    }
+    std::memcpy(data + header.size() + appended_size, footer.data(), footer.size());
+  }
+
+  const auto slab_cnt = field.dimension_size.y * field.dimension_size.z;
+  this->targets[id] = Target{image.get(), slab_cnt, complex, component, component_cnt};
+  return id;
+}
+
+void VtkSink::store(const Target& target,
+                    std::size_t first_cell,
+                    std::span<const std::byte> cells) {
+  auto* data = target.image->file->data();
+  const auto cell_bytes =
+      target.complex ? sizeof(std::complex<double>) : sizeof(double);
+  const auto cell_cnt = cells.size() / cell_bytes;
+
+  if (target.complex) {
+    auto* first = reinterpret_cast<double*>(data + target.image->array_offsets[0]);
+    auto* second = reinterpret_cast<double*>(data + target.image->array_offsets[1]);
+    const auto magnitude_phase = this->pressure == Config::VtkPressure::MagnitudePhase;
+
+    parallel_for(nullptr, cell_cnt, 0, [&](std::size_t id) {
+      auto value = std::complex<double>();
+      std::memcpy(&value, cells.data() + id * sizeof(value), sizeof(value));
+      const auto cell = first_cell + id;
+      first[cell] = magnitude_phase ? std::abs(value) : value.real();
+      second[cell] = magnitude_phase ? std::arg(value) : value.imag();
+    });
+    return;
+  }
+
+  auto* values = reinterpret_cast<double*>(data + target.image->array_offsets[0]);
+  parallel_for(nullptr, cell_cnt, 0, [&](std::size_t id) {
+    const auto cell = first_cell + id;
+    std::memcpy(&values[cell * target.component_cnt + target.component],
+                cells.data() + id * sizeof(double), sizeof(double));
+  });
+}
+
+void VtkSink::write_field(std::size_t field, std::span<const std::byte> cells) {
+  this->sink->write_field(field, cells);
+  if (const auto* target = this->get_target(field)) {
+    this->store(*target, 0, cells);
+  }
+}
+
+void VtkSink::write_slab(std::size_t field,
+                         std::size_t x,
+                         std::span<const std::byte> cells) {
+  this->sink->write_slab(field, x, cells);
+  if (const auto* target = this->get_target(field)) {
+    this->store(*target, x * target->slab_cnt, cells);
+  }
+}
+
+void VtkSink::finish(const nlohmann::json& metadata) {
+  auto result = metadata;
+  result["vtk_files"] = nlohmann::json::array();
+
+  {
+    const auto scoped_lock = std::scoped_lock(this->image_lock);
+    for (const auto& [name, image] : this->images) {
+      image->file->flush();
+      result["vtk_files"].push_back(image->path.filename().string());
+      this->result_log->log(fmt::format(
+          FMT_STRING("Exported {:s} ({:.1f} MiB)"), image->path.filename().string(),
+          double(image->file->size()) / (1024.0 * 1024.0)));
+    }
+  }
+
+  this->sink->finish(result);
+}
+
+std::vector<std::filesystem::path> VtkSink::output_files() {
+  auto result = this->sink->output_files();
+  const auto scoped_lock = std::scoped_lock(this->image_lock);
+  for (const auto& [name, image] : this->images) {
+    result.push_back(image->path);
+  }
+  return result;
+}
+
+}  // namespace Computation
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../Utilities/AtomicLogger.h"
+#include "../Utilities/MappedFile.h"
+#include "Config.h"
+#include "ResultSink.h"
+#include "Vec3.h"
+
+namespace Computation {
+
+/* Every gridded field is also written to `<field>.vti` (VTK XML ImageData with raw
+ * appended data). Complex fields become two scalar arrays, and `<name>_x`, `_y`,
+ * `_z` fields (optionally followed by `_level<k>`) are merged into one 3-component
+ * array of `<name>.vti` unless that image already holds a field of another layout.
+ *
+ * VTK expects x to be the fastest changing index while cells are stored x-major,
+ * so image axes i, j, k are declared along world z, y, x through the Direction
+ * matrix. Cells then map to VTK points in storage order, and whole fields and
+ * slabs are written straight into the mapped file without reordering. */
+class VtkSink : public ResultSink {
+  struct Image {
+    std::filesystem::path path;
+    std::unique_ptr<MappedFile::MappedFile> file;
+    // Offset in file of the first value of every data array
+    std::vector<std::size_t> array_offsets;
+    // Layout the image was created with, which merged fields must share
+    Vec3<std::size_t> dimension_size;
+    std::size_t component_cnt;
+  };
+  // Image arrays written by one field
+  struct Target {
+    Image* image;
+    std::size_t slab_cnt;
+    bool complex;
+    // Component within the vector array, or 0 for scalar arrays
+    std::size_t component;
+    std::size_t component_cnt;
+  };
+
+  std::unique_ptr<ResultSink> sink;
+  AtomicLogger::AtomicLogger* result_log;
+  std::filesystem::path export_directory;
+  Config::VtkPressure pressure;
+
+  std::mutex image_lock;
+  std::map<std::string, std::unique_ptr<Image>> images;
+  std::map<std::size_t, Target> targets;
+
+  [[nodiscard]] const Target* get_target(std::size_t field);
+  // Write cells starting at cell `first_cell` into the arrays of the target
+  void store(const Target& target,
+             std::size_t first_cell,
+             std::span<const std::byte> cells);
+
+ public:
+  VtkSink(std::unique_ptr<ResultSink> sink,
+          AtomicLogger::AtomicLogger* result_log,
+          std::filesystem::path export_directory,
+          Config::VtkPressure pressure);
+
+  std::size_t begin_field(const FieldDescriptor& field) override;
+  void write_field(std::size_t field, std::span<const std::byte> cells) override;
+  void write_slab(std::size_t field,
+                  std::size_t x,
+                  std::span<const std::byte> cells) override;
+  // Flush every image and list them under "vtk_files" in metadata
+  void finish(const nlohmann::json& metadata) override;
+  // Images along with the files of the wrapped sink
+  std::vector<std::filesystem::path> output_files() override;
+};
+
+}  // namespace Computation
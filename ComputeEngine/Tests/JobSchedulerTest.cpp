@@ -0,0 +1,118 @@
+#include <fmt/format.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#include "../Computation/JobScheduler.h"
+
+namespace {
+
+using Computation::JobStatus;
+
+int failures = 0;
+
+void expect(bool condition, std::string_view message) {
+  if (not condition) {
+    fmt::print(stderr, FMT_STRING("FAILED: {:s}\n"), message);
+    ++failures;
+  }
+}
+
+// Box of `cells` cells per edge driven by `transducer_count` transducers below it
+Computation::JobRequest make_request(const std::filesystem::path& export_directory,
+                                     std::size_t cells,
+                                     std::size_t transducer_count) {
+  auto request = Computation::JobRequest();
+  request.name = export_directory.filename().string();
+  request.export_directory = export_directory;
+  request.cores = 1;
+  for (std::size_t i = 0; i < transducer_count; ++i) {
+    const auto position = Vec3<double>(double(i % 8), double(i / 8), -10.0) * 0.01;
+    request.transducers.push_back(Config::Transducer{std::to_string(i), position,
+                                                     Vec3<double>(0.0, 0.0, 0.0), 0.005,
+                                                     0.0, 0.0, 1.0});
+  }
+  auto& simulation_parameter = request.simulation_parameter;
+  simulation_parameter.begin = Vec3<double>(0.0, 0.0, 0.0);
+  simulation_parameter.end = Vec3<double>(1.0, 1.0, 1.0) * (0.001 * double(cells));
+  simulation_parameter.cell_size = 0.001;
+  simulation_parameter.frequency = 40000.0;
+  simulation_parameter.air_density = 1.2;
+  simulation_parameter.air_wave_speed = 343.0;
+  simulation_parameter.particle_radius = 0.001;
+  simulation_parameter.particle_density = 30.0;
+  simulation_parameter.particle_wave_speed = 900.0;
+  std::filesystem::create_directories(export_directory);
+  return request;
+}
+
+void test_shares_output(const std::filesystem::path& root) {
+  const auto a = make_request(root / "a", 1, 1);
+  expect(Computation::shares_output(a, make_request(root / "a", 1, 1)),
+         "same export directory is shared");
+  expect(Computation::shares_output(a, make_request(root / "a" / "", 1, 1)),
+         "trailing separator names the same directory");
+  expect(Computation::shares_output(a, make_request(root / "a" / "sweep", 1, 1)),
+         "nested export directory is shared");
+  expect(not Computation::shares_output(a, make_request(root / "ab", 1, 1)),
+         "sibling with common prefix is not shared");
+
+  auto stream_a = make_request(root / "stream_a", 1, 1);
+  auto stream_b = make_request(root / "stream_b", 1, 1);
+  stream_a.execution_parameter.output_format = Config::OutputFormat::Stream;
+  stream_b.execution_parameter.output_format = Config::OutputFormat::Stream;
+  expect(Computation::shares_output(stream_a, stream_b), "same stream is shared");
+  stream_b.execution_parameter.output_stream = "other";
+  expect(not Computation::shares_output(stream_a, stream_b),
+         "different streams are not shared");
+
+  auto memory_a = make_request(root / "memory_a", 1, 1);
+  auto memory_b = make_request(root / "memory_b", 1, 1);
+  memory_a.execution_parameter.output_format = Config::OutputFormat::SharedMemory;
+  memory_b.execution_parameter.output_format = Config::OutputFormat::SharedMemory;
+  expect(Computation::shares_output(memory_a, memory_b),
+         "same shared memory region is shared");
+}
+
+// A job sharing the output of a running job waits for it, others start meanwhile
+void test_scheduler_holds_back_shared_output(const std::filesystem::path& root) {
+  auto scheduler = Computation::JobScheduler(3);
+  const auto status = [&](std::size_t id) { return scheduler.snapshot()[id].status; };
+
+  // submitted paused, so it holds at its first tile and keeps running until cancelled
+  auto paused = make_request(root / "shared", 4, 1);
+  paused.paused = true;
+  const auto running = scheduler.submit(std::move(paused));
+  const auto held = scheduler.submit(make_request(root / "shared", 4, 1));
+  const auto other = scheduler.submit(make_request(root / "other", 4, 1));
+
+  expect(status(running) == JobStatus::Running, "first job runs");
+  expect(status(held) == JobStatus::Queued, "job sharing its output is held back");
+  expect(status(other) != JobStatus::Queued, "job with its own output starts");
+
+  expect(scheduler.result(other).get() == JobStatus::Succeeded,
+         "job with its own output succeeds");
+  expect(status(held) == JobStatus::Queued,
+         "job sharing its output stays held while free cores remain");
+
+  scheduler.cancel(running);
+  expect(scheduler.result(running).get() == JobStatus::Cancelled,
+         "first job is cancelled");
+  expect(scheduler.result(held).get() == JobStatus::Succeeded,
+         "held job runs once the first job finished");
+}
+
+}  // namespace
+
+int main() {
+  const auto root = std::filesystem::temp_directory_path() / "job_scheduler_test";
+  std::filesystem::remove_all(root);
+
+  test_shares_output(root);
+  test_scheduler_holds_back_shared_output(root);
+
+  std::filesystem::remove_all(root);
+  return failures == 0 ? 0 : 1;
+}
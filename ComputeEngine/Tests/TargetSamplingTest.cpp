@@ -0,0 +1,57 @@
+#include <fmt/format.h>
+
+#include <cmath>
+#include <cstddef>
+#include <string_view>
+
+#include "../Computation/Processes.h"
+
+namespace {
+
+int failures = 0;
+
+void expect(bool condition, std::string_view message) {
+  if (not condition) {
+    fmt::print(stderr, FMT_STRING("FAILED: {:s}\n"), message);
+    ++failures;
+  }
+}
+
+Config::EvaluationTarget make_polyline(double begin_z, double end_z, double spacing) {
+  auto target = Config::EvaluationTarget();
+  target.name = "line";
+  target.kind = Config::EvaluationTarget::Kind::Polyline;
+  target.vertices = {Vec3<double>(0.0, 0.0, begin_z), Vec3<double>(0.0, 0.0, end_z)};
+  target.spacing = spacing;
+  return target;
+}
+
+// Whole multiples of the spacing are sampled on its lattice even when the ratio of
+// length and spacing rounds past an integer
+void test_polyline_on_lattice() {
+  const auto cell_size = 0.001;
+  const auto points =
+      Computation::sample_target_points(make_polyline(0.025, 0.035, cell_size));
+  expect(points.size() == 11, "lattice-aligned polyline has 11 points");
+  for (const auto& point : points) {
+    const auto index = point.z / cell_size;
+    expect(std::abs(index - std::round(index)) < 1e-6,
+           "lattice-aligned polyline hits the grid points");
+  }
+}
+
+// Segments that are not whole multiples of the spacing are sampled closer than it
+void test_polyline_off_lattice() {
+  const auto points =
+      Computation::sample_target_points(make_polyline(0.025, 0.0355, 0.001));
+  expect(points.size() == 12, "polyline of 10.5 steps has 12 points");
+  expect(points[1].z - points[0].z <= 0.001, "samples are at most spacing apart");
+}
+
+}  // namespace
+
+int main() {
+  test_polyline_on_lattice();
+  test_polyline_off_lattice();
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+#include "AsyncWriter.h"
+
+#include <optional>
+
+namespace AsyncWriter {
+
+AsyncWriter::AsyncWriter() : worker(&AsyncWriter::run, this) {}
+
+AsyncWriter::~AsyncWriter() {
+  {
+    const auto scoped_lock = std::scoped_lock(this->queue_lock);
+    this->stopping = true;
+  }
+  this->queue_signal.notify_all();
+  this->worker.join();
+}
+
+std::shared_future<void> AsyncWriter::submit(std::function<void()> write) {
+  auto job = Job{std::move(write), std::promise<void>()};
+  auto result = job.done.get_future().share();
+  {
+    const auto scoped_lock = std::scoped_lock(this->queue_lock);
+    this->queue.push_back(std::move(job));
+  }
+  this->queue_signal.notify_one();
+  return result;
+}
+
+void AsyncWriter::run() {
+  while (true) {
+    auto job = [&]() -> std::optional<Job> {
+      auto unique_lock = std::unique_lock(this->queue_lock);
+      this->queue_signal.wait(unique_lock, [&]() {
+        return this->stopping or not this->queue.empty();
+      });
+      if (this->queue.empty()) {
+        return std::nullopt;
+      }
+      auto front = std::move(this->queue.front());
+      this->queue.pop_front();
+      return front;
+    }();
+
+    if (not job) {
+      return;
+    }
+
+    try {
+      job->write();
+      job->done.set_value();
+    } catch (...) {
+      job->done.set_exception(std::current_exception());
+    }
+  }
+}
+
+}  // namespace AsyncWriter
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace AsyncWriter {
+
+class AsyncWriter {
+  // Runs queued write jobs one after another on a background thread
+  struct Job {
+    std::function<void()> write;
+    std::promise<void> done;
+  };
+
+  std::mutex queue_lock;
+  std::condition_variable queue_signal;
+  std::deque<Job> queue;
+  bool stopping = false;
+  std::thread worker;
+
+  void run();
+
+ public:
+  AsyncWriter();
+  // Finishes every queued job before returning
+  ~AsyncWriter();
+
+  AsyncWriter(const AsyncWriter&) = delete;
+  AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+  // Queue a job in the background, data it reads must stay valid and unmodified
+  // until the returned future is ready, which rethrows errors of the job
+  std::shared_future<void> submit(std::function<void()> write);
+};
+
+}  // namespace AsyncWriter
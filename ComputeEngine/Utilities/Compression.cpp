@@ -0,0 +1,187 @@
+#include "Compression.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace Compression {
+
+namespace {
+
+constexpr auto min_match = std::size_t(4);
+constexpr auto max_offset = std::size_t(65535);
+// Matches stop this many bytes before the end, and no match starts in the last
+// `match_limit` bytes, so the block always ends with literals
+constexpr auto last_literals = std::size_t(5);
+constexpr auto match_limit = std::size_t(12);
+constexpr auto hash_bits = 14;
+
+std::uint32_t read_u32(const std::byte* p) {
+  auto result = std::uint32_t();
+  std::memcpy(&result, p, sizeof(result));
+  return result;
+}
+
+std::size_t hash_u32(std::uint32_t sequence) {
+  return std::size_t((sequence * 2654435761u) >> (32 - hash_bits));
+}
+
+void write_length(std::vector<std::byte>& out, std::size_t length) {
+  while (length >= 255) {
+    out.push_back(std::byte(255));
+    length -= 255;
+  }
+  out.push_back(std::byte(length));
+}
+
+void write_sequence(std::vector<std::byte>& out,
+                    std::span<const std::byte> literals,
+                    std::size_t offset,
+                    std::size_t match_length) {
+  const auto literal_nibble = std::min(literals.size(), std::size_t(15));
+  const auto match_nibble =
+      match_length == 0 ? 0 : std::min(match_length - min_match, std::size_t(15));
+  out.push_back(std::byte(literal_nibble << 4 | match_nibble));
+  if (literal_nibble == 15) {
+    write_length(out, literals.size() - 15);
+  }
+  out.insert(out.end(), literals.begin(), literals.end());
+
+  if (match_length == 0) {
+    return;
+  }
+  out.push_back(std::byte(offset & 0xFF));
+  out.push_back(std::byte(offset >> 8));
+  if (match_nibble == 15) {
+    write_length(out, match_length - min_match - 15);
+  }
+}
+
+}  // namespace
+
+std::vector<std::byte> shuffle(std::span<const std::byte> bytes,
+                               std::size_t element_size) {
+  const auto element_cnt = bytes.size() / element_size;
+  auto result = std::vector<std::byte>(bytes.begin(), bytes.end());
+  for (std::size_t element = 0; element < element_cnt; ++element) {
+    for (std::size_t b = 0; b < element_size; ++b) {
+      result[b * element_cnt + element] = bytes[element * element_size + b];
+    }
+  }
+  return result;
+}
+
+std::vector<std::byte> unshuffle(std::span<const std::byte> bytes,
+                                 std::size_t element_size) {
+  const auto element_cnt = bytes.size() / element_size;
+  auto result = std::vector<std::byte>(bytes.begin(), bytes.end());
+  for (std::size_t element = 0; element < element_cnt; ++element) {
+    for (std::size_t b = 0; b < element_size; ++b) {
+      result[element * element_size + b] = bytes[b * element_cnt + element];
+    }
+  }
+  return result;
+}
+
+std::vector<std::byte> lz_compress(std::span<const std::byte> bytes) {
+  auto result = std::vector<std::byte>();
+  result.reserve(bytes.size() / 2 + 16);
+
+  // Position + 1 of the last occurrence of each hashed 4-byte sequence, 0 if none
+  auto table = std::vector<std::uint32_t>(std::size_t(1) << hash_bits);
+  const auto* data = bytes.data();
+  const auto size = bytes.size();
+
+  auto anchor = std::size_t(0);
+  auto position = std::size_t(0);
+  while (size >= match_limit and position + match_limit <= size) {
+    const auto sequence = read_u32(data + position);
+    auto& entry = table[hash_u32(sequence)];
+    const auto candidate = std::size_t(entry);
+    entry = std::uint32_t(position + 1);
+
+    if (candidate == 0 or position - (candidate - 1) > max_offset or
+        read_u32(data + candidate - 1) != sequence) {
+      // skip faster through data that does not compress
+      position += 1 + ((position - anchor) >> 6);
+      continue;
+    }
+
+    const auto match = candidate - 1;
+    auto length = min_match;
+    while (position + length < size - last_literals and
+           data[match + length] == data[position + length]) {
+      ++length;
+    }
+
+    write_sequence(result, bytes.subspan(anchor, position - anchor), position - match,
+                   length);
+    position += length;
+    anchor = position;
+  }
+
+  write_sequence(result, bytes.subspan(anchor), 0, 0);
+  return result;
+}
+
+std::vector<std::byte> lz_decompress(std::span<const std::byte> bytes,
+                                     std::size_t raw_size) {
+  auto result = std::vector<std::byte>();
+  result.reserve(raw_size);
+
+  const auto corrupt = []() { return std::runtime_error("Corrupt compressed block"); };
+  auto position = std::size_t(0);
+  const auto read_byte = [&]() {
+    if (position >= bytes.size()) {
+      throw corrupt();
+    }
+    return std::size_t(bytes[position++]);
+  };
+  const auto read_length = [&](std::size_t length) {
+    if (length == 15) {
+      auto extra = std::size_t(255);
+      while (extra == 255) {
+        extra = read_byte();
+        length += extra;
+      }
+    }
+    return length;
+  };
+
+  while (position < bytes.size()) {
+    const auto token = read_byte();
+
+    const auto literal_length = read_length(token >> 4);
+    if (literal_length > bytes.size() - position or
+        literal_length > raw_size - result.size()) {
+      throw corrupt();
+    }
+    result.insert(result.end(), bytes.begin() + std::ptrdiff_t(position),
+                  bytes.begin() + std::ptrdiff_t(position + literal_length));
+    position += literal_length;
+    if (position == bytes.size()) {
+      break;
+    }
+
+    const auto offset_low = read_byte();
+    const auto offset = offset_low | read_byte() << 8;
+    const auto match_length = read_length(token & 0x0F) + min_match;
+    if (offset == 0 or offset > result.size() or
+        match_length > raw_size - result.size()) {
+      throw corrupt();
+    }
+    // matches may overlap the bytes they produce, so copy one byte at a time
+    const auto match = result.size() - offset;
+    for (std::size_t k = 0; k < match_length; ++k) {
+      result.push_back(result[match + k]);
+    }
+  }
+
+  if (result.size() != raw_size) {
+    throw corrupt();
+  }
+  return result;
+}
+
+}  // namespace Compression
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace Compression {
+
+// Group byte `b` of every element together, so slowly varying numbers turn into
+// long runs of equal high bytes
+[[nodiscard]] std::vector<std::byte> shuffle(std::span<const std::byte> bytes,
+                                             std::size_t element_size);
+[[nodiscard]] std::vector<std::byte> unshuffle(std::span<const std::byte> bytes,
+                                               std::size_t element_size);
+
+/* LZ77 block codec in the LZ4 block format: sequences of a token (literal length
+ * and match length nibbles), extra length bytes, literals, and a 16-bit match
+ * offset. The last sequence only holds literals. */
+[[nodiscard]] std::vector<std::byte> lz_compress(std::span<const std::byte> bytes);
+// Throws std::runtime_error if `bytes` does not decode to exactly `raw_size` bytes
+[[nodiscard]] std::vector<std::byte> lz_decompress(std::span<const std::byte> bytes,
+                                                   std::size_t raw_size);
+
+}  // namespace Compression
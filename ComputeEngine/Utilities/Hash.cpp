@@ -0,0 +1,17 @@
+#include "Hash.h"
+#include <fmt/format.h>
+
+namespace Hash {
+
+std::uint64_t fnv1a(std::string_view data, std::uint64_t hash) {
+  for (const auto character : data) {
+    hash = (hash ^ std::uint8_t(character)) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+std::string to_hex(std::uint64_t hash) {
+  return fmt::format(FMT_STRING("{:016x}"), hash);
+}
+
+}  // namespace Hash
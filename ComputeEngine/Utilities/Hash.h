@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Hash {
+
+constexpr auto fnv1a_basis = std::uint64_t(14695981039346656037ULL);
+
+// 64-bit FNV-1a of data, continuing from `hash` so data can be hashed in pieces
+[[nodiscard]] std::uint64_t fnv1a(std::string_view data,
+                                  std::uint64_t hash = fnv1a_basis);
+
+// Hash as 16 lower case hex digits
+[[nodiscard]] std::string to_hex(std::uint64_t hash);
+
+}  // namespace Hash
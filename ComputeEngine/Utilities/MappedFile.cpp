@@ -0,0 +1,171 @@
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace MappedFile {
+
+MappedFile::MappedFile(const std::filesystem::path& path, std::size_t size)
+    : mapped_size(size) {
+  // Replaced rather than truncated, so other links to the file keep their content
+  auto remove_error = std::error_code();
+  std::filesystem::remove(path, remove_error);
+
+#if defined(_WIN32)
+  file_handle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_handle == INVALID_HANDLE_VALUE) {
+    file_handle = nullptr;
+    throw std::runtime_error("Unable to create mapped file: " + path.string());
+  }
+
+  // Creating a mapping larger than the file extends the file
+  const auto size_high = DWORD(std::uint64_t(size) >> 32);
+  const auto size_low = DWORD(std::uint64_t(size) & 0xFFFFFFFF);
+  mapping_handle = CreateFileMappingW(file_handle, nullptr, PAGE_READWRITE, size_high,
+                                      size_low, nullptr);
+  if (mapping_handle == nullptr) {
+    this->close();
+    throw std::runtime_error("Unable to map file: " + path.string());
+  }
+
+  mapped_data = static_cast<std::byte*>(
+      MapViewOfFile(mapping_handle, FILE_MAP_WRITE, 0, 0, size));
+  if (mapped_data == nullptr) {
+    this->close();
+    throw std::runtime_error("Unable to map file: " + path.string());
+  }
+#else
+  file_descriptor = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (file_descriptor < 0) {
+    throw std::runtime_error("Unable to create mapped file: " + path.string());
+  }
+
+  if (::ftruncate(file_descriptor, off_t(size)) != 0) {
+    this->close();
+    throw std::runtime_error("Unable to resize mapped file: " + path.string());
+  }
+
+  auto* mapping =
+      ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, 0);
+  if (mapping == MAP_FAILED) {
+    this->close();
+    throw std::runtime_error("Unable to map file: " + path.string());
+  }
+  mapped_data = static_cast<std::byte*>(mapping);
+#endif
+}
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+#if defined(_WIN32)
+  file_handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_handle == INVALID_HANDLE_VALUE) {
+    file_handle = nullptr;
+    throw std::runtime_error("Unable to open mapped file: " + path.string());
+  }
+
+  auto file_size = LARGE_INTEGER();
+  if (GetFileSizeEx(file_handle, &file_size) == 0) {
+    this->close();
+    throw std::runtime_error("Unable to query size of file: " + path.string());
+  }
+  mapped_size = std::size_t(file_size.QuadPart);
+  // empty files can not be mapped, and have no data to read anyway
+  if (mapped_size == 0) {
+    return;
+  }
+
+  mapping_handle =
+      CreateFileMappingW(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping_handle == nullptr) {
+    this->close();
+    throw std::runtime_error("Unable to map file: " + path.string());
+  }
+
+  mapped_data = static_cast<std::byte*>(
+      MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, mapped_size));
+  if (mapped_data == nullptr) {
+    this->close();
+    throw std::runtime_error("Unable to map file: " + path.string());
+  }
+#else
+  file_descriptor = ::open(path.c_str(), O_RDONLY);
+  if (file_descriptor < 0) {
+    throw std::runtime_error("Unable to open mapped file: " + path.string());
+  }
+
+  struct stat file_status {};
+  if (::fstat(file_descriptor, &file_status) != 0) {
+    this->close();
+    throw std::runtime_error("Unable to query size of file: " + path.string());
+  }
+  mapped_size = std::size_t(file_status.st_size);
+  // empty files can not be mapped, and have no data to read anyway
+  if (mapped_size == 0) {
+    return;
+  }
+
+  auto* mapping =
+      ::mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+  if (mapping == MAP_FAILED) {
+    this->close();
+    throw std::runtime_error("Unable to map file: " + path.string());
+  }
+  mapped_data = static_cast<std::byte*>(mapping);
+#endif
+}
+
+MappedFile::~MappedFile() {
+  this->close();
+}
+
+void MappedFile::close() {
+#if defined(_WIN32)
+  if (mapped_data != nullptr) {
+    UnmapViewOfFile(mapped_data);
+  }
+  if (mapping_handle != nullptr) {
+    CloseHandle(mapping_handle);
+  }
+  if (file_handle != nullptr) {
+    CloseHandle(file_handle);
+  }
+  mapping_handle = nullptr;
+  file_handle = nullptr;
+#else
+  if (mapped_data != nullptr) {
+    ::munmap(mapped_data, mapped_size);
+  }
+  if (file_descriptor >= 0) {
+    ::close(file_descriptor);
+  }
+  file_descriptor = -1;
+#endif
+  mapped_data = nullptr;
+}
+
+void MappedFile::flush() const {
+  if (mapped_data == nullptr) {
+    return;
+  }
+#if defined(_WIN32)
+  FlushViewOfFile(mapped_data, 0);
+#else
+  ::msync(mapped_data, mapped_size, MS_ASYNC);
+#endif
+}
+
+}  // namespace MappedFile
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+namespace MappedFile {
+
+class MappedFile {
+  // File mapped into memory, writes to the mapping land in the page cache and are
+  // written back to the file by the operating system
+  std::byte* mapped_data = nullptr;
+  std::size_t mapped_size = 0;
+
+#if defined(_WIN32)
+  void* file_handle = nullptr;
+  void* mapping_handle = nullptr;
+#else
+  int file_descriptor = -1;
+#endif
+
+  void close();
+
+ public:
+  // Create (or replace) file of `size` bytes and map it for reading and writing
+  MappedFile(const std::filesystem::path& path, std::size_t size);
+  // Map existing file at path for reading only, writing to the mapping is invalid
+  explicit MappedFile(const std::filesystem::path& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  [[nodiscard]] std::byte* data() const { return mapped_data; }
+  [[nodiscard]] std::size_t size() const { return mapped_size; }
+
+  // Schedule write back of dirty pages without waiting for it
+  void flush() const;
+};
+
+}  // namespace MappedFile
@@ -0,0 +1,89 @@
+#include "OutputStream.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace OutputStream {
+
+OutputStream::OutputStream(std::string target) : target(std::move(target)) {
+#if defined(_WIN32)
+  if (this->target == "-") {
+    file_handle = GetStdHandle(STD_OUTPUT_HANDLE);
+  } else {
+    // named pipes are opened as \\.\pipe\<name> once the consumer created them
+    const auto wide_target = std::wstring(this->target.begin(), this->target.end());
+    file_handle = CreateFileW(wide_target.c_str(), GENERIC_WRITE, 0, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    owns_handle = true;
+  }
+  if (file_handle == nullptr or file_handle == INVALID_HANDLE_VALUE) {
+    file_handle = nullptr;
+    throw std::runtime_error("Unable to open output stream: " + this->target);
+  }
+#else
+  // a consumer going away fails writes with EPIPE instead of ending the process
+  std::signal(SIGPIPE, SIG_IGN);
+  if (this->target == "-") {
+    file_descriptor = STDOUT_FILENO;
+    return;
+  }
+  if (::mkfifo(this->target.c_str(), 0600) != 0 and errno != EEXIST) {
+    throw std::runtime_error("Unable to create named pipe: " + this->target);
+  }
+  file_descriptor = ::open(this->target.c_str(), O_WRONLY);
+  if (file_descriptor < 0) {
+    throw std::runtime_error("Unable to open output stream: " + this->target);
+  }
+  owns_descriptor = true;
+#endif
+}
+
+OutputStream::~OutputStream() {
+#if defined(_WIN32)
+  if (owns_handle and file_handle != nullptr) {
+    CloseHandle(file_handle);
+  }
+#else
+  if (owns_descriptor and file_descriptor >= 0) {
+    ::close(file_descriptor);
+  }
+#endif
+}
+
+void OutputStream::write(std::span<const std::byte> bytes) const {
+  // pipes accept at most their buffer size at once
+  while (not bytes.empty()) {
+#if defined(_WIN32)
+    auto written = DWORD(0);
+    const auto size = DWORD(std::min<std::size_t>(bytes.size(), 1 << 30));
+    if (WriteFile(file_handle, bytes.data(), size, &written, nullptr) == 0) {
+      throw std::runtime_error("Unable to write output stream: " + target);
+    }
+    const auto written_size = std::size_t(written);
+#else
+    const auto written = ::write(file_descriptor, bytes.data(), bytes.size());
+    if (written < 0 and errno == EINTR) {
+      continue;
+    }
+    if (written < 0) {
+      throw std::runtime_error("Unable to write output stream: " + target);
+    }
+    const auto written_size = std::size_t(written);
+#endif
+    bytes = bytes.subspan(written_size);
+  }
+}
+
+}  // namespace OutputStream
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+namespace OutputStream {
+
+class OutputStream {
+  // Sequential writes to stdout or a named pipe, not safe to use from several
+  // threads at once
+#if defined(_WIN32)
+  void* file_handle = nullptr;
+  bool owns_handle = false;
+#else
+  int file_descriptor = -1;
+  bool owns_descriptor = false;
+#endif
+  std::string target;
+
+ public:
+  // Open stdout for "-", or the named pipe `target`. On POSIX a missing pipe is
+  // created, and opening blocks until a consumer opens it for reading
+  explicit OutputStream(std::string target);
+  ~OutputStream();
+
+  OutputStream(const OutputStream&) = delete;
+  OutputStream& operator=(const OutputStream&) = delete;
+
+  // Write every byte, throws on failure (e.g. the consumer went away)
+  void write(std::span<const std::byte> bytes) const;
+};
+
+}  // namespace OutputStream
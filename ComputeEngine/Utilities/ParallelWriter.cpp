@@ -0,0 +1,203 @@
+#include "ParallelWriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace ParallelWriter {
+
+OutputFile::OutputFile(const std::filesystem::path& path, bool direct_io)
+    : path(path), direct_io(direct_io) {
+  // Replaced rather than truncated, so other links to the file keep their content
+  auto remove_error = std::error_code();
+  std::filesystem::remove(path, remove_error);
+
+#if defined(_WIN32)
+  const auto flags = FILE_ATTRIBUTE_NORMAL |
+                     (direct_io ? FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH : 0);
+  file_handle = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                            DWORD(flags), nullptr);
+  if (file_handle == INVALID_HANDLE_VALUE) {
+    file_handle = nullptr;
+    throw std::runtime_error("Unable to create " + path.string());
+  }
+#else
+  auto flags = O_WRONLY | O_CREAT | O_TRUNC;
+#if defined(O_DIRECT)
+  if (direct_io) {
+    flags |= O_DIRECT;
+  }
+#endif
+  file_descriptor = ::open(path.c_str(), flags, 0644);
+  if (file_descriptor < 0) {
+    throw std::runtime_error("Unable to create " + path.string());
+  }
+#endif
+}
+
+OutputFile::~OutputFile() {
+#if defined(_WIN32)
+  if (file_handle != nullptr) {
+    CloseHandle(file_handle);
+  }
+#else
+  if (file_descriptor >= 0) {
+    ::close(file_descriptor);
+  }
+#endif
+}
+
+void OutputFile::write_at(std::size_t offset, std::span<const std::byte> bytes) const {
+  while (not bytes.empty()) {
+#if defined(_WIN32)
+    auto overlapped = OVERLAPPED();
+    overlapped.Offset = DWORD(std::uint64_t(offset) & 0xFFFFFFFF);
+    overlapped.OffsetHigh = DWORD(std::uint64_t(offset) >> 32);
+    auto written = DWORD(0);
+    const auto request = DWORD(std::min(bytes.size(), std::size_t(1) << 30));
+    if (WriteFile(file_handle, bytes.data(), request, &written, &overlapped) == 0) {
+      throw std::runtime_error("Unable to write " + path.string());
+    }
+#else
+    const auto written =
+        ::pwrite(file_descriptor, bytes.data(), bytes.size(), off_t(offset));
+    // interrupted before anything was written, retried like a short write
+    if (written < 0 and errno == EINTR) {
+      continue;
+    }
+    if (written < 0) {
+      throw std::runtime_error("Unable to write " + path.string());
+    }
+#endif
+    offset += std::size_t(written);
+    bytes = bytes.subspan(std::size_t(written));
+  }
+}
+
+void OutputFile::resize(std::size_t size) const {
+#if defined(_WIN32)
+  auto end = LARGE_INTEGER();
+  end.QuadPart = LONGLONG(size);
+  if (SetFilePointerEx(file_handle, end, nullptr, FILE_BEGIN) == 0 or
+      SetEndOfFile(file_handle) == 0) {
+    throw std::runtime_error("Unable to resize " + path.string());
+  }
+#else
+  if (::ftruncate(file_descriptor, off_t(size)) != 0) {
+    throw std::runtime_error("Unable to resize " + path.string());
+  }
+#endif
+}
+
+// Memory aligned for direct I/O, each writer thread copies its chunks into one
+struct AlignedDeleter {
+  void operator()(std::byte* pointer) const {
+    ::operator delete[](pointer, std::align_val_t(direct_io_alignment));
+  }
+};
+using AlignedBuffer = std::unique_ptr<std::byte[], AlignedDeleter>;
+
+WriteReport write_at(const OutputFile& file,
+                     std::size_t offset,
+                     std::span<const std::byte> bytes,
+                     const WriterOptions& options) {
+  const auto start_time = std::chrono::steady_clock::now();
+
+  const auto chunk_size =
+      std::max(direct_io_alignment,
+               options.chunk_size / direct_io_alignment * direct_io_alignment);
+  const auto chunk_cnt = (bytes.size() + chunk_size - 1) / chunk_size;
+  const auto thread_cnt =
+      std::max(std::size_t(1), std::min(options.queue_depth, chunk_cnt));
+  const auto padded_size = (bytes.size() + direct_io_alignment - 1) /
+                           direct_io_alignment * direct_io_alignment;
+  const auto bounce_size = std::min(chunk_size, padded_size);
+
+  auto next_chunk = std::atomic<std::size_t>(0);
+  auto error_lock = std::mutex();
+  auto error = std::exception_ptr();
+
+  const auto write_chunks = [&]() {
+    auto bounce = AlignedBuffer();
+    if (options.direct_io) {
+      bounce = AlignedBuffer(
+          new (std::align_val_t(direct_io_alignment)) std::byte[bounce_size]);
+    }
+
+    try {
+      for (auto chunk = next_chunk++; chunk < chunk_cnt; chunk = next_chunk++) {
+        const auto chunk_offset = chunk * chunk_size;
+        auto piece = bytes.subspan(chunk_offset,
+                                   std::min(chunk_size, bytes.size() - chunk_offset));
+
+        if (options.direct_io) {
+          // the last chunk is padded to the alignment
+          const auto padded = (piece.size() + direct_io_alignment - 1) /
+                              direct_io_alignment * direct_io_alignment;
+          std::memcpy(bounce.get(), piece.data(), piece.size());
+          std::memset(bounce.get() + piece.size(), 0, padded - piece.size());
+          piece = std::span<const std::byte>(bounce.get(), padded);
+        }
+
+        file.write_at(offset + chunk_offset, piece);
+      }
+    } catch (...) {
+      const auto scoped_lock = std::scoped_lock(error_lock);
+      error = std::current_exception();
+    }
+  };
+
+  {
+    auto threads = std::vector<std::jthread>();
+    for (std::size_t thread = 1; thread < thread_cnt; ++thread) {
+      threads.emplace_back(write_chunks);
+    }
+    write_chunks();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  const auto elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time);
+  return WriteReport{bytes.size(), elapsed.count()};
+}
+
+WriteReport write_file(const std::filesystem::path& path,
+                       std::span<const std::byte> bytes,
+                       const WriterOptions& options) {
+  const auto start_time = std::chrono::steady_clock::now();
+
+  const auto file = OutputFile(path, options.direct_io);
+  write_at(file, 0, bytes, options);
+  // padding of the last direct I/O write is cut off
+  if (options.direct_io) {
+    file.resize(bytes.size());
+  }
+
+  const auto elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time);
+  return WriteReport{bytes.size(), elapsed.count()};
+}
+
+}  // namespace ParallelWriter
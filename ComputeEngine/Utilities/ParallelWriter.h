@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace ParallelWriter {
+
+struct WriterOptions {
+  // Number of chunks written concurrently
+  std::size_t queue_depth = 4;
+  // Size of each write, a multiple of the direct I/O alignment
+  std::size_t chunk_size = std::size_t(16) * 1024 * 1024;
+  // Bypass the page cache (O_DIRECT / FILE_FLAG_NO_BUFFERING)
+  bool direct_io = false;
+};
+
+struct WriteReport {
+  std::size_t bytes;
+  double seconds;
+
+  [[nodiscard]] double gigabytes_per_second() const {
+    return seconds > 0.0 ? double(bytes) / seconds / 1e9 : 0.0;
+  }
+};
+
+class OutputFile {
+  // Positional writes to a file, safe to issue from several threads at once
+#if defined(_WIN32)
+  void* file_handle = nullptr;
+#else
+  int file_descriptor = -1;
+#endif
+  std::filesystem::path path;
+  bool direct_io;
+
+ public:
+  // Create (or replace) file at path
+  OutputFile(const std::filesystem::path& path, bool direct_io = false);
+  ~OutputFile();
+
+  OutputFile(const OutputFile&) = delete;
+  OutputFile& operator=(const OutputFile&) = delete;
+
+  // Write bytes at offset, throws on failure. With direct I/O offset and size must
+  // be multiples of `direct_io_alignment` and bytes must be aligned to it
+  void write_at(std::size_t offset, std::span<const std::byte> bytes) const;
+  // Set file length, used to drop padding of the last direct I/O write
+  void resize(std::size_t size) const;
+};
+
+// Alignment of offset, size and memory required for direct I/O
+constexpr auto direct_io_alignment = std::size_t(4096);
+
+// Write bytes at offset of file as chunks written concurrently by `queue_depth`
+// threads. With direct I/O offset must be a multiple of `direct_io_alignment`, and
+// the last chunk is padded to it, so the file must be resized once complete
+WriteReport write_at(const OutputFile& file,
+                     std::size_t offset,
+                     std::span<const std::byte> bytes,
+                     const WriterOptions& options);
+
+// Write bytes to path as chunks written concurrently by `queue_depth` threads
+WriteReport write_file(const std::filesystem::path& path,
+                       std::span<const std::byte> bytes,
+                       const WriterOptions& options);
+
+}  // namespace ParallelWriter
@@ -0,0 +1,71 @@
+#include "ProcessMemory.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fstream>
+#include <string>
+#include <string_view>
+#endif
+
+namespace ProcessMemory {
+
+#if !defined(_WIN32)
+namespace {
+
+// Value of a "<key>: <n> kB" line of /proc/self/status in bytes
+std::size_t status_bytes(std::string_view key) {
+  auto status = std::ifstream("/proc/self/status");
+  auto line = std::string();
+  while (std::getline(status, line)) {
+    if (line.starts_with(key)) {
+      return std::stoull(line.substr(key.size())) * 1024;
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+#endif
+
+std::size_t peak_resident_bytes() {
+#if defined(_WIN32)
+  auto counters = PROCESS_MEMORY_COUNTERS();
+  if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == 0) {
+    return 0;
+  }
+  return counters.PeakWorkingSetSize;
+#else
+  // Linux reports high water mark of resident set in kB
+  return status_bytes("VmHWM:");
+#endif
+}
+
+std::size_t resident_bytes() {
+#if defined(_WIN32)
+  auto counters = PROCESS_MEMORY_COUNTERS();
+  if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) == 0) {
+    return 0;
+  }
+  return counters.WorkingSetSize;
+#else
+  return status_bytes("VmRSS:");
+#endif
+}
+
+bool reset_peak_resident() {
+#if defined(_WIN32)
+  // the peak working set can't be reset
+  return false;
+#else
+  // writing 5 to clear_refs resets the high water mark of resident set (Linux 4.0+)
+  auto clear_refs = std::ofstream("/proc/self/clear_refs");
+  clear_refs << "5";
+  clear_refs.close();
+  return not clear_refs.fail();
+#endif
+}
+
+}  // namespace ProcessMemory
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+
+namespace ProcessMemory {
+
+// Return peak resident memory of this process in bytes, 0 if it can't be queried
+[[nodiscard]] std::size_t peak_resident_bytes();
+// Return current resident memory of this process in bytes, 0 if it can't be queried
+[[nodiscard]] std::size_t resident_bytes();
+// Lower the peak to the current resident memory, returns false if not supported
+bool reset_peak_resident();
+
+}  // namespace ProcessMemory
@@ -0,0 +1,86 @@
+#include "SharedMemory.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace SharedMemory {
+
+SharedMemory::SharedMemory(std::string name, std::size_t size)
+    : name(std::move(name)), mapped_size(size) {
+#if defined(_WIN32)
+  // the mapping is backed by the paging file and lives while any handle is open
+  const auto wide_name = std::wstring(this->name.begin(), this->name.end());
+  const auto size_high = DWORD(std::uint64_t(size) >> 32);
+  const auto size_low = DWORD(std::uint64_t(size) & 0xFFFFFFFF);
+  mapping_handle = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                      size_high, size_low, wide_name.c_str());
+  if (mapping_handle == nullptr) {
+    throw std::runtime_error("Unable to create shared memory: " + this->name);
+  }
+
+  mapped_data = static_cast<std::byte*>(
+      MapViewOfFile(mapping_handle, FILE_MAP_ALL_ACCESS, 0, 0, size));
+  if (mapped_data == nullptr) {
+    this->close();
+    throw std::runtime_error("Unable to map shared memory: " + this->name);
+  }
+#else
+  // a region left by an earlier run may have another size, start from a new one
+  const auto path = "/" + this->name;
+  ::shm_unlink(path.c_str());
+  file_descriptor = ::shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (file_descriptor < 0) {
+    throw std::runtime_error("Unable to create shared memory: " + this->name);
+  }
+
+  if (::ftruncate(file_descriptor, off_t(size)) != 0) {
+    this->close();
+    throw std::runtime_error("Unable to resize shared memory: " + this->name);
+  }
+
+  auto* mapping =
+      ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, 0);
+  if (mapping == MAP_FAILED) {
+    this->close();
+    throw std::runtime_error("Unable to map shared memory: " + this->name);
+  }
+  mapped_data = static_cast<std::byte*>(mapping);
+#endif
+}
+
+SharedMemory::~SharedMemory() {
+  this->close();
+}
+
+void SharedMemory::close() {
+#if defined(_WIN32)
+  if (mapped_data != nullptr) {
+    UnmapViewOfFile(mapped_data);
+  }
+  if (mapping_handle != nullptr) {
+    CloseHandle(mapping_handle);
+  }
+  mapping_handle = nullptr;
+#else
+  if (mapped_data != nullptr) {
+    ::munmap(mapped_data, mapped_size);
+  }
+  if (file_descriptor >= 0) {
+    ::close(file_descriptor);
+  }
+  file_descriptor = -1;
+#endif
+  mapped_data = nullptr;
+}
+
+}  // namespace SharedMemory
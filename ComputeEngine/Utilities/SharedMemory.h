@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace SharedMemory {
+
+class SharedMemory {
+  // Named shared memory region (POSIX shm_open / Windows named file mapping) mapped
+  // for reading and writing, other processes map it by name
+  std::string name;
+  std::byte* mapped_data = nullptr;
+  std::size_t mapped_size = 0;
+
+#if defined(_WIN32)
+  void* mapping_handle = nullptr;
+#else
+  int file_descriptor = -1;
+#endif
+
+  void close();
+
+ public:
+  // Create (or replace) region `name` of `size` zeroed bytes. The region outlives
+  // this object on POSIX, the consumer removes it with shm_unlink("/<name>")
+  SharedMemory(std::string name, std::size_t size);
+  ~SharedMemory();
+
+  SharedMemory(const SharedMemory&) = delete;
+  SharedMemory& operator=(const SharedMemory&) = delete;
+
+  [[nodiscard]] const std::string& get_name() const { return name; }
+  [[nodiscard]] std::byte* data() const { return mapped_data; }
+  [[nodiscard]] std::size_t size() const { return mapped_size; }
+};
+
+}  // namespace SharedMemory
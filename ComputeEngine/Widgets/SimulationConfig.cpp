@@ -1,5 +1,9 @@
 #include <imgui.h>
+#include <sstream>
+#include <string>
+#include <vector>
 #include "../Computation/Vec3.h"
+#include "../imgui_stdlib/imgui_stdlib.h"
 #include "Colors.h"
 #include "Widgets.h"
 
@@ -35,12 +39,48 @@ void Widgets::SimulationConfig(Config::SimulationParameter& simulation_parameter
                1.0)
                   .product());
 
+  ImGui::TextUnformatted("Differentiation order");
+  {
+    // Orders are 2, 4 and 6 which maps to combo item 0, 1 and 2
+    auto order_item = simulation_parameters.differentiation_order / 2 - 1;
+    if (ImGui::Combo("##differentiation_order", &order_item,
+                     "2nd order\0"
+                     "4th order\0"
+                     "6th order\0")) {
+      simulation_parameters.differentiation_order = (order_item + 1) * 2;
+      input = true;
+    }
+  }
+
   ImGui::TextUnformatted("Transducer frequency");
   input |= ImGui::InputDouble("##frequency", &simulation_parameters.frequency, NULL,
                               NULL, "%.3f Hz", ImGuiInputTextFlags_CharsScientific);
   ImGui::Text("Wavelength\n%e m",
               simulation_parameters.air_wave_speed / simulation_parameters.frequency);
 
+  // Several frequencies are evaluated in one run instead of the one above
+  ImGui::TextUnformatted("Frequencies (comma separated, empty for one)");
+  static auto frequencies_input_text = std::string();
+  static auto frequencies_parse_error = std::string();
+  if (ImGui::InputText("##frequencies", &frequencies_input_text)) {
+    input = true;
+    try {
+      auto frequencies = std::vector<double>();
+      auto stream = std::istringstream(frequencies_input_text);
+      for (auto item = std::string(); std::getline(stream, item, ',');) {
+        frequencies.push_back(std::stod(item));
+      }
+      simulation_parameters.frequencies = std::move(frequencies);
+      frequencies_parse_error = std::string();
+    } catch (const std::exception&) {
+      simulation_parameters.frequencies.clear();
+      frequencies_parse_error = "Frequencies are not numbers";
+    }
+  }
+  if (not frequencies_parse_error.empty()) {
+    ImGui::TextColored(Colors::Red300, "%s", frequencies_parse_error.c_str());
+  }
+
   ImGui::TextUnformatted("Air density");
   input |= ImGui::InputDouble("##air_density", &simulation_parameters.air_density, NULL,
                               NULL, "%.3f kg/m3", ImGuiInputTextFlags_CharsScientific);
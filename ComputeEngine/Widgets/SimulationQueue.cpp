@@ -0,0 +1,104 @@
+#include <fmt/format.h>
+#include <imgui.h>
+#include <string>
+#include "../Computation/JobScheduler.h"
+#include "Colors.h"
+#include "Widgets.h"
+
+void Widgets::SimulationQueue(Computation::JobScheduler& scheduler) {
+  auto window_flags = ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoCollapse;
+  ImGui::Begin("Simulation Queue", nullptr, window_flags);
+
+  // Log shown below the queue, the latest job until one is selected
+  static auto selected_job = std::size_t(-1);
+
+  const auto jobs = scheduler.snapshot();
+  auto cores_in_use = std::size_t(0);
+  for (const auto& job : jobs) {
+    if (job.status == Computation::JobStatus::Running) {
+      cores_in_use += job.cores;
+    }
+  }
+  ImGui::Text("Cores in use: %zu of %zu", cores_in_use, scheduler.get_core_budget());
+
+  ImGui::Columns(8, "##jobs");
+  for (const auto* header : {"Id", "Name", "Status", "Priority", "Cores", "Progress",
+                             "Queued / running", "Output"}) {
+    ImGui::TextUnformatted(header);
+    ImGui::NextColumn();
+  }
+  ImGui::Separator();
+  for (const auto& job : jobs) {
+    const auto id = fmt::format(FMT_STRING("{:d}"), job.id);
+    if (ImGui::Selectable(id.c_str(), job.id == selected_job,
+                          ImGuiSelectableFlags_SpanAllColumns)) {
+      selected_job = job.id;
+    }
+    ImGui::NextColumn();
+    ImGui::TextUnformatted(job.name.c_str());
+    ImGui::NextColumn();
+    auto color = Colors::Grey300;
+    if (job.status == Computation::JobStatus::Running) {
+      color = Colors::Blue300;
+    } else if (job.status == Computation::JobStatus::Succeeded) {
+      color = Colors::Green300;
+    } else if (job.status == Computation::JobStatus::Failed) {
+      color = Colors::Red300;
+    }
+    ImGui::TextColored(color, "%s", std::string(to_string(job.status)).c_str());
+    ImGui::NextColumn();
+    ImGui::Text("%d", job.priority);
+    ImGui::NextColumn();
+    ImGui::Text("%zu", job.cores);
+    ImGui::NextColumn();
+    if (job.status == Computation::JobStatus::Running) {
+      const auto& progress = job.progress;
+      if (progress.paused) {
+        ImGui::Text("%.1f%% paused", 100.0 * progress.fraction);
+      } else if (progress.remaining_seconds) {
+        ImGui::Text("%.1f%%, %.0f s left", 100.0 * progress.fraction,
+                    *progress.remaining_seconds);
+      } else {
+        ImGui::Text("%.1f%%", 100.0 * progress.fraction);
+      }
+    }
+    ImGui::NextColumn();
+    ImGui::Text("%.0f / %.0f s", job.queued_seconds, job.running_seconds);
+    ImGui::NextColumn();
+    ImGui::TextUnformatted(job.export_directory.string().c_str());
+    ImGui::NextColumn();
+  }
+  ImGui::Columns(1);
+  ImGui::Separator();
+
+  if (jobs.empty()) {
+    ImGui::TextUnformatted("No simulation submitted.");
+  } else {
+    const auto& job = selected_job < jobs.size() ? jobs[selected_job] : jobs.back();
+    ImGui::Text("Log of job %zu (%s)", job.id, job.name.c_str());
+    if (job.status == Computation::JobStatus::Queued or
+        job.status == Computation::JobStatus::Running) {
+      ImGui::SameLine();
+      if (ImGui::Button("Cancel")) {
+        scheduler.cancel(job.id);
+      }
+    }
+    if (job.status == Computation::JobStatus::Running) {
+      ImGui::SameLine();
+      if (not job.progress.paused and ImGui::Button("Pause")) {
+        scheduler.pause(job.id);
+      } else if (job.progress.paused and ImGui::Button("Resume")) {
+        scheduler.resume(job.id);
+      }
+    }
+    ImGui::PushTextWrapPos(700);
+    {
+      const auto result = scheduler.job_log(job.id).read();
+      ImGui::TextUnformatted(result.second.data(),
+                             result.second.data() + result.second.size());
+    }
+    ImGui::PopTextWrapPos();
+  }
+
+  ImGui::End();
+}
@@ -1,26 +1,28 @@
 #include <fmt/format.h>
 #include <imgui.h>
-#include <atomic>
+#include <algorithm>
 #include <filesystem>
-#include <thread>
+#include <optional>
+#include <stdexcept>
 #include "../Computation/Config.h"
-#include "../Computation/Simulator.h"
-#include "../Utilities/AtomicLogger.h"
+#include "../Computation/JobScheduler.h"
 #include "../imgui_stdlib/imgui_stdlib.h"
 #include "Colors.h"
 #include "Widgets.h"
 
 void Widgets::SimulationRunner(
     const std::vector<Config::Transducer>& transducers,
-    const Config::SimulationParameter& simulation_parameters) {
+    const Config::SimulationParameter& simulation_parameters,
+    Computation::JobScheduler& scheduler) {
   auto window_flags = ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoCollapse;
   ImGui::Begin("Run Simulation", nullptr, window_flags);
 
   static auto export_directory_name = std::string("simulation_result");
-  static auto simulation_thread_forking_error = std::string();
+  static auto simulation_submit_result = std::string();
+  static auto simulation_submit_error = std::string();
+  static auto submitted_job = std::optional<std::size_t>();
 
-  static auto simulation_running = std::atomic<bool>(false);
-  static auto simulation_logging = AtomicLogger::AtomicLogger();
+  static auto execution_parameter = Config::ExecutionParameter();
 
   // Let user specify where to export simulation result
   ImGui::TextUnformatted("Export folder path");
@@ -43,66 +45,355 @@ void Widgets::SimulationRunner(
 
   ImGui::Separator();
 
-  auto run_simulation_button = ImGui::Button("Run Simulation", ImVec2(350, 20));
+  // Let user choose how the simulation is executed
+  {
+    // Output formats map to combo items in declaration order
+    auto format_item = int(execution_parameter.output_format);
+    ImGui::PushItemWidth(200);
+    if (ImGui::Combo("Output format", &format_item,
+                     "Single chunked container\0"
+                     "Legacy raw files\0"
+                     "Record stream (stdout or named pipe)\0"
+                     "Shared memory ring\0")) {
+      execution_parameter.output_format = Config::OutputFormat(format_item);
+    }
+    ImGui::PopItemWidth();
+  }
+  if (execution_parameter.output_format == Config::OutputFormat::Stream) {
+    ImGui::PushItemWidth(200);
+    ImGui::InputText("Named pipe (- for stdout)", &execution_parameter.output_stream);
+    ImGui::PopItemWidth();
+  }
+  if (execution_parameter.output_format == Config::OutputFormat::SharedMemory) {
+    ImGui::PushItemWidth(200);
+    ImGui::InputText("Shared memory name", &execution_parameter.shared_memory_name);
+    ImGui::PopItemWidth();
+    auto ring_size = int(execution_parameter.shared_memory_size);
+    ImGui::PushItemWidth(100);
+    if (ImGui::InputInt("Ring size (MiB)", &ring_size)) {
+      execution_parameter.shared_memory_size = std::size_t(std::max(ring_size, 1));
+    }
+    ImGui::PopItemWidth();
+  }
+  if (execution_parameter.output_format == Config::OutputFormat::Container) {
+    auto chunk_edge = int(execution_parameter.container_chunk_edge);
+    ImGui::PushItemWidth(100);
+    if (ImGui::InputInt("Container chunk edge (cells)", &chunk_edge)) {
+      execution_parameter.container_chunk_edge = std::size_t(std::max(chunk_edge, 1));
+    }
+    ImGui::PopItemWidth();
 
-  if (simulation_running.load()) {
-    ImGui::TextColored(Colors::Blue300, "Simulation is running.");
-  } else {
-    ImGui::TextUnformatted("Simulation is not running.");
+    // Compression modes map to combo items in declaration order
+    auto compression_item = int(execution_parameter.compression);
+    ImGui::PushItemWidth(200);
+    if (ImGui::Combo("Chunk compression", &compression_item,
+                     "None\0"
+                     "Lossless (shuffle + LZ)\0"
+                     "Lossy (error bounded)\0")) {
+      execution_parameter.compression = Config::Compression(compression_item);
+    }
+    if (execution_parameter.compression == Config::Compression::Lossy) {
+      ImGui::InputDouble("Tolerance", &execution_parameter.compression_tolerance, NULL,
+                         NULL, "%.3e", ImGuiInputTextFlags_CharsScientific);
+      ImGui::Checkbox("Relative to largest magnitude of each chunk",
+                      &execution_parameter.relative_tolerance);
+    }
+    ImGui::PopItemWidth();
+  }
+  {
+    auto pyramid_levels = int(execution_parameter.pyramid_levels);
+    ImGui::PushItemWidth(100);
+    if (ImGui::InputInt("Downsampled preview levels", &pyramid_levels)) {
+      execution_parameter.pyramid_levels =
+          std::size_t(std::clamp(pyramid_levels, 0, 16));
+    }
+    ImGui::PopItemWidth();
+    if (execution_parameter.pyramid_levels > 0) {
+      // Reductions map to combo items in declaration order
+      auto reduction_item = int(execution_parameter.pyramid_reduction);
+      ImGui::PushItemWidth(200);
+      if (ImGui::Combo("Level reduction", &reduction_item,
+                       "Average\0"
+                       "Decimate\0")) {
+        execution_parameter.pyramid_reduction =
+            Config::PyramidReduction(reduction_item);
+      }
+      ImGui::PopItemWidth();
+    }
+  }
+  ImGui::Checkbox("Also export VTK ImageData (.vti)", &execution_parameter.vtk_export);
+  if (execution_parameter.vtk_export) {
+    // Pressure forms map to combo items in declaration order
+    auto pressure_item = int(execution_parameter.vtk_pressure);
+    ImGui::PushItemWidth(200);
+    if (ImGui::Combo("VTK pressure arrays", &pressure_item,
+                     "Magnitude and phase\0"
+                     "Real and imaginary\0")) {
+      execution_parameter.vtk_pressure = Config::VtkPressure(pressure_item);
+    }
+    ImGui::PopItemWidth();
+  }
+  ImGui::Checkbox("Stream x-slabs (memory bounded by slab size)",
+                  &execution_parameter.slab_streaming);
+  ImGui::Checkbox("Compute into memory-mapped result files (legacy output)",
+                  &execution_parameter.mapped_output);
+  ImGui::Checkbox("Export results in background while computing",
+                  &execution_parameter.async_export);
+  {
+    auto queue_depth = int(execution_parameter.write_queue_depth);
+    ImGui::PushItemWidth(100);
+    if (ImGui::InputInt("Concurrent writes per file", &queue_depth)) {
+      execution_parameter.write_queue_depth = std::size_t(std::max(queue_depth, 1));
+    }
+    ImGui::PopItemWidth();
+  }
+  ImGui::Checkbox("Bypass page cache when writing (direct I/O)",
+                  &execution_parameter.direct_io);
+  ImGui::Checkbox("Checkpoint intermediate fields (resident processing)",
+                  &execution_parameter.checkpoint);
+  if (execution_parameter.checkpoint) {
+    auto interval = int(execution_parameter.checkpoint_interval);
+    ImGui::PushItemWidth(100);
+    if (ImGui::InputInt("Pressure checkpoint interval (s)", &interval)) {
+      execution_parameter.checkpoint_interval = std::size_t(std::max(interval, 0));
+    }
+    ImGui::PopItemWidth();
+  }
+  ImGui::Checkbox("Resume from checkpoint of same parameters",
+                  &execution_parameter.resume);
 
-    if (run_simulation_button) {
-      // Simulation is not running and the user pressed the button to start
+  // Results of earlier runs with the same parameters are reused from the cache
+  ImGui::PushItemWidth(200);
+  ImGui::InputText("Result cache folder (empty to disable)",
+                   &execution_parameter.result_cache);
+  ImGui::PopItemWidth();
+  if (not execution_parameter.result_cache.empty()) {
+    auto cache_size = int(execution_parameter.result_cache_size);
+    ImGui::PushItemWidth(100);
+    if (ImGui::InputInt("Result cache size (MiB)", &cache_size, 1024)) {
+      execution_parameter.result_cache_size = std::size_t(std::max(cache_size, 1));
+    }
+    ImGui::PopItemWidth();
+  }
 
-      try {
-        // Checks if transducers are invalid
-        for (const auto& transducer : transducers) {
-          const auto invalid_transducer = transducer.checkInvalidParameter();
-          if (not invalid_transducer.empty()) {
-            throw std::exception(invalid_transducer.c_str());
-          }
-        }
+  // Potential of any particle is a linear combination of these two fields
+  ImGui::Checkbox("Export |p|^2 and |grad p|^2 (whole box)",
+                  &execution_parameter.export_intensity);
+
+  // Time averaged fields of different frequencies add up without cross terms
+  ImGui::Checkbox("Export sum over frequencies (multi-frequency runs)",
+                  &execution_parameter.incoherent_sum);
 
-        // Checks if parameters are invalid
-        const auto invalid_simulation_parameter =
-            simulation_parameters.checkInvalidParameter();
-        if (not invalid_simulation_parameter.empty()) {
-          throw std::exception(invalid_simulation_parameter.c_str());
+  // Particles get their own potential and force fields from the same pressure
+  static auto particles_input_text = std::string();
+  static auto particles_parse_result = std::string("No additional particles");
+  ImGui::TextUnformatted("Additional particles (JSON array)");
+  if (ImGui::InputTextMultiline("##particles", &particles_input_text,
+                                ImVec2(350, 60))) {
+    try {
+      auto particles = std::vector<Config::ParticleParameter>();
+      if (not particles_input_text.empty()) {
+        for (const auto& item : nlohmann::json::parse(particles_input_text)) {
+          particles.push_back(JSONConvert::to_particle_parameter(item));
         }
+      }
+      execution_parameter.particles = std::move(particles);
+      particles_parse_result =
+          execution_parameter.particles.empty()
+              ? std::string("No additional particles")
+              : fmt::format(FMT_STRING("Particle count: {:d}"),
+                            execution_parameter.particles.size());
+    } catch (const std::exception& e) {
+      execution_parameter.particles.clear();
+      particles_parse_result = e.what();
+    }
+  }
+  ImGui::PushTextWrapPos(350);
+  ImGui::TextUnformatted(particles_parse_result.c_str());
+  ImGui::PopTextWrapPos();
 
-        // Create export directory
-        std::filesystem::create_directories(export_directory);
-
-        // Start simulation
-        simulation_running.store(true);
-        simulation_thread_forking_error = std::string();
-        simulation_logging.clear();
-
-        // Fork simulation thread
-        auto simulation_thread = std::thread(
-            Computation::simulationProcess, &simulation_running, &simulation_logging,
-            export_directory, transducers,
-            simulation_parameters);
-        simulation_thread.detach();
-
-      } catch (const std::exception& e) {
-        // Error when forking thread
-        simulation_running.store(false);
-        simulation_thread_forking_error =
-            fmt::format(FMT_STRING("Unable to start simulation: {:s}"), e.what());
+  // Only selected fields and those they are computed from are evaluated
+  if (ImGui::TreeNode("Output fields (none selected for pressure, potential, force)")) {
+    for (const auto field : Config::output_fields) {
+      auto& outputs = execution_parameter.outputs;
+      const auto selected = std::find(outputs.begin(), outputs.end(), field);
+      auto checked = selected != outputs.end();
+      if (ImGui::Checkbox(std::string(field).c_str(), &checked)) {
+        if (checked) {
+          outputs.emplace_back(field);
+        } else {
+          outputs.erase(selected);
+        }
       }
     }
+    ImGui::TreePop();
+  }
+
+  // A sweep runs every point as one job, each into its own folder
+  static auto sweep_input_text = std::string();
+  static auto sweep_parse_result = std::string("Single run");
+  ImGui::TextUnformatted("Parameter sweep (JSON object, empty for a single run)");
+  if (ImGui::InputTextMultiline("##sweep", &sweep_input_text, ImVec2(350, 60))) {
+    try {
+      execution_parameter.sweep =
+          sweep_input_text.empty()
+              ? Config::SweepParameter()
+              : JSONConvert::to_sweep_parameter(
+                    nlohmann::json::parse(sweep_input_text));
+      const auto invalid_sweep = execution_parameter.sweep.checkInvalidParameter();
+      sweep_parse_result =
+          not invalid_sweep.empty() ? invalid_sweep
+          : execution_parameter.sweep.kind == Config::SweepParameter::Kind::None
+              ? std::string("Single run")
+              : fmt::format(FMT_STRING("Sweep point count: {:d}"),
+                            execution_parameter.sweep.points().size());
+    } catch (const std::exception& e) {
+      execution_parameter.sweep = Config::SweepParameter();
+      sweep_parse_result = e.what();
+    }
   }
+  ImGui::PushTextWrapPos(350);
+  ImGui::TextUnformatted(sweep_parse_result.c_str());
+  ImGui::PopTextWrapPos();
 
-  // Report error to user
+  // Evaluation targets replace the simulation box when any is given
+  static auto targets_input_text = std::string();
+  static auto targets_parse_result = std::string("Evaluating whole simulation box");
+  ImGui::TextUnformatted("Evaluation targets (JSON array, empty for whole box)");
+  if (ImGui::InputTextMultiline("##targets", &targets_input_text, ImVec2(350, 80))) {
+    try {
+      auto targets = std::vector<Config::EvaluationTarget>();
+      if (not targets_input_text.empty()) {
+        for (const auto& item : nlohmann::json::parse(targets_input_text)) {
+          targets.push_back(JSONConvert::to_evaluation_target(item));
+        }
+      }
+      execution_parameter.targets = std::move(targets);
+      targets_parse_result =
+          execution_parameter.targets.empty()
+              ? std::string("Evaluating whole simulation box")
+              : fmt::format(FMT_STRING("Target count: {:d}"),
+                            execution_parameter.targets.size());
+    } catch (const std::exception& e) {
+      execution_parameter.targets.clear();
+      targets_parse_result = e.what();
+    }
+  }
   ImGui::PushTextWrapPos(350);
-  if (not simulation_thread_forking_error.empty()) {
-    ImGui::TextColored(Colors::Red300, "%s", simulation_thread_forking_error.c_str());
+  ImGui::TextUnformatted(targets_parse_result.c_str());
+  ImGui::PopTextWrapPos();
+
+  ImGui::Separator();
+
+  // Jobs of higher priority start first, cores are estimated from the size if 0
+  static auto job_priority = 0;
+  static auto job_cores = 0;
+  ImGui::PushItemWidth(100);
+  ImGui::InputInt("Priority", &job_priority);
+  if (ImGui::InputInt("Cores (0 for automatic)", &job_cores)) {
+    job_cores = std::clamp(job_cores, 0, int(scheduler.get_core_budget()));
   }
+  ImGui::PopItemWidth();
   {
-    const auto result = simulation_logging.read();
-    ImGui::TextUnformatted(result.second.data());
+    // Backends map to combo items in declaration order
+    auto backend_item = int(execution_parameter.parallel_backend);
+    ImGui::PushItemWidth(200);
+    if (ImGui::Combo("Parallel backend", &backend_item,
+                     "OpenMP\0"
+                     "Thread pool\0"
+                     "std::execution\0")) {
+      execution_parameter.parallel_backend = Config::ParallelBackend(backend_item);
+    }
+    ImGui::PopItemWidth();
+  }
+
+  if (ImGui::Button("Submit Simulation", ImVec2(350, 20))) {
+    try {
+      // Checks if transducers are invalid
+      for (const auto& transducer : transducers) {
+        const auto invalid_transducer = transducer.checkInvalidParameter();
+        if (not invalid_transducer.empty()) {
+          throw std::invalid_argument(invalid_transducer);
+        }
+      }
+
+      // Checks if parameters are invalid
+      const auto invalid_simulation_parameter =
+          simulation_parameters.checkInvalidParameter();
+      if (not invalid_simulation_parameter.empty()) {
+        throw std::invalid_argument(invalid_simulation_parameter);
+      }
+
+      // Checks if execution options are invalid
+      const auto invalid_execution_parameter =
+          execution_parameter.checkInvalidParameter();
+      if (not invalid_execution_parameter.empty()) {
+        throw std::invalid_argument(invalid_execution_parameter);
+      }
+      const auto invalid_combination = Config::checkInvalidCombination(
+          simulation_parameters, execution_parameter);
+      if (not invalid_combination.empty()) {
+        throw std::invalid_argument(invalid_combination);
+      }
+
+      // Create export directory
+      std::filesystem::create_directories(export_directory);
+
+      // Queue simulation, the queue window shows its progress
+      const auto id = scheduler.submit(Computation::JobRequest{
+          export_directory_name, export_directory, transducers, simulation_parameters,
+          execution_parameter, job_priority, std::size_t(job_cores)});
+      simulation_submit_result = fmt::format(FMT_STRING("Submitted as job {:d}"), id);
+      submitted_job = id;
+      simulation_submit_error = std::string();
+    } catch (const std::exception& e) {
+      simulation_submit_result = std::string();
+      simulation_submit_error =
+          fmt::format(FMT_STRING("Unable to submit simulation: {:s}"), e.what());
+    }
+  }
+
+  // Report result to user
+  ImGui::PushTextWrapPos(350);
+  if (not simulation_submit_error.empty()) {
+    ImGui::TextColored(Colors::Red300, "%s", simulation_submit_error.c_str());
+  } else if (not simulation_submit_result.empty()) {
+    ImGui::TextUnformatted(simulation_submit_result.c_str());
   }
   ImGui::PopTextWrapPos();
 
+  // Progress of the job submitted last, until it finishes
+  if (submitted_job) {
+    const auto jobs = scheduler.snapshot();
+    const auto& job = jobs.at(*submitted_job);
+    if (job.status == Computation::JobStatus::Running) {
+      const auto& progress = job.progress;
+      const auto overlay =
+          progress.paused ? std::string("Paused")
+          : progress.remaining_seconds
+              ? fmt::format(FMT_STRING("{:.1f}%, about {:.0f} s left"),
+                            100.0 * progress.fraction, *progress.remaining_seconds)
+              : fmt::format(FMT_STRING("{:.1f}%"), 100.0 * progress.fraction);
+      ImGui::ProgressBar(float(progress.fraction), ImVec2(350, 0), overlay.c_str());
+      if (ImGui::Button("Cancel", ImVec2(170, 20))) {
+        scheduler.cancel(job.id);
+      }
+      ImGui::SameLine();
+      if (progress.paused) {
+        if (ImGui::Button("Resume", ImVec2(170, 20))) {
+          scheduler.resume(job.id);
+        }
+      } else if (ImGui::Button("Pause", ImVec2(170, 20))) {
+        scheduler.pause(job.id);
+      }
+    } else if (job.status == Computation::JobStatus::Queued) {
+      if (ImGui::Button("Cancel", ImVec2(350, 20))) {
+        scheduler.cancel(job.id);
+      }
+    } else {
+      ImGui::Text("Job %zu %s", job.id, std::string(to_string(job.status)).c_str());
+    }
+  }
+
   ImGui::End();
-}
\ No newline at end of file
+}
@@ -1,5 +1,6 @@
 #include <fmt/format.h>
 #include <imgui.h>
+#include <stdexcept>
 #include "../imgui_stdlib/imgui_stdlib.h"
 #include "Colors.h"
 #include "Widgets.h"
@@ -29,13 +30,13 @@ void Widgets::TransducerConfig(std::vector<Config::Transducer>& transducers) {
     // Parsing logic
     try {
       if (user_input_text.empty()) {
-        throw std::exception("Input is empty");
+        throw std::invalid_argument("Input is empty");
       }
 
       const auto parsedResult = nlohmann::json::parse(user_input_text);
 
       if (not parsedResult.is_array()) {
-        throw std::exception("Input root is not an array");
+        throw std::invalid_argument("Input root is not an array");
       }
 
       transducers.clear();
@@ -45,11 +46,9 @@ void Widgets::TransducerConfig(std::vector<Config::Transducer>& transducers) {
 
         const auto invalidParameter = parsedItem.checkInvalidParameter();
         if (not invalidParameter.empty()) {
-          throw std::exception(
-              fmt::format(
-                  FMT_STRING("Transducer '{:s}' has an invalid parameter: {:s}"),
-                  parsedItem.id, invalidParameter)
-                  .c_str());
+          throw std::invalid_argument(fmt::format(
+              FMT_STRING("Transducer '{:s}' has an invalid parameter: {:s}"),
+              parsedItem.id, invalidParameter));
         }
 
         transducers.push_back(std::move(parsedItem));
@@ -2,12 +2,15 @@
 
 #include <vector>
 #include "../Computation/Config.h"
+#include "../Computation/JobScheduler.h"
 
 namespace Widgets {
 
 void TransducerConfig(std::vector<Config::Transducer>& transducers);
 void SimulationConfig(Config::SimulationParameter& simulation_parameters);
 void SimulationRunner(const std::vector<Config::Transducer>& transducers,
-                      const Config::SimulationParameter& simulation_parameters);
+                      const Config::SimulationParameter& simulation_parameters,
+                      Computation::JobScheduler& scheduler);
+void SimulationQueue(Computation::JobScheduler& scheduler);
 
 }  // namespace Widgets
@@ -0,0 +1,289 @@
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Computation/Config.h"
+#include "Computation/JobScheduler.h"
+#include "Computation/Processes.h"
+#include "Computation/ResultCache.h"
+#include "Utilities/AtomicLogger.h"
+
+namespace {
+
+constexpr auto usage =
+    "Usage: ComputeEngineHeadless <transducers.json> <simulation.json> <output folder>"
+    " [execution.json]\n"
+    "       ComputeEngineHeadless queue <jobs.json> [cores]\n"
+    "       ComputeEngineHeadless cache <command> <folder> [...]\n"
+    "       ComputeEngineHeadless particles <results> <particles.json>"
+    " <output folder>\n";
+
+nlohmann::json read_json(const std::string& path) {
+  auto file = std::ifstream(path);
+  if (not file) {
+    throw std::runtime_error("Unable to read " + path);
+  }
+  return nlohmann::json::parse(file);
+}
+
+// Queue entries either name a JSON file or hold the JSON itself
+nlohmann::json read_entry(const nlohmann::json& entry) {
+  return entry.is_string() ? read_json(entry.get<std::string>()) : entry;
+}
+
+// Same schema and checks as the configuration windows
+Computation::JobRequest make_job(const nlohmann::json& transducer_json,
+                                 const nlohmann::json& simulation_json,
+                                 const nlohmann::json& execution_json,
+                                 const std::filesystem::path& export_directory) {
+  auto request = Computation::JobRequest();
+  if (not transducer_json.is_array()) {
+    throw std::invalid_argument("Transducer root is not an array");
+  }
+  for (const auto& item : transducer_json) {
+    auto transducer = JSONConvert::to_transducer(item);
+    const auto invalid_transducer = transducer.checkInvalidParameter();
+    if (not invalid_transducer.empty()) {
+      throw std::invalid_argument(
+          fmt::format(FMT_STRING("Transducer '{:s}' has an invalid parameter: {:s}"),
+                      transducer.id, invalid_transducer));
+    }
+    request.transducers.push_back(std::move(transducer));
+  }
+
+  request.simulation_parameter = JSONConvert::to_simulation_parameter(simulation_json);
+  const auto invalid_simulation_parameter =
+      request.simulation_parameter.checkInvalidParameter();
+  if (not invalid_simulation_parameter.empty()) {
+    throw std::invalid_argument(invalid_simulation_parameter);
+  }
+
+  if (not execution_json.is_null()) {
+    request.execution_parameter = JSONConvert::to_execution_parameter(execution_json);
+  }
+  const auto invalid_execution_parameter =
+      request.execution_parameter.checkInvalidParameter();
+  if (not invalid_execution_parameter.empty()) {
+    throw std::invalid_argument(invalid_execution_parameter);
+  }
+  const auto invalid_combination = Config::checkInvalidCombination(
+      request.simulation_parameter, request.execution_parameter);
+  if (not invalid_combination.empty()) {
+    throw std::invalid_argument(invalid_combination);
+  }
+
+  request.export_directory = export_directory;
+  std::filesystem::create_directories(export_directory);
+  return request;
+}
+
+// Forwards new log lines of a job to stderr
+class LogForwarder {
+  AtomicLogger::AtomicLogger& log;
+  std::string prefix;
+  std::size_t printed = 0;
+
+ public:
+  LogForwarder(AtomicLogger::AtomicLogger& job_log, std::string line_prefix)
+      : log(job_log), prefix(std::move(line_prefix)) {}
+
+  void forward() {
+    const auto [lock, text] = this->log.read();
+    auto lines = text.substr(this->printed);
+    // only complete lines, so lines of concurrent jobs do not interleave
+    const auto end = lines.rfind('\n');
+    if (end == std::string_view::npos) {
+      return;
+    }
+    lines = lines.substr(0, end + 1);
+    for (auto begin = std::size_t(0); begin < lines.size();) {
+      const auto line_end = lines.find('\n', begin) + 1;
+      std::cerr << this->prefix << lines.substr(begin, line_end - begin);
+      begin = line_end;
+    }
+    std::cerr << std::flush;
+    this->printed += lines.size();
+  }
+};
+
+// Set by Ctrl+C, which cancels every job
+volatile std::sig_atomic_t interrupted = 0;
+
+// Seconds between progress lines of running jobs
+constexpr auto progress_interval = std::chrono::seconds(10);
+
+// Run every job through the scheduler, forwarding their logs and progress until all
+// finished. Returns the exit code
+int run_jobs(Computation::JobScheduler& scheduler,
+             std::vector<Computation::JobRequest> requests,
+             bool prefix_lines) {
+  auto names = std::vector<std::string>();
+  for (const auto& request : requests) {
+    names.push_back(prefix_lines ? "[" + request.name + "] " : std::string());
+  }
+  const auto ids = scheduler.submit(std::move(requests));
+  auto forwarders = std::vector<LogForwarder>();
+  auto results = std::vector<std::shared_future<Computation::JobStatus>>();
+  for (std::size_t i = 0; i < ids.size(); ++i) {
+    forwarders.emplace_back(scheduler.job_log(ids[i]), names[i]);
+    results.push_back(scheduler.result(ids[i]));
+  }
+  const auto finished = [](const auto& result) {
+    return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  };
+
+  std::signal(SIGINT, [](int) { interrupted = 1; });
+  auto cancelled = false;
+  auto last_progress = std::chrono::steady_clock::now();
+  auto done = false;
+  while (not done) {
+    done = std::all_of(results.begin(), results.end(), finished);
+    for (auto& forwarder : forwarders) {
+      forwarder.forward();
+    }
+    if (interrupted != 0 and not cancelled) {
+      std::cerr << "Cancelling every job\n";
+      for (const auto id : ids) {
+        scheduler.cancel(id);
+      }
+      cancelled = true;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - last_progress >= progress_interval) {
+      const auto jobs = scheduler.snapshot();
+      for (std::size_t i = 0; i < jobs.size(); ++i) {
+        const auto& progress = jobs[i].progress;
+        if (jobs[i].status != Computation::JobStatus::Running) {
+          continue;
+        }
+        std::cerr << names[i] << fmt::format(FMT_STRING("Progress {:.1f}%"),
+                                             100.0 * progress.fraction);
+        if (progress.remaining_seconds) {
+          std::cerr << fmt::format(FMT_STRING(", about {:.0f} s left"),
+                                   *progress.remaining_seconds);
+        }
+        std::cerr << "\n";
+      }
+      last_progress = now;
+    }
+
+    if (not done) {
+      std::find_if_not(results.begin(), results.end(), finished)
+          ->wait_for(std::chrono::milliseconds(200));
+    }
+  }
+  std::signal(SIGINT, SIG_DFL);
+
+  auto succeeded = true;
+  for (const auto& job : scheduler.snapshot()) {
+    if (prefix_lines) {
+      std::cerr << fmt::format(
+          FMT_STRING("Job {:d} '{:s}' {:s} on {:d} cores after {:.1f} s queued and "
+                     "{:.1f} s running, output in {:s}\n"),
+          job.id, job.name, Computation::to_string(job.status), job.cores,
+          job.queued_seconds, job.running_seconds, job.export_directory.string());
+    }
+    succeeded = succeeded and job.status == Computation::JobStatus::Succeeded;
+  }
+  return succeeded ? 0 : 1;
+}
+
+// Jobs are a JSON list of objects with the transducers, simulation and optional
+// execution parameters (each a file name or the JSON itself), the output folder, and
+// optionally a name, priority and number of cores
+int queueCommand(const std::vector<std::string>& arguments) {
+  if (arguments.size() != 1 and arguments.size() != 2) {
+    std::cerr << usage;
+    return 2;
+  }
+  auto requests = std::vector<Computation::JobRequest>();
+  auto core_budget = std::size_t(0);
+  try {
+    if (arguments.size() == 2) {
+      core_budget = std::stoul(arguments[1]);
+    }
+    const auto jobs_json = read_json(arguments[0]);
+    if (not jobs_json.is_array()) {
+      throw std::invalid_argument("Job root is not an array");
+    }
+    for (const auto& item : jobs_json) {
+      const auto name = item.value("name", fmt::format(FMT_STRING("job{:d}"),
+                                                       requests.size()));
+      try {
+        const auto execution_json = item.contains("execution")
+                                        ? read_entry(item["execution"])
+                                        : nlohmann::json();
+        auto request = make_job(read_entry(item.at("transducers")),
+                                read_entry(item.at("simulation")), execution_json,
+                                item.at("output").get<std::string>());
+        request.name = name;
+        request.priority = item.value("priority", 0);
+        request.cores = item.value("cores", std::size_t(0));
+        requests.push_back(std::move(request));
+      } catch (const std::exception& e) {
+        throw std::invalid_argument(
+            fmt::format(FMT_STRING("Job '{:s}': {:s}"), name, e.what()));
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Invalid input: " << e.what() << "\n";
+    return 2;
+  }
+
+  auto scheduler = Computation::JobScheduler(core_budget);
+  std::cerr << fmt::format(FMT_STRING("Running {:d} jobs on {:d} cores\n"),
+                           requests.size(), scheduler.get_core_budget());
+  return run_jobs(scheduler, std::move(requests), true);
+}
+
+}  // namespace
+
+// Runs simulations without a window, for machines without a display. The log is
+// written to stderr, so stdout stays free for stream output. Exits with 0 once
+// results are written, 1 if a simulation failed or was cancelled with Ctrl+C and 2
+// for invalid input
+int main(int argc, char** argv) {
+  const auto arguments = std::vector<std::string>(argv + 1, argv + argc);
+  const auto command_arguments = [&]() {
+    return std::vector<std::string>(arguments.begin() + 1, arguments.end());
+  };
+  if (not arguments.empty() and arguments[0] == "cache") {
+    return Computation::cacheCommand(command_arguments(), std::cout);
+  }
+  if (not arguments.empty() and arguments[0] == "particles") {
+    return Computation::particleCommand(command_arguments(), std::cout);
+  }
+  if (not arguments.empty() and arguments[0] == "queue") {
+    return queueCommand(command_arguments());
+  }
+  if (arguments.size() != 3 and arguments.size() != 4) {
+    std::cerr << usage;
+    return 2;
+  }
+
+  auto requests = std::vector<Computation::JobRequest>();
+  try {
+    requests.push_back(make_job(
+        read_json(arguments[0]), read_json(arguments[1]),
+        arguments.size() == 4 ? read_json(arguments[3]) : nlohmann::json(),
+        arguments[2]));
+  } catch (const std::exception& e) {
+    std::cerr << "Invalid input: " << e.what() << "\n";
+    return 2;
+  }
+
+  // a single job gets every core
+  requests.front().cores = std::size_t(-1);
+  auto scheduler = Computation::JobScheduler();
+  return run_jobs(scheduler, std::move(requests), false);
+}
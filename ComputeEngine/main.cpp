@@ -3,11 +3,30 @@
 #include <SFML/Graphics/RenderWindow.hpp>
 #include <SFML/Window/Event.hpp>
 
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include "Widgets/SetupStyle.h"
 #include "Widgets/Widgets.h"
 #include "Computation/Config.h"
+#include "Computation/JobScheduler.h"
+#include "Computation/Processes.h"
+#include "Computation/ResultCache.h"
+
+int main(int argc, char** argv) {
+  // `ComputeEngine cache ...` manages the result cache without opening a window
+  if (argc > 1 and std::string_view(argv[1]) == "cache") {
+    return Computation::cacheCommand(std::vector<std::string>(argv + 2, argv + argc),
+                                     std::cout);
+  }
+  // `ComputeEngine particles ...` derives particles from exported intensity fields
+  if (argc > 1 and std::string_view(argv[1]) == "particles") {
+    return Computation::particleCommand(
+        std::vector<std::string>(argv + 2, argv + argc), std::cout);
+  }
 
-int main(int /*argc*/, char** /*argv*/) {
   // Window Setup
   auto window = sf::RenderWindow(sf::VideoMode(1200, 675), "ComputeEngine");
   window.setFramerateLimit(30);
@@ -17,6 +36,8 @@ int main(int /*argc*/, char** /*argv*/) {
   // Global data and configurations
   auto transducers = std::vector<Config::Transducer>();
   auto simulation_parameters = Config::SimulationParameter();
+  // Submitted simulations, running ones are finished before the program exits
+  auto scheduler = Computation::JobScheduler();
 
   // Main loop
   auto deltaClock = sf::Clock();
@@ -34,7 +55,8 @@ int main(int /*argc*/, char** /*argv*/) {
 
     Widgets::TransducerConfig(transducers);
     Widgets::SimulationConfig(simulation_parameters);
-    Widgets::SimulationRunner(transducers, simulation_parameters);
+    Widgets::SimulationRunner(transducers, simulation_parameters, scheduler);
+    Widgets::SimulationQueue(scheduler);
 
     window.clear();
     ImGui::SFML::Render(window);